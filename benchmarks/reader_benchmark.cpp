@@ -0,0 +1,123 @@
+/**
+ * @file reader_benchmark.cpp
+ * @brief Compares the file reader backends (ifstream, mmap, io_uring) on cold and warm page caches
+ *
+ * Usage: reader_benchmark <file> [repetitions]
+ *
+ * Every backend splits the file into lines, so each run does the same work
+ * as the loader's producer thread minus batching. A cold run first drops
+ * the file's clean pages with POSIX_FADV_DONTNEED, which needs no
+ * privileges; pages of a file that is still being written stay cached.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "memory_mapped_file.h"
+#include "parallel_decompressor.h"
+#include "uring_file_reader.h"
+
+using namespace logai;
+
+namespace {
+
+struct Backend {
+    const char* name;
+    std::function<size_t(const std::string&)> read_lines;  // Returns the number of lines
+};
+
+size_t read_ifstream(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(file, line)) {
+        lines += !line.empty();
+    }
+    return lines;
+}
+
+size_t read_mmap(const std::string& path) {
+    MemoryMappedFile file(path);
+    if (!file.isOpen()) {
+        throw std::runtime_error("Failed to map " + path);
+    }
+    LineSplitter splitter([](std::string_view) {}, 1024 * 1024);
+    splitter.feed(file.data(), file.size());
+    splitter.finish();
+    return splitter.lines();
+}
+
+size_t read_uring(const std::string& path, bool direct) {
+    UringReaderConfig config;
+    config.direct_io = direct;
+    UringFileReader reader(config);
+    LineSplitter splitter([](std::string_view) {}, 1024 * 1024);
+    reader.read(path, [&](const char* data, size_t size) { splitter.feed(data, size); });
+    splitter.finish();
+    return splitter.lines();
+}
+
+void drop_cache(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::fprintf(stderr, "usage: %s <file> [repetitions]\n", argv[0]);
+        return 1;
+    }
+    const std::string path = argv[1];
+    const int repetitions = argc > 2 ? std::max(1, std::atoi(argv[2])) : 3;
+
+    std::ifstream probe(path, std::ios::binary | std::ios::ate);
+    if (!probe) {
+        std::fprintf(stderr, "cannot open %s\n", path.c_str());
+        return 1;
+    }
+    const double megabytes = static_cast<double>(probe.tellg()) / (1024.0 * 1024.0);
+
+    std::vector<Backend> backends = {
+        {"ifstream", read_ifstream},
+        {"mmap", read_mmap},
+    };
+    if (UringFileReader::isSupported()) {
+        backends.push_back({"io_uring", [](const std::string& p) { return read_uring(p, false); }});
+        backends.push_back({"io_uring+O_DIRECT", [](const std::string& p) { return read_uring(p, true); }});
+    } else {
+        std::fprintf(stderr, "io_uring is not available, skipping its backends\n");
+    }
+
+    std::printf("%-20s %-6s %12s %10s %12s\n", "backend", "cache", "lines", "best s", "MB/s");
+    for (const bool cold : {true, false}) {
+        for (const auto& backend : backends) {
+            if (!cold) {
+                backend.read_lines(path);  // Warm up
+            }
+            double best = 1e300;
+            size_t lines = 0;
+            for (int i = 0; i < repetitions; ++i) {
+                if (cold) {
+                    drop_cache(path);
+                }
+                auto start = std::chrono::steady_clock::now();
+                lines = backend.read_lines(path);
+                best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+            std::printf("%-20s %-6s %12zu %10.3f %12.1f\n", backend.name, cold ? "cold" : "warm", lines, best,
+                        megabytes / best);
+        }
+    }
+    return 0;
+}
@@ -128,6 +128,18 @@ DEFAULT_MODELS = {
 # Provider Type
 ProviderType = Literal["openai"]
 
+# Window lengths (seconds) accepted by get_trending_patterns
+TRENDING_WINDOWS = {
+    "second": 1,
+    "minute": 60,
+    "5min": 300,
+    "hour": 3600,
+    "day": 86400
+}
+
+# Directory of the C++ segment stores, one per loaded file
+SEGMENT_STORE_DIR = "logai_segments"
+
 # Main LogAI Agent class
 class LogAIAgent:
     """LogAI Agent for analyzing logs with AI assistance."""
@@ -205,6 +217,13 @@ The analysis should:
                 )
             """)
             
+            self.duckdb_conn.execute("""
+                CREATE TABLE IF NOT EXISTS ingest_state (
+                    source VARCHAR,
+                    rows BIGINT
+                )
+            """)
+            
             self.duckdb_conn.execute("""
                 CREATE TABLE IF NOT EXISTS log_templates (
                     template_id VARCHAR PRIMARY KEY,
@@ -213,20 +232,28 @@ The analysis should:
                 )
             """)
             
-            # Parse the log file using the C++ wrapper
+            # Keep parsed rows as time-partitioned segments, reused on re-initialization
+            self.cpp_wrapper.set_segment_store_root(SEGMENT_STORE_DIR)
+            
+            # Parse the log file using the C++ wrapper; a file loaded before only yields its new lines
             parsed_logs = self.cpp_wrapper.parse_log_file(log_file, format or "")
-            if not parsed_logs:
+            first_row = self._resumed_first_row()
+            if first_row is None and self._ingest_state().get("resumed"):
+                # DuckDB does not hold the earlier rows, parse the whole file again
+                parsed_logs = self.cpp_wrapper.parse_log_file(log_file, format or "", False)
+            if not parsed_logs and first_row is None:
                 self.console.print("[bold red]Failed to parse log file.[/]")
                 return False
             
             # Load the parsed logs into DuckDB
-            self._load_logs_to_duckdb(parsed_logs)
+            self._load_logs_to_duckdb(parsed_logs, first_row or 0)
             
             # Extract templates
+            native_templates = bool(self._get_native_templates())
             templates = self._extract_templates_from_logs(parsed_logs)
             
-            # Store templates in DuckDB
-            self._store_templates_in_duckdb(templates)
+            # Store templates in DuckDB, counts of new lines add to the earlier ones
+            self._store_templates_in_duckdb(templates, merge=first_row is not None and not native_templates)
             
             # Initialize vector store and store templates
             try:
@@ -251,14 +278,28 @@ The analysis should:
             self.console.print(f"[bold red]Error initializing agent:[/] {str(e)}")
             return False
 
-    def _load_logs_to_duckdb(self, parsed_logs: List[Dict[str, Any]]) -> None:
-        """Load parsed logs into DuckDB."""
+    def _ingest_state(self) -> Dict[str, Any]:
+        """Outcome of the last parse_log_file call."""
+        return self.cpp_wrapper.get_ingest_state()
+
+    def _resumed_first_row(self) -> Optional[int]:
+        """ID of the first new row if the last parse continued the file whose rows DuckDB holds."""
+        state = self._ingest_state()
+        if not state.get("resumed"):
+            return None
+        loaded = self.duckdb_conn.execute("SELECT source, rows FROM ingest_state").fetchone()
+        if loaded is None or loaded[0] != state["source"] or loaded[1] != state["first_row"]:
+            return None
+        return state["first_row"]
+
+    def _load_logs_to_duckdb(self, parsed_logs: List[Dict[str, Any]], first_row: int = 0) -> None:
+        """Load parsed logs into DuckDB, appending after the existing rows if first_row > 0."""
         # Create a Pandas DataFrame from the parsed logs
         import pandas as pd
         
         # Extract relevant fields
         records = []
-        for i, log in enumerate(parsed_logs):
+        for i, log in enumerate(parsed_logs, start=first_row):
             record = {
                 'id': i,
                 'timestamp': log.get('timestamp'),
@@ -273,15 +314,29 @@ The analysis should:
         df = pd.DataFrame(records)
         
         # Insert into DuckDB
-        self.duckdb_conn.execute("DELETE FROM log_entries")
-        self.duckdb_conn.register('df', df) # Register DataFrame instead of INSERT
-        self.duckdb_conn.execute("INSERT INTO log_entries SELECT * FROM df")
-        self.duckdb_conn.unregister('df') # Unregister after use
+        if first_row == 0:
+            self.duckdb_conn.execute("DELETE FROM log_entries")
+        if records:
+            self.duckdb_conn.register('df', df) # Register DataFrame instead of INSERT
+            self.duckdb_conn.execute("INSERT INTO log_entries SELECT * FROM df")
+            self.duckdb_conn.unregister('df') # Unregister after use
+        
+        # Remember which file the rows belong to so a later load can append to them
+        state = self._ingest_state()
+        self.duckdb_conn.execute("DELETE FROM ingest_state")
+        if state.get("source"):
+            self.duckdb_conn.execute("INSERT INTO ingest_state VALUES (?, ?)",
+                                     [state["source"], first_row + len(records)])
 
         self.console.print(f"[bold green]✓[/] Loaded {len(records)} log entries into DuckDB")
 
     def _extract_templates_from_logs(self, parsed_logs: List[Dict[str, Any]]) -> Dict[str, Dict[str, Any]]:
         """Extract templates from parsed logs."""
+        # DRAIN loads keep per-template counts in C++, no need to re-scan records
+        native_templates = self._get_native_templates()
+        if native_templates:
+            return native_templates
+
         templates = {}
         
         # Count occurrences of each template
@@ -303,8 +358,22 @@ The analysis should:
         
         return templates
 
-    def _store_templates_in_duckdb(self, templates: Dict[str, Dict[str, Any]]) -> None:
-        """Store templates in DuckDB."""
+    def _get_native_templates(self) -> Dict[str, Dict[str, Any]]:
+        """Get template counts maintained by the C++ DRAIN parser, if any."""
+        table = self.cpp_wrapper.get_template_stats()
+        templates = {}
+        for template_id, template, count in zip(table['template_id'], table['template'], table['count']):
+            if count == 0:
+                continue
+            templates[str(template_id)] = {
+                'template_id': str(template_id),
+                'template': template,
+                'count': count
+            }
+        return templates
+
+    def _store_templates_in_duckdb(self, templates: Dict[str, Dict[str, Any]], merge: bool = False) -> None:
+        """Store templates in DuckDB, adding to the stored counts if merge is set."""
         import pandas as pd
         
         # Create DataFrame from templates
@@ -312,8 +381,15 @@ The analysis should:
         df = pd.DataFrame(template_records)
         
         # Insert into DuckDB
-        self.duckdb_conn.execute("DELETE FROM log_templates")
-        self.duckdb_conn.execute("INSERT INTO log_templates SELECT * FROM df")
+        if merge:
+            if template_records:
+                self.duckdb_conn.execute("""
+                    INSERT INTO log_templates SELECT * FROM df
+                    ON CONFLICT (template_id) DO UPDATE SET count = log_templates.count + excluded.count
+                """)
+        else:
+            self.duckdb_conn.execute("DELETE FROM log_templates")
+            self.duckdb_conn.execute("INSERT INTO log_templates SELECT * FROM df")
         self.duckdb_conn.unregister('df') # Unregister after use
         
         self.console.print(f"[bold green]✓[/] Stored {len(template_records)} templates in DuckDB")
@@ -407,7 +483,22 @@ The analysis should:
     # --- Tool Methods --- #
 
     def search_logs(self, query: str, limit: int = 100) -> Dict[str, Any]:
-        """Search log messages containing a specific query string."""
+        """Search log messages matching a query.
+
+        Queries are answered from the C++ inverted index when available: words
+        are ANDed, and AND/OR/NOT, parentheses, prefix* and template:<id> are
+        supported. Falls back to a substring scan otherwise.
+        """
+        row_ids = self._index_row_ids(query, limit)
+        if row_ids is not None:
+            result = self._select_rows_by_id("id, timestamp, level, message", row_ids)
+            result['rows'].sort(key=lambda row: row[0], reverse=True)
+            return {
+                "logs": [dict(zip(result['columns'], row)) for row in result['rows']],
+                "count": len(result['rows']),
+                "total_matches": self.cpp_wrapper.count_log_index(query)
+            }
+
         sql = f"""
             SELECT id, timestamp, level, message 
             FROM log_entries 
@@ -422,6 +513,30 @@ The analysis should:
             "count": len(result['rows']) # Note: This is count of returned, not total matching
         }
 
+    def _index_row_ids(self, query: str, limit: int = 0) -> Optional[List[int]]:
+        """Row IDs matching a query from the C++ index, None if the index cannot answer it."""
+        if self.cpp_wrapper.get_log_index_stats()['rows'] == 0:
+            return None
+        try:
+            return self.cpp_wrapper.search_log_index(query, limit)
+        except ValueError:
+            # Not a valid index query, let the caller scan instead
+            return None
+
+    def _select_rows_by_id(self, columns: str, row_ids: List[int], group_by: Optional[str] = None) -> Dict[str, Any]:
+        """Fetch or group log_entries rows by ID without scanning messages."""
+        if not row_ids:
+            return {"columns": [], "rows": []}
+        sql = f"SELECT {columns} FROM log_entries WHERE id IN (SELECT UNNEST(?))"
+        if group_by:
+            sql += f" GROUP BY {group_by} ORDER BY count DESC"
+        try:
+            result = self.duckdb_conn.execute(sql, [row_ids]).fetchdf()
+            return {"columns": result.columns.tolist(), "rows": result.values.tolist()}
+        except Exception as e:
+            self.console.print(f"[bold red]Error executing query:[/] {str(e)}")
+            return {"columns": [], "rows": []}
+
     def get_template(self, template_id: str) -> Optional[Dict[str, Any]]:
         """Get details for a specific log template."""
         sql = f"SELECT template_id, template, count FROM log_templates WHERE template_id = '{template_id}'"
@@ -442,6 +557,15 @@ The analysis should:
 
     def count_occurrences(self, pattern: str, group_by: Optional[str] = None) -> Dict[str, Any]:
         """Count occurrences of a pattern, optionally grouped."""
+        row_ids = self._index_row_ids(pattern)
+        if row_ids is not None:
+            if group_by and group_by in ['level', 'template_id']:
+                result = self._select_rows_by_id(f"{group_by}, COUNT(*) as count", row_ids, group_by)
+                breakdown = {str(row[0]): row[1] for row in result['rows']}
+            else:
+                breakdown = {}
+            return {"total": len(row_ids), "breakdown": breakdown}
+
         where_clause = f"WHERE message LIKE '%{pattern}%'"
         
         if group_by and group_by in ['level', 'template_id']: # Add other valid group_by columns
@@ -474,6 +598,10 @@ The analysis should:
 
     def filter_by_time(self, since: Optional[str] = None, until: Optional[str] = None, limit: int = 100) -> List[Dict[str, Any]]:
         """Filter logs by a time range."""
+        rows = self._query_segments(since=since or "", until=until or "", limit=limit)
+        if rows is not None:
+            return rows
+
         conditions = []
         if since:
             conditions.append(f"timestamp >= '{since}'")
@@ -492,6 +620,10 @@ The analysis should:
 
     def filter_by_level(self, levels: Optional[List[str]] = None, exclude_levels: Optional[List[str]] = None, limit: int = 100) -> List[Dict[str, Any]]:
         """Filter logs by level."""
+        rows = self._query_segments(levels=levels or [], exclude_levels=exclude_levels or [], limit=limit)
+        if rows is not None:
+            return rows
+
         conditions = []
         if levels:
             level_list = ", ".join([f"'{l}'" for l in levels])
@@ -510,6 +642,17 @@ The analysis should:
         result = self.execute_query(sql)
         return [dict(zip(result['columns'], row)) for row in result['rows']] if result else []
 
+    def _query_segments(self, **filters) -> Optional[List[Dict[str, Any]]]:
+        """Filter rows through the C++ segment store, None if it cannot answer."""
+        if self.cpp_wrapper.get_segment_store_stats()['rows'] == 0:
+            return None
+        try:
+            rows = self.cpp_wrapper.query_segments(**filters)
+        except ValueError:
+            # Time format the store does not understand, let DuckDB compare strings
+            return None
+        return [{key: row[key] for key in ('id', 'timestamp', 'level', 'message')} for row in rows]
+
     def calculate_statistics(self) -> Dict[str, Any]:
         """Calculate basic statistics about the logs."""
         # Example: total count, time range, count by level
@@ -528,12 +671,33 @@ The analysis should:
         return stats
 
     def get_trending_patterns(self, time_window: str = "hour") -> List[Dict[str, Any]]:
-        """Identify trending log templates (placeholder)."""
-        # This is complex. A simple placeholder: return top 5 templates by count.
+        """Identify log templates whose rate changed most in the latest time window."""
+        window_seconds = TRENDING_WINDOWS.get(time_window, 3600)
+
+        # DRAIN loads keep per-template time series in C++
+        table = self.cpp_wrapper.get_trending_templates(window_seconds, 5)
+        if table['template_id']:
+            columns = list(table.keys())
+            return [dict(zip(columns, row)) for row in zip(*table.values())]
+
+        # Fallback: top 5 templates by count
         sql = "SELECT template_id, template, count FROM log_templates ORDER BY count DESC LIMIT 5"
         result = self.execute_query(sql)
         return [dict(zip(result['columns'], row)) for row in result['rows']] if result else []
 
+    def detect_anomalies(self, anomaly_type: Optional[str] = None) -> List[Dict[str, Any]]:
+        """List templates that appeared, vanished, spiked or dropped during the load.
+
+        Args:
+            anomaly_type: Optional filter: new_template, vanished_template, spike or drop
+        """
+        table = self.cpp_wrapper.get_template_anomalies()
+        columns = list(table.keys())
+        anomalies = [dict(zip(columns, row)) for row in zip(*table.values())]
+        if anomaly_type:
+            anomalies = [a for a in anomalies if a['type'] == anomaly_type]
+        return anomalies
+
     def analyze_logs(self, analysis_task: str) -> Dict[str, Any]:
         """Perform advanced log analysis using python code.
         
@@ -615,6 +779,7 @@ The analysis should:
             self.filter_by_level,
             self.calculate_statistics,
             self.get_trending_patterns,
+            self.detect_anomalies,
             self.execute_query,
         ]
         
@@ -19,10 +19,39 @@ logging.basicConfig(
 )
 logger = logging.getLogger(__name__)
 
+# Functions of the C++ extension re-exported by this package
+_NATIVE_FUNCTIONS = [
+    "parse_log_file",
+    "get_ingest_state",
+    "process_large_file_with_callback",
+    "get_pipeline_metrics",
+    "get_parse_errors",
+    "get_field_dictionaries",
+    "get_template_stats",
+    "get_all_templates",
+    "get_trending_templates",
+    "get_template_anomalies",
+    "search_log_index",
+    "count_log_index",
+    "get_log_index_stats",
+    "set_segment_store_root",
+    "query_segments",
+    "get_segment_store_stats",
+    "extract_attributes",
+]
+
+
+def _missing_native_function(name: str):
+    """Stand-in for a function the extension does not provide; calling it raises."""
+    def missing(*args, **kwargs):
+        raise ImportError(f"LogAI C++ extension is not loaded or does not provide {name}")
+    missing.__name__ = name
+    return missing
+
+
 # Define default implementations
-parse_log_file = None
-process_large_file_with_callback = None
-extract_attributes = None
+for _name in _NATIVE_FUNCTIONS:
+    globals()[_name] = _missing_native_function(_name)
 
 # Try to import the C++ module first
 try:
@@ -61,22 +90,22 @@ try:
             spec.loader.exec_module(module)
             
             # Import the functions we want to keep from C++
-            try:
-                # Use getattr to access functions from the dynamically loaded module
-                parse_log_file = getattr(module, "parse_log_file")
-                process_large_file_with_callback = getattr(module, "process_large_file_with_callback")
-                extract_attributes = getattr(module, "extract_attributes")
-                
+            missing = [name for name in _NATIVE_FUNCTIONS if not hasattr(module, name)]
+            for name in _NATIVE_FUNCTIONS:
+                if name not in missing:
+                    globals()[name] = getattr(module, name)
+            
+            if missing:
+                logger.error(f"LogAI C++ extension at {extension_path} lacks: {', '.join(missing)}")
+            else:
                 # Log successful import
                 logger.info(f"Successfully loaded LogAI C++ extension from {extension_path}")
-            except AttributeError as e:
-                logger.warning(f"Could not find functions in the extension: {str(e)}")
         else:
-            logger.warning("Failed to create module spec from the extension file")
+            logger.error("Failed to create module spec from the extension file")
     else:
-        logger.warning("LogAI C++ extension not found in any directory")
+        logger.error("LogAI C++ extension not found in any directory")
 except Exception as e:
-    logger.warning(f"Failed to import LogAI C++ extension: {str(e)}")
+    logger.error(f"Failed to import LogAI C++ extension: {str(e)}")
 
 # Import Python implementations
 from .embeddings import generate_template_embedding, GeminiVectorizer
@@ -84,9 +113,7 @@ from .embeddings import generate_template_embedding, GeminiVectorizer
 # Define what should be accessible when importing the package
 __all__ = [
     # C++ functions
-    "parse_log_file",
-    "process_large_file_with_callback",
-    "extract_attributes",
+    *_NATIVE_FUNCTIONS,
     
     # Python implementations for embeddings
     "generate_template_embedding",
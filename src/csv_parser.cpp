@@ -50,7 +50,12 @@ namespace {
     }
 }
 
-CsvParser::CsvParser(const DataLoaderConfig& config) : config_(config) {}
+CsvParser::CsvParser(const DataLoaderConfig& config, std::shared_ptr<FieldSchema> schema)
+    : LogParser(std::move(schema)), config_(config) {
+    for (const auto& dimension : config_.dimensions) {
+        dimension_ids_.push_back(field_schema_->intern(dimension));
+    }
+}
 
 CsvParser::~CsvParser() noexcept = default;
 
@@ -77,28 +82,34 @@ std::optional<std::chrono::system_clock::time_point> parse_timestamp(std::string
 
 LogRecordObject CsvParser::parse_line(const std::string&  line) {
     LogRecordObject record;
-    std::vector<std::string_view> fields = split_line(line);
-
-    // Map fields to record based on config
-    for (size_t i = 0; i < fields.size() && i < config_.dimensions.size(); ++i) {
-        const auto& field = fields[i];
-        const auto& dimension = config_.dimensions[i];
-
-        if (dimension == "body") {
-            record.body = std::string(field);
-        } else if (dimension == "timestamp") {
-            record.timestamp = parse_timestamp(field, config_.datetime_format);
-        } else if (dimension == "severity") {
-            record.severity = std::string(field);
-        } else {
-            // Use set_field method instead of attributes map
-            record.set_field(dimension, std::string(field));
-        }
-    }
-
+    throw_if_failed(try_parse_line(line, record), "CSV");
     return record;
 }
 
+ParseStatus CsvParser::try_parse_line(const std::string& line, LogRecordObject& record) noexcept {
+    return guarded([&] {
+        std::vector<std::string_view> fields = split_line(line);
+        record.fields.reset(field_schema_.get());
+
+        // Map fields to record based on config
+        for (size_t i = 0; i < fields.size() && i < config_.dimensions.size(); ++i) {
+            const auto& field = fields[i];
+            const auto& dimension = config_.dimensions[i];
+
+            if (dimension == "body") {
+                record.body = std::string(field);
+            } else if (dimension == "timestamp") {
+                record.timestamp = parse_timestamp(field, config_.datetime_format);
+            } else if (dimension == "severity") {
+                record.severity = std::string(field);
+            } else {
+                record.set_field(dimension_ids_[i], field);
+            }
+        }
+        return ParseStatus::Ok;
+    });
+}
+
 std::vector<std::string_view> CsvParser::split_line(std::string_view line, char delimiter) {
     std::vector<std::string_view> fields;
     fields.reserve(16);
@@ -136,34 +147,26 @@ std::vector<std::string_view> CsvParser::split_line(std::string_view line, char
 
 LogParser::LogEntry CsvParser::parse(const std::string& line) {
     LogParser::LogEntry entry;
-    try {
-        // Use the existing parse_line implementation to get the LogRecordObject
-        LogRecordObject record = parse_line(line);
-        
-        // Convert LogRecordObject to LogEntry
-        entry.timestamp = record.timestamp ? std::to_string(record.timestamp->time_since_epoch().count()) : "";
-        entry.level = record.severity.value_or("");
-        entry.message = record.body;
-        
-        // Copy fields to entry.fields
-        for (const auto& [key, value] : record.fields) {
-            entry.fields[key.toStdString()] = value.toStdString();
-        }
-    } catch (const std::exception& e) {
-        throw std::runtime_error("Failed to parse CSV line: " + std::string(e.what()));
-    }
-    
+    throw_if_failed(try_parse(line, entry), "CSV");
     return entry;
 }
 
-bool CsvParser::validate(const std::string& line) {
-    try {
-        // Try to parse the line to validate it
-        parse_line(line);
-        return true;
-    } catch (const std::exception&) {
-        return false;
+ParseStatus CsvParser::try_parse(const std::string& line, LogEntry& entry) noexcept {
+    LogRecordObject record;
+    const ParseStatus status = try_parse_line(line, record);
+    if (status != ParseStatus::Ok) {
+        return status;
     }
+    return guarded([&] {
+        entry = LogEntry::from_record(std::move(record));
+        return ParseStatus::Ok;
+    });
+}
+
+bool CsvParser::validate(const std::string& line) {
+    // Try to parse the line to validate it
+    LogRecordObject record;
+    return try_parse_line(line, record) == ParseStatus::Ok;
 }
 
 } 
\ No newline at end of file
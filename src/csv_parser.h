@@ -8,15 +8,18 @@ namespace logai {
 
 class CsvParser : public LogParser {
 public:
-    explicit CsvParser(const DataLoaderConfig& config);
+    explicit CsvParser(const DataLoaderConfig& config, std::shared_ptr<FieldSchema> schema = nullptr);
     ~CsvParser() noexcept override;
     
     LogEntry parse(const std::string& line) override;
     bool validate(const std::string& line) override;
+    ParseStatus try_parse(const std::string& line, LogEntry& entry) noexcept override;
     LogRecordObject parse_line(const std::string& line) override;
+    ParseStatus try_parse_line(const std::string& line, LogRecordObject& record) noexcept override;
 
 private:
     DataLoaderConfig config_;
+    std::vector<FieldSchema::Id> dimension_ids_;  // Interned once, parallel to config_.dimensions
     std::vector<std::string> headers_;
     char delimiter_ = ',';
     
@@ -32,5 +32,6 @@ struct DataLoaderConfig {
     int drain_depth = 4;
     double drain_similarity_threshold = 0.5;
     int drain_max_children = 100;
+    size_t drain_cache_size = 4096;  // Line-shape cache entries, 0 disables the cache
 };
 } 
\ No newline at end of file
@@ -3,16 +3,21 @@
 // ============================================================================
 #include "drain_parser.h"
 #include "log_record.h"
+#include "log_level.h"
+#include "timestamp_utils.h"
 #include "data_loader_config.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cctype>
 #include <cmath>
 #include <sstream>
 #include <iostream>
 #include <chrono>
+#include <limits>
 #include <numeric>
+#include <random>
 #include <memory>
 
 
@@ -70,60 +75,234 @@ bool is_number(std::string_view str) {
     return true;
 }
 
-class RegexCache {
-public:
-    static RegexCache& instance() {
-        static RegexCache cache;
-        return cache;
+/**
+ * Cheap shape signature of a tokenized line: the token count plus a hash of
+ * its non-numeric tokens. Numeric tokens only contribute their position, so
+ * lines that differ in numbers alone share a signature.
+ */
+uint64_t shape_signature(const TokenVector& tokens) {
+    constexpr uint64_t kFnvPrime = 1099511628211ULL;
+    constexpr uint64_t kNumericMarker = 0x9e3779b97f4a7c15ULL;
+
+    uint64_t hash = 14695981039346656037ULL ^ tokens.size();
+    for (std::string_view token : tokens) {
+        if (is_number(token)) {
+            hash = (hash ^ kNumericMarker) * kFnvPrime;
+            continue;
+        }
+        for (unsigned char c : token) {
+            hash = (hash ^ c) * kFnvPrime;
+        }
+        // Token separator so that "ab c" and "a bc" hash differently
+        hash = (hash ^ 0xff) * kFnvPrime;
     }
+    return hash;
+}
 
-    const std::vector<std::regex>& get_default_patterns() const {
-        return default_patterns_;
+/**
+ * Single-pass header scanner used to strip the common log line prefixes
+ * (bracketed tag, timestamps, level word) before tokenization.
+ *
+ * The default shapes are matched by hand-written scanners that never
+ * allocate. Custom patterns set through set_preprocess_patterns are tried
+ * in list order, like the defaults: the first one that matches and leaves
+ * content wins. Every parsed line gets here: the template cache is keyed on
+ * the shape of the stripped tokens, so it can only be consulted afterwards.
+ */
+class PrefixStripper {
+public:
+    static PrefixStripper& instance() {
+        static PrefixStripper stripper;
+        return stripper;
     }
 
     void set_custom_patterns(std::vector<std::regex> patterns) {
-        custom_patterns_ = std::move(patterns);
+        if (patterns.empty()) {
+            has_custom_.store(false, std::memory_order_release);
+            return;
+        }
+        std::atomic_store(&custom_, std::make_shared<const std::vector<std::regex>>(std::move(patterns)));
+        has_custom_.store(true, std::memory_order_release);
     }
 
-    const std::vector<std::regex>& get_patterns() const {
-        // If custom patterns exist, use them; else use default
-        if (!custom_patterns_.empty()) {
-            return custom_patterns_;
+    /**
+     * Number of header bytes to skip. Returns 0 if no prefix matched or the
+     * prefix would consume the whole line.
+     */
+    size_t header_length(std::string_view line) const {
+        if (has_custom_.load(std::memory_order_acquire)) {
+            auto patterns = std::atomic_load(&custom_);
+            std::cmatch match;
+            for (const auto& pattern : *patterns) {
+                if (std::regex_search(line.data(), line.data() + line.size(), match, pattern)) {
+                    size_t content_start = match.position() + match.length();
+                    if (content_start < line.size()) {
+                        return content_start;
+                    }
+                }
+            }
+            return 0;
+        }
+
+        // Same precedence as the former default regex list
+        for (auto scan : {&scan_bracket, &scan_date_time, &scan_time, &scan_level,
+                          &scan_ctime, &scan_iso8601}) {
+            size_t content_start = scan(line);
+            if (content_start != kNoMatch && content_start < line.size()) {
+                return content_start;
+            }
         }
-        return default_patterns_;
+        return 0;
     }
 
 private:
-    RegexCache() {
-        // Some default patterns for trimming timestamps, brackets, etc.
-        default_patterns_.emplace_back(R"(^\[.*?\]\s*)");
-        default_patterns_.emplace_back(R"(^\d{4}[-/]\d{1,2}[-/]\d{1,2}\s+\d{1,2}:\d{1,2}:\d{1,2}(?:\.\d+)?\s+)");
-        default_patterns_.emplace_back(R"(^\d{1,2}:\d{1,2}:\d{1,2}(?:\.\d+)?\s+)");
-        default_patterns_.emplace_back(R"((?i)^\s*(?:ERROR|WARN(?:ING)?|INFO|DEBUG|TRACE|FATAL)\s*:?\s*)");
-        default_patterns_.emplace_back(R"(^\w+\s+\w+\s+\d+\s+\d{2}:\d{2}:\d{2}\s+\d{4}\s+)");
-        default_patterns_.emplace_back(R"(^\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}(?:\.\d+)?(?:Z|[+-]\d{2}:?\d{2})?\s+)");
-    }
-
-    std::vector<std::regex> default_patterns_;
-    std::vector<std::regex> custom_patterns_;
-};
+    static constexpr size_t kNoMatch = std::string_view::npos;
 
-// Preprocess log using regex patterns
-std::string_view preprocess_log(std::string_view line) {
-    const auto& patterns = RegexCache::instance().get_patterns();
-    // We work on a temporary std::string to run regex searches
-    std::string line_str(line);
-
-    for (const auto& pattern : patterns) {
-        std::smatch match;
-        if (std::regex_search(line_str, match, pattern)) {
-            size_t content_start = match.position() + match.length();
-            if (content_start < line.size()) {
-                return line.substr(content_start);
+    static bool is_digit(char c) { return c >= '0' && c <= '9'; }
+    static bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v'; }
+    static bool is_word(char c) { return is_digit(c) || c == '_' || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z'); }
+
+    // Consume between min and max digits, returning kNoMatch if fewer than min
+    static size_t digits(std::string_view s, size_t pos, size_t min, size_t max) {
+        size_t n = 0;
+        while (pos + n < s.size() && n < max && is_digit(s[pos + n])) ++n;
+        return n >= min ? pos + n : kNoMatch;
+    }
+
+    static size_t spaces(std::string_view s, size_t pos, size_t min) {
+        size_t n = 0;
+        while (pos + n < s.size() && is_space(s[pos + n])) ++n;
+        return n >= min ? pos + n : kNoMatch;
+    }
+
+    static size_t literal(std::string_view s, size_t pos, char c) {
+        return pos < s.size() && s[pos] == c ? pos + 1 : kNoMatch;
+    }
+
+    static size_t one_of(std::string_view s, size_t pos, char a, char b) {
+        return pos < s.size() && (s[pos] == a || s[pos] == b) ? pos + 1 : kNoMatch;
+    }
+
+    static size_t word(std::string_view s, size_t pos) {
+        size_t start = pos;
+        while (pos < s.size() && is_word(s[pos])) ++pos;
+        return pos > start ? pos : kNoMatch;
+    }
+
+    // Optional fractional seconds: (?:\.\d+)?
+    static size_t fraction(std::string_view s, size_t pos) {
+        if (pos < s.size() && s[pos] == '.') {
+            size_t end = digits(s, pos + 1, 1, kNoMatch);
+            if (end != kNoMatch) return end;
+        }
+        return pos;
+    }
+
+    // h:m:s with 1-2 digit fields and optional fraction
+    static size_t clock(std::string_view s, size_t pos, size_t min_digits) {
+        size_t max_digits = 2;
+        if ((pos = digits(s, pos, min_digits, max_digits)) == kNoMatch) return kNoMatch;
+        if ((pos = literal(s, pos, ':')) == kNoMatch) return kNoMatch;
+        if ((pos = digits(s, pos, min_digits, max_digits)) == kNoMatch) return kNoMatch;
+        if ((pos = literal(s, pos, ':')) == kNoMatch) return kNoMatch;
+        return digits(s, pos, min_digits, max_digits);
+    }
+
+    // ^\[.*?\]\s*
+    static size_t scan_bracket(std::string_view s) {
+        if (s.empty() || s[0] != '[') return kNoMatch;
+        size_t close = s.find(']', 1);
+        if (close == std::string_view::npos) return kNoMatch;
+        return spaces(s, close + 1, 0);
+    }
+
+    // ^\d{4}[-/]\d{1,2}[-/]\d{1,2}\s+\d{1,2}:\d{1,2}:\d{1,2}(?:\.\d+)?\s+
+    static size_t scan_date_time(std::string_view s) {
+        size_t pos = 0;
+        if ((pos = digits(s, pos, 4, 4)) == kNoMatch) return kNoMatch;
+        if ((pos = one_of(s, pos, '-', '/')) == kNoMatch) return kNoMatch;
+        if ((pos = digits(s, pos, 1, 2)) == kNoMatch) return kNoMatch;
+        if ((pos = one_of(s, pos, '-', '/')) == kNoMatch) return kNoMatch;
+        if ((pos = digits(s, pos, 1, 2)) == kNoMatch) return kNoMatch;
+        if ((pos = spaces(s, pos, 1)) == kNoMatch) return kNoMatch;
+        if ((pos = clock(s, pos, 1)) == kNoMatch) return kNoMatch;
+        return spaces(s, fraction(s, pos), 1);
+    }
+
+    // ^\d{1,2}:\d{1,2}:\d{1,2}(?:\.\d+)?\s+
+    static size_t scan_time(std::string_view s) {
+        size_t pos = clock(s, 0, 1);
+        if (pos == kNoMatch) return kNoMatch;
+        return spaces(s, fraction(s, pos), 1);
+    }
+
+    // ^\s*(?:ERROR|WARN(?:ING)?|INFO|DEBUG|TRACE|FATAL)\s*:?\s*, case-insensitive,
+    // requiring a word boundary after the level so "Information" is left alone
+    static size_t scan_level(std::string_view s) {
+        static constexpr std::string_view kLevels[] = {
+            "ERROR", "WARNING", "WARN", "INFO", "DEBUG", "TRACE", "FATAL"};
+        size_t pos = spaces(s, 0, 0);
+        for (std::string_view level : kLevels) {
+            if (s.size() - pos < level.size()) continue;
+            bool equal = true;
+            for (size_t i = 0; i < level.size() && equal; ++i) {
+                equal = (s[pos + i] & ~0x20) == level[i];
             }
+            size_t end = pos + level.size();
+            if (!equal || (end < s.size() && is_word(s[end]))) continue;
+            end = spaces(s, end, 0);
+            if (end < s.size() && s[end] == ':') ++end;
+            return spaces(s, end, 0);
         }
+        return kNoMatch;
+    }
+
+    // ^\w+\s+\w+\s+\d+\s+\d{2}:\d{2}:\d{2}\s+\d{4}\s+  (e.g. "Mon Mar 24 10:15:30 2024 ")
+    static size_t scan_ctime(std::string_view s) {
+        size_t pos = 0;
+        if ((pos = word(s, pos)) == kNoMatch) return kNoMatch;
+        if ((pos = spaces(s, pos, 1)) == kNoMatch) return kNoMatch;
+        if ((pos = word(s, pos)) == kNoMatch) return kNoMatch;
+        if ((pos = spaces(s, pos, 1)) == kNoMatch) return kNoMatch;
+        if ((pos = digits(s, pos, 1, kNoMatch)) == kNoMatch) return kNoMatch;
+        if ((pos = spaces(s, pos, 1)) == kNoMatch) return kNoMatch;
+        if ((pos = clock(s, pos, 2)) == kNoMatch) return kNoMatch;
+        if ((pos = spaces(s, pos, 1)) == kNoMatch) return kNoMatch;
+        if ((pos = digits(s, pos, 4, 4)) == kNoMatch) return kNoMatch;
+        return spaces(s, pos, 1);
     }
-    return line;
+
+    // ^\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}(?:\.\d+)?(?:Z|[+-]\d{2}:?\d{2})?\s+
+    static size_t scan_iso8601(std::string_view s) {
+        size_t pos = 0;
+        if ((pos = digits(s, pos, 4, 4)) == kNoMatch) return kNoMatch;
+        if ((pos = literal(s, pos, '-')) == kNoMatch) return kNoMatch;
+        if ((pos = digits(s, pos, 2, 2)) == kNoMatch) return kNoMatch;
+        if ((pos = literal(s, pos, '-')) == kNoMatch) return kNoMatch;
+        if ((pos = digits(s, pos, 2, 2)) == kNoMatch) return kNoMatch;
+        if ((pos = literal(s, pos, 'T')) == kNoMatch) return kNoMatch;
+        if ((pos = clock(s, pos, 2)) == kNoMatch) return kNoMatch;
+        pos = fraction(s, pos);
+        if (pos < s.size() && s[pos] == 'Z') {
+            ++pos;
+        } else if (pos < s.size() && (s[pos] == '+' || s[pos] == '-')) {
+            size_t zone = digits(s, pos + 1, 2, 2);
+            if (zone != kNoMatch && zone < s.size() && s[zone] == ':') ++zone;
+            if (zone != kNoMatch) zone = digits(s, zone, 2, 2);
+            if (zone != kNoMatch) pos = zone;
+        }
+        return spaces(s, pos, 1);
+    }
+
+    PrefixStripper() = default;
+
+    std::atomic<bool> has_custom_{false};
+    std::shared_ptr<const std::vector<std::regex>> custom_;
+};
+
+// Strip the log header (timestamps, level, bracketed tags) from a line
+std::string_view preprocess_log(std::string_view line) {
+    return line.substr(PrefixStripper::instance().header_length(line));
 }
 
 } // namespace detail
@@ -133,12 +312,43 @@ std::string_view preprocess_log(std::string_view line) {
 // DRAIN Structures
 // ============================================================================
 
+/**
+ * Per-cluster counters, updated lock-free from the parse hot path
+ */
+struct ClusterStats {
+    std::atomic<uint64_t> count{0};
+    std::atomic<int64_t> first_seen_ms{std::numeric_limits<int64_t>::max()};
+    std::atomic<int64_t> last_seen_ms{std::numeric_limits<int64_t>::min()};
+    std::array<std::atomic<uint64_t>, kLogLevelCount> level_counts{};
+
+    void record(int64_t timestamp_ms, LogLevel level) {
+        count.fetch_add(1, std::memory_order_relaxed);
+        level_counts[static_cast<size_t>(level)].fetch_add(1, std::memory_order_relaxed);
+
+        int64_t first = first_seen_ms.load(std::memory_order_relaxed);
+        while (timestamp_ms < first &&
+               !first_seen_ms.compare_exchange_weak(first, timestamp_ms, std::memory_order_relaxed)) {
+        }
+        int64_t last = last_seen_ms.load(std::memory_order_relaxed);
+        while (timestamp_ms > last &&
+               !last_seen_ms.compare_exchange_weak(last, timestamp_ms, std::memory_order_relaxed)) {
+        }
+    }
+};
+
 struct LogCluster {
     int id;
     std::string log_template;
     detail::TokenVector tokens;
     folly::F14FastSet<size_t> parameter_indices;
     std::vector<std::pair<std::string, std::string>> attributes;
+    // Bumped whenever the template generalizes, so shape cache entries
+    // resolved against an older template can be detected as stale
+    uint32_t version = 0;
+    ClusterStats stats;
+    // Code of id in the cluster_id dictionary, kNotEncoded until the first record of the cluster
+    static constexpr uint32_t kNotEncoded = std::numeric_limits<uint32_t>::max();
+    std::atomic<uint32_t> id_code{kNotEncoded};
 
     explicit LogCluster(int id_, const detail::TokenVector& tok)
         : id(id_), tokens(tok)
@@ -160,6 +370,16 @@ struct Node {
     folly::small_vector<std::shared_ptr<LogCluster>, 8> clusters;
 };
 
+/**
+ * Shape cache entry: the cluster a line shape resolved to, stamped with the
+ * cluster version and tree generation it was resolved against.
+ */
+struct ShapeCacheEntry {
+    std::shared_ptr<LogCluster> cluster;
+    uint32_t cluster_version;
+    uint64_t tree_generation;
+};
+
 // ============================================================================
 // DrainParserImpl
 // ============================================================================
@@ -173,9 +393,14 @@ public:
     };
 
 public:
-    DrainParserImpl(int depth, double similarity_threshold, int max_children)
-        : root_(std::make_shared<Node>()),
-          cluster_id_counter_(0)
+    DrainParserImpl(int depth, double similarity_threshold, int max_children, size_t cache_size,
+                    std::shared_ptr<FieldSchema> schema)
+        : field_schema_(std::move(schema)),
+          source_code_(field_schema_->dictionary(FieldSchema::kSource).encode("log")),
+          root_(std::make_shared<Node>()),
+          cluster_id_counter_(0),
+          cache_capacity_(cache_size),
+          model_id_((static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}())
     {
         // Initialize our internal DRAIN config
         auto conf = drain_config_.wlock();
@@ -186,6 +411,7 @@ public:
 
     LogRecordObject parse(std::string_view line, const DataLoaderConfig& user_cfg) {
         LogRecordObject record;
+        record.fields.reset(field_schema_.get());
         record.body = std::string(line);
 
         // Preprocess and tokenize
@@ -196,7 +422,22 @@ public:
         auto matched_cluster = match_log_message(tokens);
 
         record.template_str = matched_cluster->log_template;
-        record.fields["cluster_id"] = std::to_string(matched_cluster->id);
+        set_cluster_id(record, *matched_cluster);
+
+        // Per-cluster statistics, keyed on the line's own timestamp when it has one
+        LogLevel level = detect_log_level(line);
+        auto timestamp_ms = parse_epoch_millis(line);
+        const int64_t event_ms = timestamp_ms ? *timestamp_ms : now_epoch_millis();
+        matched_cluster->stats.record(event_ms, level);
+        if (time_series_) {
+            time_series_->record(matched_cluster->id, event_ms);
+        }
+        if (timestamp_ms) {
+            record.timestamp = time_point_from_millis(*timestamp_ms);
+        }
+        if (level != LogLevel::Unknown) {
+            record.level = log_level_name(level);
+        }
 
         // Extract attributes from the log line
         extract_attributes(tokens, matched_cluster->parameter_indices, matched_cluster->attributes);
@@ -206,6 +447,21 @@ public:
         return record;
     }
 
+    // cluster_id field of record; the ID is encoded once per cluster, not once per line
+    void set_cluster_id(LogRecordObject& record, LogCluster& cluster) {
+        uint32_t code = cluster.id_code.load(std::memory_order_relaxed);
+        if (code == LogCluster::kNotEncoded) {
+            auto encoded = field_schema_->dictionary(FieldSchema::kClusterId).encode(std::to_string(cluster.id));
+            if (!encoded) {
+                record.set_field(FieldSchema::kClusterId, std::to_string(cluster.id));
+                return;
+            }
+            code = *encoded;
+            cluster.id_code.store(code, std::memory_order_relaxed);
+        }
+        record.fields.set_code(FieldSchema::kClusterId, code);
+    }
+
     int get_cluster_id_for_log(std::string_view line) const {
         std::string_view content = detail::preprocess_log(line);
         auto tokens = detail::tokenize(content);
@@ -214,10 +470,9 @@ public:
     }
 
     std::optional<int> get_cluster_id_from_record(const LogRecordObject& record) const {
-        auto it = record.fields.find("cluster_id");
-        if (it != record.fields.end()) {
+        if (const auto* cluster_id = record.fields.find(FieldSchema::kClusterId)) {
             try {
-                return std::stoi(it->second.toStdString());
+                return std::stoi(cluster_id->toStdString());
             } catch (const std::exception& e) {
                 spdlog::error("Error converting cluster_id: {}", e.what());
             }
@@ -228,11 +483,13 @@ public:
     void set_depth(int depth) {
         auto conf = drain_config_.wlock();
         conf->depth = depth;
+        tree_generation_.fetch_add(1);
     }
 
     void set_similarity_threshold(double threshold) {
         auto conf = drain_config_.wlock();
         conf->similarity_threshold = threshold;
+        tree_generation_.fetch_add(1);
     }
 
     std::optional<std::string> get_template_for_cluster_id(int cluster_id) const {
@@ -263,7 +520,8 @@ public:
                 spdlog::error("Invalid regex pattern: {} - {}", pattern_str, e.what());
             }
         }
-        detail::RegexCache::instance().set_custom_patterns(std::move(patterns));
+        detail::PrefixStripper::instance().set_custom_patterns(std::move(patterns));
+        tree_generation_.fetch_add(1);
     }
 
     folly::F14FastMap<int, std::string> get_all_templates() const {
@@ -271,26 +529,90 @@ public:
         return *tmpl_map;
     }
 
+    std::vector<TemplateStats> get_template_stats() const {
+        std::vector<TemplateStats> table;
+        {
+            auto clusters = clusters_.rlock();
+            auto tmpl_map = templates_.rlock();
+            table.reserve(clusters->size());
+            for (const auto& [id, cluster] : *clusters) {
+                TemplateStats row;
+                row.cluster_id = id;
+                auto tmpl_it = tmpl_map->find(id);
+                if (tmpl_it != tmpl_map->end()) {
+                    row.template_str = tmpl_it->second;
+                }
+                row.count = cluster->stats.count.load(std::memory_order_relaxed);
+                row.first_seen_ms = cluster->stats.first_seen_ms.load(std::memory_order_relaxed);
+                row.last_seen_ms = cluster->stats.last_seen_ms.load(std::memory_order_relaxed);
+                for (size_t i = 0; i < kLogLevelCount; ++i) {
+                    row.level_counts[i] = cluster->stats.level_counts[i].load(std::memory_order_relaxed);
+                }
+                if (row.count == 0) {
+                    row.first_seen_ms = row.last_seen_ms = 0;
+                }
+                table.push_back(std::move(row));
+            }
+        }
+        std::sort(table.begin(), table.end(),
+                  [](const TemplateStats& a, const TemplateStats& b) { return a.cluster_id < b.cluster_id; });
+        return table;
+    }
+
+    void set_time_series(std::shared_ptr<TemplateTimeSeries> series) {
+        time_series_ = std::move(series);
+    }
+
+    std::shared_ptr<TemplateTimeSeries> get_time_series() const {
+        return time_series_;
+    }
+
+    uint64_t model_id() const {
+        return model_id_;
+    }
+
+    uint64_t model_generation() const {
+        return tree_generation_.load(std::memory_order_relaxed);
+    }
+
+    DrainCacheStats get_cache_stats() const {
+        DrainCacheStats stats;
+        stats.hits = cache_hits_.load(std::memory_order_relaxed);
+        stats.misses = cache_misses_.load(std::memory_order_relaxed);
+        stats.invalidations = cache_invalidations_.load(std::memory_order_relaxed);
+        auto root_lock = root_.rlock();
+        stats.entries = shape_cache_.size();
+        return stats;
+    }
+
 private:
     /**
      * Match or create a LogCluster for the tokenized log line.
      */
     std::shared_ptr<LogCluster> match_log_message(const detail::TokenVector& tokens) {
-        // If empty, treat as a special cluster
-        if (tokens.empty()) {
-            auto empty_cluster = std::make_shared<LogCluster>(
-                cluster_id_counter_.fetch_add(1),
-                detail::TokenVector{std::string_view("<EMPTY>")}
-            );
-            auto lock_t = templates_.wlock();
-            (*lock_t)[empty_cluster->id] = empty_cluster->log_template;
-            return empty_cluster;
-        }
-
         // Lock for writing the root
         auto root_lock = root_.wlock();
         auto drain_conf = drain_config_.rlock();
 
+        // If empty, treat as a special cluster shared by all empty lines
+        if (tokens.empty()) {
+            if (!empty_cluster_) {
+                empty_cluster_ = std::make_shared<LogCluster>(
+                    cluster_id_counter_.fetch_add(1),
+                    detail::TokenVector{std::string_view("<EMPTY>")}
+                );
+                register_cluster(empty_cluster_);
+            }
+            return empty_cluster_;
+        }
+
+        // 0) Fast path: a line shape seen before goes straight to its cluster
+        const uint64_t signature = detail::shape_signature(tokens);
+        if (auto cached = lookup_shape_cache(signature, tokens, drain_conf->similarity_threshold)) {
+            update_template(cached, tokens);
+            return cached;
+        }
+
         // 1) Match by token count at top level
         auto current_node = *root_lock;
         std::string length_key = std::to_string(tokens.size());
@@ -349,9 +671,13 @@ private:
 
         // 4) If no match, create
         if (!matched_cluster) {
-            matched_cluster = std::make_shared<LogCluster>(cluster_id_counter_.fetch_add(1), tokens);
+            matched_cluster = std::make_shared<LogCluster>(cluster_id_counter_.fetch_add(1),
+                                                           intern_tokens(tokens));
             extract_parameters(tokens, matched_cluster);
             current_node->clusters.push_back(matched_cluster);
+            register_cluster(matched_cluster);
+            // A new cluster may be a better match for shapes cached in this leaf
+            tree_generation_.fetch_add(1);
         } else {
             // Update the cluster's template if needed
             update_template(matched_cluster, tokens);
@@ -363,9 +689,79 @@ private:
             (*lock_t)[matched_cluster->id] = matched_cluster->log_template;
         }
 
+        remember_shape(signature, matched_cluster);
         return matched_cluster;
     }
 
+    /**
+     * Look up a line shape in the cache. A hit is only returned if the entry
+     * is still current and the cluster still meets the similarity threshold.
+     * Must be called with the root write lock held.
+     */
+    std::shared_ptr<LogCluster> lookup_shape_cache(uint64_t signature,
+                                                   const detail::TokenVector& tokens,
+                                                   double similarity_threshold)
+    {
+        if (cache_capacity_ == 0) {
+            return nullptr;
+        }
+
+        auto it = shape_cache_.find(signature);
+        if (it == shape_cache_.end()) {
+            cache_misses_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        const ShapeCacheEntry& entry = it->second;
+        if (entry.tree_generation != tree_generation_.load(std::memory_order_relaxed) ||
+            entry.cluster_version != entry.cluster->version ||
+            calculate_similarity(entry.cluster->tokens, tokens) < similarity_threshold)
+        {
+            shape_cache_.erase(it);
+            cache_invalidations_.fetch_add(1, std::memory_order_relaxed);
+            cache_misses_.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        cache_hits_.fetch_add(1, std::memory_order_relaxed);
+        return entry.cluster;
+    }
+
+    /**
+     * Record the cluster a line shape resolved to. Must be called with the
+     * root write lock held, after the cluster template has been updated.
+     */
+    void remember_shape(uint64_t signature, const std::shared_ptr<LogCluster>& cluster) {
+        if (cache_capacity_ == 0) {
+            return;
+        }
+        if (shape_cache_.size() >= cache_capacity_ && shape_cache_.find(signature) == shape_cache_.end()) {
+            // Bounded: start over rather than track recency on the hot path
+            cache_invalidations_.fetch_add(shape_cache_.size(), std::memory_order_relaxed);
+            shape_cache_.clear();
+        }
+        shape_cache_[signature] = ShapeCacheEntry{
+            cluster, cluster->version, tree_generation_.load(std::memory_order_relaxed)};
+    }
+
+    void register_cluster(const std::shared_ptr<LogCluster>& cluster) {
+        clusters_.wlock()->emplace(cluster->id, cluster);
+        templates_.wlock()->emplace(cluster->id, cluster->log_template);
+    }
+
+    /**
+     * Copy tokens into the string pool so a cluster never refers to the
+     * memory of the line it was created from.
+     */
+    detail::TokenVector intern_tokens(const detail::TokenVector& tokens) {
+        detail::TokenVector interned;
+        interned.reserve(tokens.size());
+        for (std::string_view token : tokens) {
+            interned.push_back(token_pool_.intern(token));
+        }
+        return interned;
+    }
+
     /**
      * Find existing cluster that best matches the tokens. Does NOT create a new cluster.
      */
@@ -450,15 +846,18 @@ private:
 
         if (cluster->tokens.empty()) {
             // Just copy directly
-            cluster->tokens = tokens;
+            cluster->tokens = intern_tokens(tokens);
             extract_parameters(tokens, cluster);
             cluster->update_template();
+            ++cluster->version;
             return;
         }
 
+        bool generalized = false;
         size_t min_sz = std::min(cluster->tokens.size(), tokens.size());
         for (size_t i = 0; i < min_sz; ++i) {
             if (cluster->tokens[i] != tokens[i] && cluster->tokens[i] != WILDCARD) {
+                generalized = true;
                 // If both numeric, wildcard them
                 if (detail::is_number(cluster->tokens[i]) &&
                     detail::is_number(tokens[i]))
@@ -473,7 +872,11 @@ private:
                 }
             }
         }
+        if (!generalized) {
+            return;
+        }
         cluster->update_template();
+        ++cluster->version;
 
         // Update the templates map
         auto lock_t = templates_.wlock();
@@ -502,7 +905,11 @@ private:
     {
         try {
             // Just fill in a dummy source
-            record.fields["source"] = "log";
+            if (source_code_) {
+                record.fields.set_code(FieldSchema::kSource, *source_code_);
+            } else {
+                record.set_field(FieldSchema::kSource, "log");
+            }
 
             // If the line starts with something that looks like a timestamp
             if (!line.empty()) {
@@ -512,7 +919,7 @@ private:
                     if (maybe_ts.find(':') != std::string_view::npos ||
                         maybe_ts.find('-') != std::string_view::npos)
                     {
-                        record.fields["detected_timestamp"] = std::string(maybe_ts);
+                        record.set_field(FieldSchema::kDetectedTimestamp, maybe_ts);
                     }
                 }
             }
@@ -535,6 +942,10 @@ private:
     }
 
 private:
+    // Schema of the records, and the code of their constant source value in it
+    std::shared_ptr<FieldSchema> field_schema_;
+    std::optional<ValueDictionary::Code> source_code_;
+
     // A thread-safe structure for the DRAIN configuration:
     folly::Synchronized<DrainConfig> drain_config_{{
         /*depth=*/4, /*similarity_threshold=*/0.5, /*max_children=*/100
@@ -550,44 +961,53 @@ private:
     folly::Synchronized<folly::F14FastMap<int, std::string>> templates_;
 
     folly::Synchronized<folly::F14FastMap<int, std::shared_ptr<LogCluster>>> clusters_;
+
+    // Backing storage for cluster tokens (guarded by the root lock)
+    StringPool token_pool_;
+
+    // Cluster shared by all empty lines (guarded by the root lock)
+    std::shared_ptr<LogCluster> empty_cluster_;
+
+    // Optional per-template time series fed from parse (set before parsing)
+    std::shared_ptr<TemplateTimeSeries> time_series_;
+
+    // Line-shape cache in front of the tree descent (guarded by the root lock)
+    folly::F14FastMap<uint64_t, ShapeCacheEntry> shape_cache_;
+    size_t cache_capacity_;
+    uint64_t model_id_;  // Random per model instance, identifies it in ingest checkpoints
+    std::atomic<uint64_t> tree_generation_{0};
+    std::atomic<uint64_t> cache_hits_{0};
+    std::atomic<uint64_t> cache_misses_{0};
+    std::atomic<uint64_t> cache_invalidations_{0};
 };
 
 // ============================================================================
 // DrainParser methods
 // ============================================================================
 
-DrainParser::DrainParser(const DataLoaderConfig& config)
-    : user_config_(config),
+DrainParser::DrainParser(const DataLoaderConfig& config, std::shared_ptr<FieldSchema> schema)
+    : LogParser(std::move(schema)),
+      user_config_(config),
       impl_(std::make_unique<DrainParserImpl>(
           config.drain_depth,
           config.drain_similarity_threshold,
-          config.drain_max_children))
+          config.drain_max_children,
+          config.drain_cache_size,
+          field_schema_))
 {
 }
 
 DrainParser::~DrainParser() noexcept = default;
 
 LogParser::LogEntry DrainParser::parse(const std::string& line) {
-    LogParser::LogEntry entry;
-    entry.message = line;  // Store the raw line as message
-    auto record = parse_line(line);
-    
-    // Convert LogRecordObject to LogEntry fields
-    for (const auto& [key, value] : record.fields) {
-        entry.fields[std::string(key)] = std::string(value);
-    }
-    
-    // Try to extract timestamp and level if available
-    auto ts_it = record.fields.find("detected_timestamp");
-    if (ts_it != record.fields.end()) {
-        entry.timestamp = std::string(ts_it->second);
-    }
-    
-    auto level_it = record.fields.find("level");
-    if (level_it != record.fields.end()) {
-        entry.level = std::string(level_it->second);
-    }
-    
+    // The record's body is the raw line, which becomes the message
+    auto entry = LogEntry::from_record(parse_line(line));
+
+    // The timestamp as written in the line, if one was detected
+    if (const auto* detected = entry.fields.find(FieldSchema::kDetectedTimestamp)) {
+        entry.timestamp = detected->toStdString();
+    }
+
     return entry;
 }
 
@@ -596,7 +1016,17 @@ bool DrainParser::validate(const std::string& line) {
 }
 
 LogRecordObject DrainParser::parse_line(const std::string& line) {
-    return impl_->parse(line, user_config_);
+    LogRecordObject record;
+    throw_if_failed(try_parse_line(line, record), "DRAIN");
+    return record;
+}
+
+ParseStatus DrainParser::try_parse_line(const std::string& line, LogRecordObject& record) noexcept {
+    // Every line fits some template, so only an allocation can fail
+    return guarded([&] {
+        record = impl_->parse(line, user_config_);
+        return ParseStatus::Ok;
+    });
 }
 
 void DrainParser::setDepth(int depth) {
@@ -619,6 +1049,10 @@ int DrainParser::get_cluster_id_for_log(std::string_view line) const {
     return impl_->get_cluster_id_for_log(line);
 }
 
+std::vector<TemplateStats> DrainParser::get_template_stats() const {
+    return impl_->get_template_stats();
+}
+
 std::vector<std::pair<std::string, std::string>> DrainParser::get_template_attributes(int cluster_id) const {
     return impl_->get_template_attributes(cluster_id);
 }
@@ -631,4 +1065,24 @@ std::optional<int> DrainParser::get_cluster_id_from_record(const LogRecordObject
     return impl_->get_cluster_id_from_record(record);
 }
 
+void DrainParser::set_time_series(std::shared_ptr<TemplateTimeSeries> series) {
+    impl_->set_time_series(std::move(series));
+}
+
+std::shared_ptr<TemplateTimeSeries> DrainParser::get_time_series() const {
+    return impl_->get_time_series();
+}
+
+DrainCacheStats DrainParser::get_cache_stats() const {
+    return impl_->get_cache_stats();
+}
+
+uint64_t DrainParser::model_id() const {
+    return impl_->model_id();
+}
+
+uint64_t DrainParser::model_generation() const {
+    return impl_->model_generation();
+}
+
 } // namespace logai
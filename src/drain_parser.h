@@ -7,10 +7,15 @@
 #include <vector>
 #include <memory>
 #include <optional>
+#include <array>
+#include <cstdint>
+#include <string_view>
 #include <folly/FBString.h>
 #include <folly/container/F14Map.h>
 #include <folly/container/F14Set.h>
 #include "log_parser.h"
+#include "log_level.h"
+#include "template_time_series.h"
 #include "data_loader_config.h"
 
 namespace logai {
@@ -39,7 +44,36 @@ public:
     }
 
 private:
-    folly::F14FastSet<std::string> pool_;
+    // Node storage keeps interned strings at a stable address across rehashes,
+    // which the returned string_views rely on.
+    folly::F14NodeSet<std::string> pool_;
+};
+
+/**
+ * Hit/miss counters for the DRAIN template match cache
+ */
+struct DrainCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t invalidations = 0;
+    size_t entries = 0;
+
+    double hit_rate() const {
+        const uint64_t lookups = hits + misses;
+        return lookups > 0 ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+/**
+ * Occurrence statistics for one DRAIN template, maintained while parsing
+ */
+struct TemplateStats {
+    int cluster_id = -1;
+    std::string template_str;
+    uint64_t count = 0;
+    int64_t first_seen_ms = 0;  // Epoch millis of the earliest occurrence
+    int64_t last_seen_ms = 0;   // Epoch millis of the latest occurrence
+    std::array<uint64_t, kLogLevelCount> level_counts{};  // Indexed by LogLevel
 };
 
 /**
@@ -50,8 +84,9 @@ public:
     /**
      * Constructor for DrainParser
      * @param config Configuration for the parser
+     * @param schema Schema of the records, whose dictionaries encode cluster IDs; null selects FieldSchema::shared_default()
      */
-    explicit DrainParser(const DataLoaderConfig& config);
+    explicit DrainParser(const DataLoaderConfig& config, std::shared_ptr<FieldSchema> schema = nullptr);
     ~DrainParser() override;
 
     // Implement pure virtual methods from LogParser
@@ -59,6 +94,7 @@ public:
     bool validate(const std::string& line) override;
 
     LogRecordObject parse_line(const std::string& line) override;
+    ParseStatus try_parse_line(const std::string& line, LogRecordObject& record) noexcept override;
 
     /**
      * Set the maximum depth of the parse tree
@@ -72,6 +108,10 @@ public:
 
     /**
      * Set custom regex patterns for log preprocessing
+     *
+     * They replace the default header patterns. Patterns are tried in list
+     * order and the first one that matches, leaving some of the line,
+     * decides the header that is stripped. Invalid patterns are skipped.
      */
     void set_preprocess_patterns(const std::vector<std::string>& pattern_strings);
 
@@ -107,6 +147,39 @@ public:
         return get_all_templates();
     }
 
+    /**
+     * Get occurrence counts, first/last seen timestamps and per-level counts
+     * for every template, ordered by cluster ID
+     */
+    std::vector<TemplateStats> get_template_stats() const;
+
+    /**
+     * Feed every parsed line into a time series of per-template counts.
+     * Must be set before parsing starts; pass nullptr to detach.
+     */
+    void set_time_series(std::shared_ptr<TemplateTimeSeries> series);
+
+    /**
+     * Get the attached time series, if any
+     */
+    std::shared_ptr<TemplateTimeSeries> get_time_series() const;
+
+    /**
+     * Get hit-rate counters for the line-shape template match cache
+     */
+    DrainCacheStats get_cache_stats() const;
+
+    /**
+     * Random identifier of this model instance; cluster IDs are only
+     * comparable between parses that report the same model ID
+     */
+    uint64_t model_id() const;
+
+    /**
+     * Number of structural model changes (new clusters, settings) so far
+     */
+    uint64_t model_generation() const;
+
 private:
     // Implementation (PIMPL)
     std::unique_ptr<DrainParserImpl> impl_;
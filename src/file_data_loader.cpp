@@ -18,8 +18,12 @@
 #include "json_parser.h"
 #include "regex_parser.h"
 #include "drain_parser.h"
+#include "parallel_decompressor.h"
+#include "uring_file_reader.h"
+#include "windowed_mapped_file.h"
 #include "simd_scanner.h"
 #include "preprocessor.h"
+#include "reorder_buffer.h"
 #include <spdlog/spdlog.h>
 #include <algorithm>
 #include <chrono>
@@ -37,13 +41,9 @@
 #include <sys/stat.h>   // For stat
 #include <unistd.h>     // For close
 #include <regex>
+#include <cstring>
 #include <zlib.h>
 #include <boost/algorithm/string.hpp>
-#include <boost/iostreams/filtering_streambuf.hpp>
-#include <boost/iostreams/copy.hpp>
-#include <boost/iostreams/filter/gzip.hpp>
-#include <boost/iostreams/filter/bzip2.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
 #include <folly/String.h>
 #include <folly/FBVector.h>
 #include <folly/container/F14Map.h>
@@ -61,6 +61,47 @@ constexpr char SPAN_ID[] = "span_id";
 constexpr char LOG_TIMESTAMPS[] = "timestamp";
 constexpr char LABELS[] = "labels";
 
+namespace {
+
+// Lets each worker hold its own LogParser handle onto one shared,
+// thread-safe parser instance
+class SharedLogParser : public LogParser {
+public:
+    explicit SharedLogParser(std::shared_ptr<LogParser> parser)
+        : LogParser(parser->field_schema()), parser_(std::move(parser)) {}
+
+    LogEntry parse(const std::string& line) override { return parser_->parse(line); }
+    bool validate(const std::string& line) override { return parser_->validate(line); }
+    LogRecordObject parse_line(const std::string& line) override { return parser_->parse_line(line); }
+    ParseStatus try_parse_line(const std::string& line, LogRecordObject& record) noexcept override {
+        return parser_->try_parse_line(line, record);
+    }
+    ParseStatus try_parse(const std::string& line, LogEntry& entry) noexcept override {
+        return parser_->try_parse(line, entry);
+    }
+
+private:
+    std::shared_ptr<LogParser> parser_;
+};
+
+// Hand a batch of records to the caller, timing the hand-off
+template <typename Deliver>
+void timed_delivery(ThreadMetrics& stats, size_t records, Deliver&& deliver) {
+    auto start = PipelineMetrics::Clock::now();
+    deliver();
+    stats.batch_latency.record(PipelineMetrics::nanoseconds_since(start));
+    ThreadMetrics::add(stats.lines, records);
+    ThreadMetrics::add(stats.batches, 1);
+}
+
+// Marks a pipeline run finished however it ends
+struct MetricsRun {
+    PipelineMetrics& metrics;
+    ~MetricsRun() { metrics.finish(); }
+};
+
+} // namespace
+
 FileDataLoader::FileDataLoader(const std::string& filepath, const FileDataLoaderConfig& config)
     : filepath_(filepath), config_(config) {
     initInputStream();
@@ -91,28 +132,26 @@ void FileDataLoader::setFormat(const std::string& format) {
 }
 
 std::unique_ptr<std::istream> FileDataLoader::openCompressedFile() {
-    namespace bio = boost::iostreams;
-    
-    auto file = std::make_unique<std::ifstream>(filepath_, std::ios::binary);
-    if (!file || !file->good()) {
+    auto format = detect_compression(filepath_);
+    if (format == CompressionFormat::None) {
+        throw std::runtime_error("Unsupported compression format: " + filepath_);
+    }
+    if (!std::filesystem::exists(filepath_)) {
         throw std::runtime_error("Failed to open compressed file: " + filepath_);
     }
+    // Decoded on background threads, in parallel where the format allows
+    return std::make_unique<DecompressedStream>(filepath_, format);
+}
 
-    auto ext = getFileExtension();
-    auto buffer = std::make_unique<bio::filtering_streambuf<bio::input>>();
-
-    if (ext == "gz" || ext == "gzip") {
-        buffer->push(bio::gzip_decompressor());
-    } else if (ext == "bz2") {
-        buffer->push(bio::bzip2_decompressor());
-    } else if (ext == "z") {
-        buffer->push(bio::zlib_decompressor());
-    } else {
-        throw std::runtime_error("Unsupported compression format: " + ext);
+bool FileDataLoader::try_parse_into(const std::string& line, std::vector<LogParser::LogEntry>& entries) {
+    // Parsers that fill the entry they are given, rather than replace it, key and encode fields in this loader's schema
+    auto& entry = entries.emplace_back();
+    entry.fields.reset(field_schema_.get());
+    if (parser_->try_parse(line, entry) == ParseStatus::Ok) {
+        return true;
     }
-
-    buffer->push(*file);
-    return std::make_unique<std::istream>(buffer.release());
+    entries.pop_back();
+    return false;
 }
 
 void FileDataLoader::loadData(std::vector<LogParser::LogEntry>& entries) {
@@ -128,15 +167,13 @@ void FileDataLoader::loadData(std::vector<LogParser::LogEntry>& entries) {
         if (config_.logical_lines) {
             auto logical_line = readLogicalLine();
             if (!logical_line.empty()) {
-                if (parser_->validate(logical_line)) {
-                    entries.push_back(parser_->parse(logical_line));
-                }
+                try_parse_into(logical_line, entries);
             }
         } else {
             if (std::getline(*input_stream_, line)) {
                 boost::trim(line);
-                if (!line.empty() && parser_->validate(line)) {
-                    entries.push_back(parser_->parse(line));
+                if (!line.empty()) {
+                    try_parse_into(line, entries);
                 }
             }
         }
@@ -154,16 +191,20 @@ void FileDataLoader::streamData(const std::function<bool(const LogParser::LogEnt
     while (input_stream_->good()) {
         if (config_.logical_lines) {
             auto logical_line = readLogicalLine();
-            if (!logical_line.empty() && parser_->validate(logical_line)) {
-                if (!callback(parser_->parse(logical_line))) {
+            LogParser::LogEntry entry;
+            entry.fields.reset(field_schema_.get());
+            if (!logical_line.empty() && parser_->try_parse(logical_line, entry) == ParseStatus::Ok) {
+                if (!callback(entry)) {
                     break;
                 }
             }
         } else {
             if (std::getline(*input_stream_, line)) {
                 boost::trim(line);
-                if (!line.empty() && parser_->validate(line)) {
-                    if (!callback(parser_->parse(line))) {
+                LogParser::LogEntry entry;
+                entry.fields.reset(field_schema_.get());
+                if (!line.empty() && parser_->try_parse(line, entry) == ParseStatus::Ok) {
+                    if (!callback(entry)) {
                         break;
                     }
                 }
@@ -187,8 +228,7 @@ void FileDataLoader::processInChunks(size_t chunk_size,
     while (input_stream_->good()) {
         if (config_.logical_lines) {
             auto logical_line = readLogicalLine();
-            if (!logical_line.empty() && parser_->validate(logical_line)) {
-                chunk.push_back(parser_->parse(logical_line));
+            if (!logical_line.empty() && try_parse_into(logical_line, chunk)) {
                 if (chunk.size() >= chunk_size) {
                     callback(chunk);
                     chunk.clear();
@@ -198,8 +238,7 @@ void FileDataLoader::processInChunks(size_t chunk_size,
         } else {
             if (std::getline(*input_stream_, line)) {
                 boost::trim(line);
-                if (!line.empty() && parser_->validate(line)) {
-                    chunk.push_back(parser_->parse(line));
+                if (!line.empty() && try_parse_into(line, chunk)) {
                     if (chunk.size() >= chunk_size) {
                         callback(chunk);
                         chunk.clear();
@@ -274,8 +313,7 @@ std::string FileDataLoader::handleBackslashContinuation(const std::string& line,
 }
 
 bool FileDataLoader::isCompressedFile() const {
-    auto ext = getFileExtension();
-    return ext == "gz" || ext == "gzip" || ext == "bz2" || ext == "z";
+    return detect_compression(filepath_) != CompressionFormat::None;
 }
 
 std::string FileDataLoader::getFileExtension() const {
@@ -305,33 +343,43 @@ std::vector<LogRecordObject> FileDataLoader::load_data() {
     std::vector<LogRecordObject> results;
     running_ = true;
     std::atomic<size_t> total_batches_{0};
+    reset_pipeline_state(config_.memory_limit_mb * 1024 * 1024, config_.batch_size);
+    metrics_->start(fs::file_size(filepath));
+    MetricsRun metrics_run{*metrics_};
+    
+    // Determine number of worker threads
+    size_t num_threads = pipeline_workers();
     
-    // Create queues for the producer-consumer pattern
+    // Batches are collected in file order, through the same buffer as process_large_file()
     ThreadSafeQueue<LogBatch> input_queue;
-    ThreadSafeQueue<ProcessedBatch> output_queue;
+    ReorderBuffer<ProcessedBatch> output_buffer(2 * num_threads);
     
-    // Start the producer thread to read the file
-    MemoryMappedFile file;
-    std::thread producer([this, &file, &input_queue, &total_batches_]() {
-        producer_thread(file, input_queue, total_batches_);
+    // Start the producer thread to read the file; once it returns the batch count is final
+    std::thread producer([this, &input_queue, &total_batches_, &output_buffer]() {
+        producer_thread(input_queue, total_batches_);
+        output_buffer.finish(total_batches_.load());
     });
     
-    // Determine number of worker threads
-    size_t num_threads = config_.num_threads > 0 ? 
-                        config_.num_threads : 
-                        std::thread::hardware_concurrency();
-    
     // Start worker threads to process batches
     std::vector<std::thread> workers;
     for (size_t i = 0; i < num_threads; i++) {
-        workers.push_back(std::thread([this, &input_queue, &output_queue]() {
-            worker_thread(input_queue, output_queue);
+        workers.push_back(std::thread([this, &input_queue, &output_buffer]() {
+            const bool finished = worker_thread(input_queue, [this, &output_buffer](ProcessedBatch&& batch) {
+                const size_t id = batch.id;
+                output_buffer.push(id, std::move(batch));
+                metrics_->set_output_queue_depth(output_buffer.size());
+            });
+            if (!finished) {
+                abort_pipeline(output_buffer);
+            }
         }));
     }
     
     // Start consumer thread to collect results
-    std::thread consumer([this, num_threads, &output_queue, &results, &total_batches_]() {
-        consumer_thread(num_threads, output_queue, results, total_batches_);
+    std::thread consumer([this, &output_buffer, &results]() {
+        if (!consumer_thread(output_buffer, results)) {
+            abort_pipeline(output_buffer);
+        }
     });
     
     // Wait for all threads to complete
@@ -340,30 +388,58 @@ std::vector<LogRecordObject> FileDataLoader::load_data() {
         worker.join();
     }
     
-    // Signal that no more processed batches will be produced
-    output_queue.done();
+    // Every batch a worker finished is in the buffer; end the stream at the first lost one
+    output_buffer.close();
     consumer.join();
-    
     running_ = false;
+    if (pipeline_failed_) {
+        throw std::runtime_error("Failed to load " + filepath + ", collected " +
+                                 std::to_string(output_buffer.next_id()) + " of " +
+                                 std::to_string(total_batches_.load()) + " batches");
+    }
+    if (output_buffer.next_id() < total_batches_.load()) {
+        spdlog::error("Collected {} of {} batches of {}", output_buffer.next_id(), total_batches_.load(), filepath);
+    }
+    
+    if (const uint64_t failed = parse_errors_->total()) {
+        spdlog::warn("{} lines of {} failed to parse, see parse_errors()", failed, filepath);
+    }
     return results;
 }
 
 std::unique_ptr<LogParser> FileDataLoader::create_parser() {
+    // Parsers of one loader intern field keys in the same schema
     if (config_.log_type == "csv") {
-        return std::make_unique<CsvParser>(config_);
+        return std::make_unique<CsvParser>(config_, field_schema_);
     } else if (config_.log_type == "json") {
-        return std::make_unique<JsonParser>(config_);
+        return std::make_unique<JsonParser>(config_, field_schema_);
     } else if (config_.log_type == "drain") {
-        // Use the high-performance DRAIN parser for log pattern parsing
-        return std::make_unique<DrainParser>(config_);
+        // Use the high-performance DRAIN parser for log pattern parsing. All
+        // workers share one model so cluster IDs agree across batches.
+        return std::make_unique<SharedLogParser>(template_parser());
     } else {
         // Default to regex parser for custom log formats
-        return std::make_unique<RegexParser>(config_, config_.log_pattern);
+        return std::make_unique<RegexParser>(config_, config_.log_pattern, field_schema_);
     }
 }
 
-void FileDataLoader::worker_thread(ThreadSafeQueue<LogBatch>& input_queue, 
-                                 ThreadSafeQueue<ProcessedBatch>& output_queue) {
+std::shared_ptr<DrainParser> FileDataLoader::template_parser() {
+    std::lock_guard<std::mutex> lock(template_parser_mutex_);
+    if (!template_parser_) {
+        template_parser_ = std::make_shared<DrainParser>(config_, field_schema_);
+    }
+    return template_parser_;
+}
+
+void FileDataLoader::set_template_parser(std::shared_ptr<DrainParser> parser) {
+    std::lock_guard<std::mutex> lock(template_parser_mutex_);
+    // The model's records continue its schema, so cluster_id codes stay valid across loads
+    field_schema_ = parser ? parser->field_schema() : std::make_shared<FieldSchema>();
+    template_parser_ = std::move(parser);
+}
+
+bool FileDataLoader::worker_thread(ThreadSafeQueue<LogBatch>& input_queue,
+                                   const std::function<void(ProcessedBatch&&)>& deliver) {
     try {
         // Create parser once per thread
         auto parser = create_parser();
@@ -371,211 +447,273 @@ void FileDataLoader::worker_thread(ThreadSafeQueue<LogBatch>& input_queue,
             throw std::runtime_error("Failed to create parser in worker thread");
         }
         
-        std::cout << "Worker thread started" << std::endl;
+        auto& stats = metrics_->register_thread(PipelineStage::Parse, config_.log_type);
+        auto& errors = parse_errors_->register_thread(config_.log_type);
         
         while (true) {
             LogBatch batch;
-            if (!input_queue.wait_and_pop(batch)) {
-                break; // Queue is done and empty
+            auto wait_start = PipelineMetrics::Clock::now();
+            ++idle_workers_;
+            bool got_batch = input_queue.wait_and_pop(batch);
+            --idle_workers_;
+            ThreadMetrics::add(stats.idle_ns, PipelineMetrics::nanoseconds_since(wait_start));
+            if (!got_batch || pipeline_failed_) {
+                break; // Queue is done and empty, or the run failed
             }
+            metrics_->set_input_queue_depth(input_queue.size());
             
             // Process the batch
+            auto parse_start = PipelineMetrics::Clock::now();
             ProcessedBatch processed_batch;
             processed_batch.id = batch.id;
             processed_batch.records.reserve(batch.lines.size());
             
             size_t success_count = 0;
             size_t error_count = 0;
+            uint64_t line_number = batch.first_line;
+            uint64_t offset = batch.first_offset;
             
+            // Failures go to this thread's error ring, never to a log: no formatting or I/O per line
             for (const auto& line : batch.lines) {
-                try {
-                    if (!line.empty()) {
-                        auto record = parser->parse_line(line);
-                        processed_batch.records.push_back(std::move(record));
+                if (!line.empty()) {
+                    auto& record = processed_batch.records.emplace_back();
+                    const ParseStatus status = parser->try_parse_line(line, record);
+                    if (status == ParseStatus::Ok) {
                         success_count++;
-                    }
-                } catch (const std::exception& e) {
-                    error_count++;
-                    if (error_count < 10) { // Limit error messages to avoid flooding logs
-                        std::cerr << "Error parsing line: " << e.what() << std::endl;
-                        if (line.length() < 200) { // Only print short lines to avoid flooding logs
-                            std::cerr << "Line content: " << line << std::endl;
-                        } else {
-                            std::cerr << "Line too long to display (" << line.length() << " chars)" << std::endl;
-                        }
-                    } else if (error_count == 10) {
-                        std::cerr << "Too many parsing errors, suppressing further messages..." << std::endl;
+                    } else {
+                        processed_batch.records.pop_back();
+                        error_count++;
+                        errors.record(line_number, offset, status);
                     }
                 }
+                ++line_number;
+                offset += line.size() + 1;
             }
             
-            if (batch.id % 10 == 0 || error_count > 0) {
-                spdlog::info("Processed batch {}: {} successes, {} errors", 
-                            batch.id, success_count, error_count);
+            // The lines are replaced by their records in the memory budget; never blocks, so
+            // the consumer that releases them can always make progress
+            for (const auto& record : processed_batch.records) {
+                processed_batch.bytes += record.memory_usage();
             }
-            
-            // Push the processed batch to the output queue
-            output_queue.push(std::move(processed_batch));
+            memory_budget_.charge(processed_batch.bytes);
+            memory_budget_.release(batch.bytes);
+
+            const uint64_t parse_ns = PipelineMetrics::nanoseconds_since(parse_start);
+            stats.batch_latency.record(parse_ns);
+            ThreadMetrics::add(stats.busy_ns, parse_ns);
+            ThreadMetrics::add(stats.lines, success_count);
+            ThreadMetrics::add(stats.errors, error_count);
+            ThreadMetrics::add(stats.batches, 1);
+
+            deliver(std::move(processed_batch));
         }
         
-        spdlog::info("Worker thread finished");
+        spdlog::debug("Worker thread finished");
+        return true;
     } catch (const std::exception& e) {
         spdlog::error("Error in worker thread: {}", e.what());
+        return false;
     }
 }
 
-void FileDataLoader::consumer_thread(size_t num_threads, ThreadSafeQueue<ProcessedBatch>& output_queue, 
-                                    std::vector<LogRecordObject>& results,
-                                    std::atomic<size_t>& total_batches) {
-    size_t processed_count = 0;
-    size_t expected_count = total_batches.load();
-    
-    while (true) {
-        ProcessedBatch batch;
-        if (!output_queue.wait_and_pop(batch)) {
-            break; // Queue is done and empty
-        }
-        
-        // Add the processed records to the results
-        results.insert(results.end(), 
-                      std::make_move_iterator(batch.records.begin()), 
-                      std::make_move_iterator(batch.records.end()));
-        
-        processed_count++;
+bool FileDataLoader::consumer_thread(ReorderBuffer<ProcessedBatch>& output_buffer,
+                                     std::vector<LogRecordObject>& results) {
+    try {
+        auto& stats = metrics_->register_thread(PipelineStage::Deliver);
         
-        // If we've processed all expected batches, we're done
-        if (processed_count >= expected_count && expected_count > 0) {
-            break;
+        // Runs until the producer's finish() count or close() ends the stream, so that every
+        // batch's bytes return to the memory budget the producer may be waiting on
+        ProcessedBatch batch;
+        while (output_buffer.pop(batch)) {
+            metrics_->set_output_queue_depth(output_buffer.size());
+            
+            // Add the processed records to the results
+            timed_delivery(stats, batch.records.size(), [&] {
+                results.insert(results.end(),
+                               std::make_move_iterator(batch.records.begin()),
+                               std::make_move_iterator(batch.records.end()));
+            });
+            memory_budget_.release(batch.bytes);
         }
+        return true;
+    } catch (const std::exception& e) {
+        spdlog::error("Error in consumer thread: {}", e.what());
+        return false;
     }
 }
 
-void FileDataLoader::producer_thread([[maybe_unused]] MemoryMappedFile& file, ThreadSafeQueue<LogBatch>& input_queue, 
+void FileDataLoader::abort_pipeline(ReorderBuffer<ProcessedBatch>& output_buffer) {
+    // The producer stops at its next acquire(), workers at their next batch; a lost batch
+    // or its unreleased bytes can then no longer keep anyone waiting
+    pipeline_failed_ = true;
+    memory_budget_.close();
+    output_buffer.close();
+}
+
+void FileDataLoader::producer_thread(ThreadSafeQueue<LogBatch>& input_queue, 
                                     std::atomic<size_t>& total_batches) {
     try {
-        if (config_.use_memory_mapping) {
-            // Use a vector to collect lines in batches
-            std::vector<std::string> batch_lines;
-            batch_lines.reserve(current_batch_size_.load()); // Use adaptive batch size
-            size_t batch_id = 0;
-            size_t lines_processed = 0;
-            
-            read_file_memory_mapped(config_.file_path, [&](std::string_view line) {
-                try {
-                    // Check if the string_view is valid before creating a string from it
-                    if (line.data() && line.size() > 0 && line.size() < MAX_LINE_LENGTH) {
-                        // Create a safe copy of the string_view
-                        std::string line_copy;
-                        line_copy.reserve(line.size());
-                        line_copy.assign(line.data(), line.size());
-                        
-                        // Add to current batch
-                        batch_lines.push_back(std::move(line_copy));
-                        lines_processed++;
-                        
-                        // If batch is full, push it to the queue
-                        size_t current_batch_size = current_batch_size_.load();
-                        if (batch_lines.size() >= current_batch_size) {
-                            LogBatch batch{batch_id++, std::move(batch_lines)};
-                            input_queue.push(std::move(batch));
-                            
-                            // Reset batch_lines for next batch
-                            batch_lines = std::vector<std::string>();
-                            batch_lines.reserve(current_batch_size);
-                            
-                            // Update total batches
-                            total_batches.store(batch_id);
-                            
-                            // Adjust batch size based on queue size and memory usage
-                            adjust_batch_size(input_queue);
-                            
-                            // If memory pressure is high, pause briefly to let consumers catch up
-                            if (memory_pressure_.load()) {
-                                size_t queue_size = input_queue.size();
-                                if (queue_size > queue_high_watermark_.load()) {
-                                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                                }
-                            }
-                        }
-                        
-                        // Report progress periodically
-                        if (lines_processed % 10000 == 0) {
-                            spdlog::info("Processed {} lines", lines_processed);
-                        }
-                    }
-                } catch (const std::exception& e) {
-                    spdlog::error("Error creating batch: {}", e.what());
-                }
-            });
-            
-            // Push any remaining lines
-            if (!batch_lines.empty()) {
-                LogBatch batch{batch_id++, std::move(batch_lines)};
-                input_queue.push(std::move(batch));
-                total_batches.store(batch_id);
+        // Use a vector to collect lines in batches
+        std::vector<std::string> batch_lines;
+        batch_lines.reserve(current_batch_size_.load()); // Use adaptive batch size
+        size_t batch_bytes = 0;
+        size_t batch_id = 0;
+        uint64_t line_number = 0;  // Non-blank lines seen, including dropped ones
+        uint64_t offset = 0;       // Their bytes, one terminator each
+        uint64_t batch_first_line = 1;
+        uint64_t batch_first_offset = 0;
+        bool closed = false;
+        auto& stats = metrics_->register_thread(PipelineStage::Read);
+
+        auto push_batch = [&] {
+            const size_t lines = batch_lines.size();
+            produced_lines_ += lines;
+            produced_bytes_ += batch_bytes;
+            // Line bytes plus a terminator each, without the string objects holding them
+            ThreadMetrics::add(stats.bytes, batch_bytes - lines * sizeof(std::string) + lines);
+            ThreadMetrics::add(stats.lines, lines);
+            ThreadMetrics::add(stats.batches, 1);
+            LogBatch batch{batch_id, std::move(batch_lines), batch_bytes, batch_first_line, batch_first_offset};
+            // Blocks while the batches and records in flight exceed the memory budget
+            auto wait_start = PipelineMetrics::Clock::now();
+            const bool admitted = memory_budget_.acquire(batch.bytes);
+            ThreadMetrics::add(stats.idle_ns, PipelineMetrics::nanoseconds_since(wait_start));
+            if (!admitted) {
+                closed = true;
+                return;
             }
-        } else {
-            // Use a vector to collect lines in batches
-            std::vector<std::string> batch_lines;
-            batch_lines.reserve(current_batch_size_.load()); // Use adaptive batch size
-            size_t batch_id = 0;
-            size_t lines_processed = 0;
-            
-            read_file_by_chunks(config_.file_path, [&](const std::string& line) {
-                try {
-                    // Add to current batch
-                    batch_lines.push_back(line);
-                    lines_processed++;
-                    
-                    // If batch is full, push it to the queue
-                    size_t current_batch_size = current_batch_size_.load();
-                    if (batch_lines.size() >= current_batch_size) {
-                        LogBatch batch{batch_id++, std::move(batch_lines)};
-                        input_queue.push(std::move(batch));
-                        
-                        // Reset batch_lines for next batch
-                        batch_lines = std::vector<std::string>();
-                        batch_lines.reserve(current_batch_size);
-                        
-                        // Update total batches
-                        total_batches.store(batch_id);
-                        
-                        // Adjust batch size based on queue size and memory usage
-                        adjust_batch_size(input_queue);
-                        
-                        // If memory pressure is high, pause briefly to let consumers catch up
-                        if (memory_pressure_.load()) {
-                            size_t queue_size = input_queue.size();
-                            if (queue_size > queue_high_watermark_.load()) {
-                                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                            }
-                        }
+            input_queue.push(std::move(batch));
+            metrics_->set_input_queue_depth(input_queue.size());
+            total_batches.store(++batch_id);
+
+            // Adjust batch size based on bytes per line, worker utilization and memory usage
+            adjust_batch_size(input_queue);
+            batch_lines = std::vector<std::string>();
+            batch_lines.reserve(current_batch_size_.load());
+            batch_bytes = 0;
+        };
+        auto add_line = [&](std::string_view line) {
+            if (closed) {
+                return;
+            }
+            try {
+                if (!line.data() || line.empty()) {
+                    return;
+                }
+                ++line_number;
+                offset += line.size() + 1;
+                // Check if the string_view is valid before creating a string from it
+                if (line.size() < MAX_LINE_LENGTH) {
+                    if (batch_lines.empty()) {
+                        batch_first_line = line_number;
+                        batch_first_offset = offset - line.size() - 1;
                     }
-                    
-                    // Report progress periodically
-                    if (lines_processed % 10000 == 0) {
-                        spdlog::info("Processed {} lines", lines_processed);
+                    batch_lines.emplace_back(line.data(), line.size());
+                    batch_bytes += sizeof(std::string) + line.size();
+
+                    // If batch is full, push it to the queue
+                    if (batch_lines.size() >= current_batch_size_.load()) {
+                        push_batch();
                     }
-                } catch (const std::exception& e) {
-                    spdlog::error("Error creating batch: {}", e.what());
                 }
-            });
-            
-            // Push any remaining lines
-            if (!batch_lines.empty()) {
-                LogBatch batch{batch_id++, std::move(batch_lines)};
-                input_queue.push(std::move(batch));
-                total_batches.store(batch_id);
+            } catch (const std::exception& e) {
+                spdlog::error("Error creating batch: {}", e.what());
+            }
+        };
+
+        if (config_.use_memory_mapping || config_.use_io_uring) {
+            // Compressed files are decompressed in parallel straight into the line splitter
+            auto read_lines = &FileDataLoader::read_file_memory_mapped;
+            if (detect_compression(config_.file_path) != CompressionFormat::None) {
+                read_lines = &FileDataLoader::read_file_decompressed;
+            } else if (config_.use_io_uring) {
+                if (UringFileReader::isSupported()) {
+                    read_lines = &FileDataLoader::read_file_io_uring;
+                } else {
+                    spdlog::warn("io_uring is not available, reading {} memory mapped", config_.file_path);
+                }
             }
+            (this->*read_lines)(config_.file_path, add_line);
+        } else {
+            read_file_by_chunks(config_.file_path, [&](const std::string& line) { add_line(line); });
+        }
+
+        // Push any remaining lines
+        if (!batch_lines.empty() && !closed) {
+            push_batch();
         }
     } catch (const std::exception& e) {
         spdlog::error("Error in producer thread: {}", e.what());
+        pipeline_failed_ = true;
     }
     
     // Signal that no more batches will be produced
     input_queue.done();
 }
 
+void FileDataLoader::reset_pipeline_state(size_t memory_limit_bytes, size_t max_batch_lines) {
+    memory_budget_.reset();
+    memory_budget_.set_limit(memory_limit_bytes);
+    pipeline_failed_ = false;
+    produced_lines_ = 0;
+    produced_bytes_ = 0;
+    memory_pressure_ = false;
+    parse_errors_->reset(config_.error_ring_capacity);
+    max_batch_size_ = std::max(max_batch_lines, min_batch_size_.load());
+    current_batch_size_ = std::clamp(current_batch_size_.load(), min_batch_size_.load(), max_batch_size_.load());
+}
+
+size_t FileDataLoader::get_current_memory_usage() const {
+    // Resident set size from /proc/self/statm (second field, in pages)
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+bool FileDataLoader::detect_memory_pressure() const {
+    // Only bytes in flight count: records already handed to the caller are out of the pipeline's hands
+    const size_t limit = memory_budget_.limit();
+    return limit > 0 && memory_budget_.in_use() > limit / 10 * 8;
+}
+
+void FileDataLoader::adjust_batch_size(ThreadSafeQueue<LogBatch>& queue) {
+    const size_t lines = produced_lines_.load();
+    if (lines == 0) {
+        return;
+    }
+    const size_t line_bytes = std::max<size_t>(1, produced_bytes_.load() / lines);
+    size_t target = std::max<size_t>(1, config_.target_batch_bytes / line_bytes);
+
+    // Keep several batches within the budget, so workers are not serialized behind one batch
+    const size_t limit = memory_budget_.limit();
+    if (limit > 0) {
+        target = std::min(target, std::max<size_t>(1, limit / 8 / line_bytes));
+    }
+
+    // Workers waiting on an empty queue: smaller batches spread the work sooner.
+    // A deep backlog means the workers are the bottleneck: larger batches cut per-batch overhead.
+    const size_t queued = queue.size();
+    if (idle_workers_.load() > 0 && queued == 0) {
+        target /= 2;
+    } else if (queued > queue_high_watermark_.load()) {
+        target *= 2;
+    }
+
+    memory_pressure_ = detect_memory_pressure();
+    if (memory_pressure_) {
+        target /= 2;
+    }
+
+    // Move halfway towards the target to damp oscillation
+    const size_t current = current_batch_size_.load();
+    const size_t next = std::clamp((current + target) / 2, min_batch_size_.load(), max_batch_size_.load());
+    current_batch_size_ = next;
+}
+
 void FileDataLoader::read_file_by_chunks(const std::string& filepath, 
                                        const std::function<void(const std::string&)>& callback) {
     std::ifstream file(filepath);
@@ -594,98 +732,120 @@ void FileDataLoader::read_file_by_chunks(const std::string& filepath,
 void FileDataLoader::read_file_memory_mapped(const std::string& file_path, 
                                            std::function<void(std::string_view)> line_processor) {
     try {
-        // Open the file
-        int fd = open(file_path.c_str(), O_RDONLY);
-        if (fd == -1) {
+        // Sequential scan through a sliding window: read ahead of it and drop pages once they are behind us
+        MappingOptions options;
+        options.sequential = true;
+        options.prefetch_window = config_.mmap_prefetch_bytes;
+        options.release_consumed = config_.mmap_release_consumed;
+        options.populate_max_bytes = config_.mmap_populate_max_bytes;
+
+        WindowedMappedFile file(config_.mmap_window_bytes, options);
+        if (!file.open(file_path)) {
             throw std::runtime_error("Failed to open file: " + file_path + ", error: " + strerror(errno));
         }
 
-        // Get file size
-        struct stat sb;
-        if (fstat(fd, &sb) == -1) {
-            close(fd);
-            throw std::runtime_error("Failed to get file size: " + file_path + ", error: " + strerror(errno));
-        }
-
-        // Map the file into memory
-        void* mapped = mmap(nullptr, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
-        if (mapped == MAP_FAILED) {
-            close(fd);
-            throw std::runtime_error("Failed to map file: " + file_path + ", error: " + strerror(errno));
-        }
-
-        // Process the file line by line
-        const char* data = static_cast<const char*>(mapped);
-        const char* end = data + sb.st_size;
-        const char* line_start = data;
-
-        spdlog::info("Processing memory mapped file of size: {} bytes", sb.st_size);
+        spdlog::info("Processing memory mapped file of size: {} bytes", file.size());
 
         // Process each line
         size_t line_count = 0;
-        while (line_start < end) {
-            // Find the end of the current line
-            const char* line_end = line_start;
-            while (line_end < end && *line_end != '\n') {
-                ++line_end;
-            }
-
-            // Create a string_view for the current line
-            size_t line_length = line_end - line_start;
-            if (line_length > 0 && line_length < MAX_LINE_LENGTH) {
-                try {
-                    std::string_view line(line_start, line_length);
-                    line_processor(line);
-                    line_count++;
-                    
-                    if (line_count % 10000 == 0) {
-                        spdlog::info("Processed {} lines", line_count);
-                    }
-                } catch (const std::exception& e) {
-                    spdlog::error("Error processing line: {}", e.what());
-                }
-            } else if (line_length >= MAX_LINE_LENGTH) {
-                spdlog::error("Skipping line {} (length: {}): Line too long", line_count, line_length);
+        const auto& stats = file.forEachLine([&](std::string_view line) {
+            try {
+                line_processor(line);
+                line_count++;
+            } catch (const std::exception& e) {
+                spdlog::error("Error processing line: {}", e.what());
             }
+        }, MAX_LINE_LENGTH);
 
-            // Move to the next line
-            line_start = (line_end < end) ? line_end + 1 : end;
-        }
-
-        spdlog::info("Finished processing {} lines", line_count);
-
-        // Unmap and close the file
-        if (munmap(mapped, sb.st_size) == -1) {
-            spdlog::error("Warning: Failed to unmap file: {}", file_path);
+        if (stats.long_lines > 0) {
+            spdlog::error("Skipped {} lines longer than {} bytes", stats.long_lines, MAX_LINE_LENGTH);
         }
-        close(fd);
+        spdlog::info("Finished processing {} lines in {} windows", line_count, stats.windows);
     } catch (const std::exception& e) {
         spdlog::error("Error in read_file_memory_mapped: {}", e.what());
         throw;
     }
 }
 
+void FileDataLoader::read_file_io_uring(const std::string& file_path,
+                                       std::function<void(std::string_view)> line_processor) {
+    UringReaderConfig reader_config;
+    reader_config.queue_depth = config_.io_queue_depth;
+    reader_config.buffer_bytes = config_.io_buffer_bytes;
+    reader_config.direct_io = config_.use_direct_io;
+    UringFileReader reader(reader_config);
+
+    LineSplitter splitter([&](std::string_view line) {
+        try {
+            line_processor(line);
+        } catch (const std::exception& e) {
+            spdlog::error("Error processing line: {}", e.what());
+        }
+    }, MAX_LINE_LENGTH);
+
+    reader.read(file_path, [&](const char* data, size_t size) { splitter.feed(data, size); });
+    splitter.finish();
+
+    const auto& stats = reader.stats();
+    spdlog::info("Read {} bytes with {} io_uring reads{}{}", stats.bytes, stats.reads,
+                 stats.direct ? ", O_DIRECT" : "", stats.registered ? ", registered buffers" : "");
+}
+
+void FileDataLoader::read_file_decompressed(const std::string& file_path,
+                                           std::function<void(std::string_view)> line_processor) {
+    ParallelDecompressor decompressor;
+    LineSplitter splitter([&](std::string_view line) {
+        try {
+            line_processor(line);
+        } catch (const std::exception& e) {
+            spdlog::error("Error processing line: {}", e.what());
+        }
+    }, MAX_LINE_LENGTH);
+
+    decompressor.decompress(file_path, detect_compression(file_path),
+                            [&](const char* data, size_t size) { splitter.feed(data, size); });
+    splitter.finish();
+
+    const auto& stats = decompressor.stats();
+    spdlog::info("Decompressed {} bytes to {} bytes ({} pieces{})", stats.bytes_in, stats.bytes_out, stats.pieces,
+                 stats.parallel ? ", parallel" : "");
+}
+
 std::vector<LogRecordObject> FileDataLoader::read_logs(const std::string& filepath) {
     std::vector<LogRecordObject> records;
-    std::ifstream file(filepath);
-    
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open file: " + filepath);
-    }
-    
     auto parser = create_parser();
-    std::string line;
-    
-    while (std::getline(file, line)) {
-        if (line.empty()) continue;
+    size_t failed = 0;
+    auto parse = [&](const std::string& line) {
+        auto& record = records.emplace_back();
+        if (parser->try_parse_line(line, record) != ParseStatus::Ok) {
+            records.pop_back();
+            ++failed;
+        }
+    };
+
+    if (detect_compression(filepath) != CompressionFormat::None) {
+        std::string line;
+        read_file_decompressed(filepath, [&](std::string_view text) {
+            line.assign(text.data(), text.size());
+            parse(line);
+        });
+    } else {
+        std::ifstream file(filepath);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open file: " + filepath);
+        }
         
-        try {
-            records.push_back(parser->parse_line(line));
-        } catch (const std::exception& e) {
-            spdlog::error("Error parsing line: {}", e.what());
+        std::string line;
+        
+        while (std::getline(file, line)) {
+            if (line.empty()) continue;
+            parse(line);
         }
     }
-    
+
+    if (failed > 0) {
+        spdlog::warn("Failed to parse {} lines of {}", failed, filepath);
+    }
     return records;
 }
 
@@ -761,19 +921,11 @@ void FileDataLoader::process_batch(const LogBatch& batch, ProcessedBatch& result
     }
     
     // Parse each line
+    // Straight to records: no validate() pass and no LogEntry in between
     for (const auto& line : preprocessed_lines) {
-        try {
-            if (parser_->validate(line)) {
-                LogParser::LogEntry entry = parser_->parse(line);
-                result.records.push_back(entry.to_record_object());
-                processed_lines_++;
-            } else {
-                failed_lines_++;
-            }
-        } catch (const std::exception& e) {
-            // Log error and continue
-            spdlog::warn("Failed to parse line: {}", e.what());
-            failed_lines_++;
+        auto& record = result.records.emplace_back();
+        if (parser_->try_parse_line(line, record) != ParseStatus::Ok) {
+            result.records.pop_back();
         }
     }
 }
@@ -805,12 +957,150 @@ std::vector<LogRecordObject> FileDataLoader::parse_log_file(const std::string& f
     }
 }
 
+bool FileDataLoader::can_resume(const std::string& filepath, const IngestCheckpoint& checkpoint) {
+    if (checkpoint.offset == 0 || isCompressedFile() || checkpoint.format != config_.format) {
+        return false;
+    }
+    // Cluster IDs are only meaningful within one DRAIN model
+    if (config_.log_type == "drain" && template_parser()->model_id() != checkpoint.model_id) {
+        return false;
+    }
+    return checkpoint_matches_file(checkpoint, filepath);
+}
+
+IncrementalParseResult FileDataLoader::parse_log_file_incremental(const std::string& filepath,
+                                                                  const std::string& format,
+                                                                  IngestCheckpoint& checkpoint) {
+    if (!format.empty()) {
+        setFormat(format);
+    }
+
+    IncrementalParseResult result;
+    result.resumed = can_resume(filepath, checkpoint);
+    if (!result.resumed) {
+        checkpoint = IngestCheckpoint();
+        checkpoint.format = config_.format;
+    }
+    result.first_record = checkpoint.records;
+
+    if (isCompressedFile()) {
+        // Offsets into a compressed stream cannot be resumed from, leave the checkpoint at 0
+        result.records = read_logs(filepath);
+        return result;
+    }
+
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + filepath);
+    }
+    uint64_t offset = checkpoint.offset;
+    if (checkpoint.unterminated && std::filesystem::file_size(filepath) > offset) {
+        ++offset;  // The newline that completes the line parsed last time (see checkpoint_matches_file())
+        checkpoint.unterminated = false;
+    }
+    file.seekg(static_cast<std::streamoff>(offset));
+
+    auto parser = create_parser();
+    std::vector<char> buffer(CHUNK_SIZE);
+    std::string line;
+    size_t failed = 0;
+    auto parse = [&](const std::string& text) {
+        auto& record = result.records.emplace_back();
+        if (parser->try_parse_line(text, record) != ParseStatus::Ok) {
+            result.records.pop_back();
+            ++failed;
+        }
+    };
+    while (file) {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        const char* begin = buffer.data();
+        const char* end = begin + file.gcount();
+        while (begin < end) {
+            const char* newline = static_cast<const char*>(std::memchr(begin, '\n', static_cast<size_t>(end - begin)));
+            if (!newline) {
+                line.append(begin, end);
+                break;
+            }
+            line.append(begin, newline);
+            offset += line.size() + 1;
+            ++checkpoint.lines;
+            if (!line.empty()) {
+                parse(line);
+            }
+            line.clear();
+            begin = newline + 1;
+        }
+    }
+    // A final line without a newline is parsed as it stands
+    if (!line.empty()) {
+        offset += line.size();
+        ++checkpoint.lines;
+        checkpoint.unterminated = true;
+        parse(line);
+    }
+
+    if (failed > 0) {
+        spdlog::warn("Failed to parse {} lines of {}", failed, filepath);
+    }
+
+    checkpoint.offset = offset;
+    checkpoint.records += result.records.size();
+    stamp_checkpoint_file(checkpoint, filepath);
+    checkpoint.tail_hash = hash_file_tail(filepath, checkpoint.offset);
+    if (config_.log_type == "drain") {
+        auto model = template_parser();
+        checkpoint.model_id = model->model_id();
+        checkpoint.model_generation = model->model_generation();
+    }
+    return result;
+}
+
 bool FileDataLoader::process_large_file_with_callback(
     const std::string& input_file,
     const std::string& parser_type,
     size_t chunk_size,
     const std::function<void(const std::vector<LogRecordObject>&)>& callback,
     size_t memory_limit_mb) {
+    if (!config_.ordered_delivery) {
+        // Serialized per batch, but in whatever order the workers finish
+        std::mutex callback_mutex;
+        return process_large_file(input_file, parser_type, chunk_size, memory_limit_mb, nullptr,
+                                  [&](size_t, const std::vector<LogRecordObject>& records) {
+                                      std::lock_guard<std::mutex> lock(callback_mutex);
+                                      callback(records);
+                                  });
+    }
+    return process_large_file(input_file, parser_type, chunk_size, memory_limit_mb, callback, nullptr);
+}
+
+double FileDataLoader::get_progress() const {
+    return metrics_->progress();
+}
+
+PipelineMetricsSnapshot FileDataLoader::metrics_snapshot() const {
+    return metrics_->snapshot();
+}
+
+bool FileDataLoader::process_large_file_per_worker(
+    const std::string& input_file,
+    const std::string& parser_type,
+    size_t chunk_size,
+    const WorkerCallback& callback,
+    size_t memory_limit_mb) {
+    return process_large_file(input_file, parser_type, chunk_size, memory_limit_mb, nullptr, callback);
+}
+
+size_t FileDataLoader::pipeline_workers() const {
+    return config_.num_threads > 0 ? config_.num_threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+bool FileDataLoader::process_large_file(
+    const std::string& input_file,
+    const std::string& parser_type,
+    size_t chunk_size,
+    size_t memory_limit_mb,
+    const std::function<void(const std::vector<LogRecordObject>&)>& ordered_callback,
+    const WorkerCallback& worker_callback) {
     
     try {
         // Set format for parser
@@ -823,99 +1113,117 @@ bool FileDataLoader::process_large_file_with_callback(
             spdlog::error("Input file does not exist: {}", input_file);
             return false;
         }
+        config_.file_path = input_file;  // Read by the producer thread
+        reset_pipeline_state(memory_limit_mb * 1024 * 1024, chunk_size);
         
         // Get file size
         auto file_size = std::filesystem::file_size(input_file);
+        metrics_->start(file_size);
+        MetricsRun metrics_run{*metrics_};
         
         // For very small files, just read everything at once
         if (file_size < chunk_size * 100 && file_size < memory_limit_mb * 1024 * 1024 / 10) {
             auto records = read_logs(input_file);
             if (!records.empty()) {
-                callback(records);
+                auto& stats = metrics_->register_thread(PipelineStage::Deliver);
+                timed_delivery(stats, records.size(), [&] {
+                    if (ordered_callback) {
+                        ordered_callback(records);
+                    } else {
+                        worker_callback(0, records);
+                    }
+                });
                 return true;
             }
             return false;
         }
         
         // For large files, process in chunks
-        MemoryMappedFile mmapped_file(input_file);
-        if (!mmapped_file.isOpen()) {
-            spdlog::error("Failed to memory map file: {}", input_file);
+        // The producer maps the file itself, one window at a time
+        if (::access(input_file.c_str(), R_OK) != 0) {
+            spdlog::error("Failed to open file: {}", input_file);
             return false;
         }
         
         // Process file in chunks using producer-consumer pattern
-        const size_t line_estimate = chunk_size;
         std::atomic<size_t> total_batches{0};
         ThreadSafeQueue<LogBatch> input_queue;
-        ThreadSafeQueue<ProcessedBatch> output_queue;
+        const size_t num_workers = pipeline_workers();
+        // Batches are handed to workers in ID order, so a window of twice the workers rarely
+        // makes one wait and never blocks the worker holding the next batch
+        ReorderBuffer<ProcessedBatch> output_buffer(2 * num_workers);
         
-        // Start producer thread to read file
-        std::thread producer([this, &mmapped_file, &input_queue, &total_batches, line_estimate]() {
-            producer_thread(mmapped_file, input_queue, total_batches);
+        // Start producer thread to read file; once it returns the batch count is final
+        std::thread producer([this, &input_queue, &total_batches, &output_buffer]() {
+            producer_thread(input_queue, total_batches);
+            output_buffer.finish(total_batches.load());
         });
         
-        // Start worker threads to process batches
-        const size_t num_workers = std::thread::hardware_concurrency();
+        // Start worker threads to process batches. Unordered, each worker delivers its own
+        // batches as soon as they are parsed and no consumer thread is needed
         std::vector<std::thread> workers;
         for (size_t i = 0; i < num_workers; i++) {
-            workers.emplace_back([this, &input_queue, &output_queue]() {
-                worker_thread(input_queue, output_queue);
+            workers.emplace_back([this, i, &input_queue, &output_buffer, &ordered_callback, &worker_callback]() {
+                ThreadMetrics* delivery = ordered_callback ? nullptr : &metrics_->register_thread(PipelineStage::Deliver);
+                const bool finished = worker_thread(input_queue, [&](ProcessedBatch&& batch) {
+                    if (ordered_callback) {
+                        const size_t id = batch.id;
+                        output_buffer.push(id, std::move(batch));
+                        metrics_->set_output_queue_depth(output_buffer.size());
+                    } else {
+                        timed_delivery(*delivery, batch.records.size(), [&] { worker_callback(i, batch.records); });
+                        memory_budget_.release(batch.bytes);
+                    }
+                });
+                if (!finished) {
+                    abort_pipeline(output_buffer);
+                }
             });
         }
         
-        // Process output batches as they become available
-        std::thread consumer([this, &output_queue, &callback, num_workers, &total_batches]() {
-            // Process batches in order
-            std::map<size_t, ProcessedBatch> pending_batches;
-            size_t next_batch_id = 0;
-            
-            while (true) {
-                // Check if we're done
-                if (output_queue.empty() && total_batches.load() > 0 && 
-                    next_batch_id >= total_batches.load()) {
-                    break;
-                }
-                
-                // Get next batch
-                ProcessedBatch batch;
-                if (!output_queue.try_pop(batch)) {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
-                    continue;
-                }
-                
-                // Store batch for later if it's not the next one
-                if (batch.id != next_batch_id) {
-                    pending_batches[batch.id] = std::move(batch);
-                    continue;
-                }
-                
-                // Process this batch and any pending batches that are now ready
-                do {
-                    // Process the current batch
-                    callback(batch.records);
-                    next_batch_id++;
-                    
-                    // Check if the next batch is in pending
-                    auto it = pending_batches.find(next_batch_id);
-                    if (it == pending_batches.end()) {
-                        break;
+        // Deliver processed batches in order, sleeping until the next one is ready
+        std::thread consumer;
+        if (ordered_callback) {
+            consumer = std::thread([this, &output_buffer, &ordered_callback]() {
+                try {
+                    auto& stats = metrics_->register_thread(PipelineStage::Deliver);
+                    ProcessedBatch batch;
+                    while (output_buffer.pop(batch)) {
+                        metrics_->set_output_queue_depth(output_buffer.size());
+                        timed_delivery(stats, batch.records.size(), [&] { ordered_callback(batch.records); });
+                        memory_budget_.release(batch.bytes);
                     }
-                    
-                    // Process the pending batch
-                    batch = std::move(it->second);
-                    pending_batches.erase(it);
-                } while (true);
-            }
-        });
+                } catch (const std::exception& e) {
+                    spdlog::error("Error in consumer thread: {}", e.what());
+                    abort_pipeline(output_buffer);
+                }
+            });
+        }
         
         // Wait for all threads to finish
         producer.join();
         for (auto& worker : workers) {
             worker.join();
         }
-        consumer.join();
+        if (ordered_callback) {
+            // Every batch a worker finished is in the buffer; end the stream at the first lost one
+            output_buffer.close();
+            consumer.join();
+            if (output_buffer.next_id() < total_batches.load()) {
+                spdlog::error("Delivered {} of {} batches of {}", output_buffer.next_id(), total_batches.load(),
+                              input_file);
+            }
+        }
+        if (pipeline_failed_) {
+            spdlog::error("Stopped processing {} after a pipeline thread failed", input_file);
+            return false;
+        }
         
+        if (const uint64_t failed = parse_errors_->total()) {
+            spdlog::warn("{} lines of {} failed to parse, see parse_errors()", failed, input_file);
+        }
+        spdlog::info("Peak {} bytes in flight (limit {}), producer blocked {} times, resident {} bytes",
+                     memory_budget_.peak(), memory_budget_.limit(), memory_budget_.waits(), get_current_memory_usage());
         return true;
     }
     catch (const std::exception& e) {
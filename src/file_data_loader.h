@@ -9,16 +9,24 @@
 #include <filesystem>
 #include <unordered_set>
 #include <optional>
+#include <mutex>
 #include <folly/container/F14Map.h>
 #include "data_loader_config.h"
+#include "ingest_checkpoint.h"
 #include "log_record.h"
+#include "memory_budget.h"
 #include "memory_mapped_file.h"
+#include "parse_error_sink.h"
+#include "pipeline_metrics.h"
+#include "reorder_buffer.h"
 #include "thread_safe_queue.h"
 #include "log_parser.h"
 #include "preprocessor.h"
 
 namespace logai {
 
+class DrainParser;
+
 /**
  * @brief Configuration for file data loader
  */
@@ -36,6 +44,18 @@ struct FileDataLoaderConfig : public DataLoaderConfig {
     std::string log_pattern = "";
     size_t num_threads = 0;
     bool use_memory_mapping = true;
+    size_t mmap_window_bytes = 256 * 1024 * 1024;       // Largest part of the file mapped at once
+    size_t mmap_prefetch_bytes = 64 * 1024 * 1024;      // Read ahead of the scan
+    bool mmap_release_consumed = true;                  // MADV_DONTNEED pages behind the scan
+    size_t mmap_populate_max_bytes = 16 * 1024 * 1024;  // MAP_POPULATE files up to this size
+    size_t memory_limit_mb = 0;                 // Bytes in flight between pipeline stages, 0 = unlimited
+    size_t target_batch_bytes = 1024 * 1024;    // Batch size the adaptive sizing aims for
+    bool ordered_delivery = true;   // process_large_file_with_callback delivers batches in file order
+    size_t error_ring_capacity = 1024;  // Parse errors each worker keeps, the most recent ones
+    bool use_io_uring = false;      // Read plain files through io_uring instead of mmap/ifstream
+    bool use_direct_io = false;     // With use_io_uring, bypass the page cache (O_DIRECT)
+    size_t io_queue_depth = 8;      // io_uring reads in flight
+    size_t io_buffer_bytes = 1024 * 1024;  // Size of each io_uring read
 };
 
 /**
@@ -44,6 +64,9 @@ struct FileDataLoaderConfig : public DataLoaderConfig {
 struct LogBatch {
     size_t id;
     std::vector<std::string> lines;
+    size_t bytes = 0;  // Approximate footprint of lines, charged to the memory budget
+    uint64_t first_line = 0;    // Number of the first line, see ParseError
+    uint64_t first_offset = 0;  // Byte offset of the first line, see ParseError
 };
 
 /**
@@ -52,6 +75,16 @@ struct LogBatch {
 struct ProcessedBatch {
     size_t id;
     std::vector<LogRecordObject> records;
+    size_t bytes = 0;  // Approximate footprint of records, charged to the memory budget
+};
+
+/**
+ * @brief Records parsed by one incremental run
+ */
+struct IncrementalParseResult {
+    std::vector<LogRecordObject> records;
+    bool resumed = false;        ///< Continued from the checkpoint; false means a full parse from byte 0
+    uint64_t first_record = 0;   ///< Row ID of records[0], counting from the start of the file
 };
 
 /**
@@ -82,8 +115,49 @@ public:
     void processInChunks(size_t chunk_size, 
         const std::function<void(const std::vector<LogParser::LogEntry>&)>& callback);
 
+    // Throws if the file is missing or a pipeline thread failed
     std::vector<LogRecordObject> load_data();
+
+    /**
+     * @brief Fraction of the input the current pipeline run has read, 1 once it is finished
+     */
     double get_progress() const;
+
+    /**
+     * @brief Throughput, latency, queue depth and error counts of the current or last pipeline run
+     *
+     * Cheap to call from another thread (or a batch callback) while
+     * load_data() or process_large_file_*() is running.
+     */
+    PipelineMetricsSnapshot metrics_snapshot() const;
+
+    /**
+     * @brief The metrics object itself, which stays valid after the loader is gone
+     */
+    std::shared_ptr<const PipelineMetrics> metrics() const { return metrics_; }
+
+    /**
+     * @brief Lines the current or last pipeline run failed to parse
+     *
+     * Each worker keeps its error_ring_capacity most recent errors; total
+     * counts all of them.
+     */
+    ParseErrorReport parse_errors() const { return parse_errors_->report(); }
+
+    /**
+     * @brief The error sink itself, which stays valid after the loader is gone
+     */
+    std::shared_ptr<const ParseErrorSink> parse_error_sink() const { return parse_errors_; }
+
+    /**
+     * @brief Key and value dictionaries shared by the records this loader parses
+     *
+     * Resolves field IDs and the codes of dictionary-encoded fields. A DRAIN
+     * model passed to set_template_parser() brings its own schema. Records
+     * do not own their schema: keep the loader, or this pointer, alive for
+     * as long as the records it returned are used.
+     */
+    std::shared_ptr<FieldSchema> field_schema() const { return field_schema_; }
     
     /**
      * @brief Parse a log file and return the parsed records
@@ -93,6 +167,31 @@ public:
      * @return std::vector<LogRecordObject> Vector of parsed log records
      */
     std::vector<LogRecordObject> parse_log_file(const std::string& filepath, const std::string& format);
+
+    /**
+     * @brief Parse only the lines appended to a file since a checkpoint
+     *
+     * Resumes at the checkpoint offset when can_resume() holds, otherwise
+     * parses from byte 0. A trailing line without a newline is parsed as it
+     * stands; if more is later written to that same line, the next run
+     * parses the file in full. Compressed files are always parsed in full.
+     *
+     * @param filepath The path to the log file
+     * @param format The format of the log file
+     * @param checkpoint In: state of the previous run (default-constructed if none). Out: state after this run
+     * @return IncrementalParseResult Records parsed in this run
+     */
+    IncrementalParseResult parse_log_file_incremental(const std::string& filepath, const std::string& format,
+                                                      IngestCheckpoint& checkpoint);
+
+    /**
+     * @brief Whether parsing can continue from a checkpoint
+     *
+     * Requires the same file with an unchanged consumed prefix, the same
+     * format and, for "drain", the same template model (see
+     * set_template_parser()).
+     */
+    bool can_resume(const std::string& filepath, const IngestCheckpoint& checkpoint);
     
     /**
      * @brief Process a large log file and return parsed records in batches
@@ -102,7 +201,12 @@ public:
      * @param chunk_size Number of lines per batch
      * @param callback Function to call with each batch of parsed records
      * @param memory_limit_mb Maximum memory limit in megabytes
-     * @return bool True if processing succeeded
+     * @return bool True if processing succeeded, false if it failed or the callback threw
+     *
+     * With config ordered_delivery (the default) batches arrive in file order
+     * on one consumer thread. Without it, each batch is delivered as soon as
+     * its worker is done: calls never overlap, but their order is arbitrary
+     * and no batch waits behind a slower one.
      */
     bool process_large_file_with_callback(
         const std::string& input_file,
@@ -111,6 +215,55 @@ public:
         const std::function<void(const std::vector<LogRecordObject>&)>& callback,
         size_t memory_limit_mb = 2000);
 
+    /**
+     * @brief Receives a batch on the worker thread that parsed it
+     *
+     * worker is in [0, pipeline_workers()); one worker never runs two calls at
+     * once, so state indexed by worker needs no locking.
+     */
+    using WorkerCallback = std::function<void(size_t worker, const std::vector<LogRecordObject>& records)>;
+
+    /**
+     * @brief Process a large log file, delivering each batch on its worker thread, in no particular order
+     */
+    bool process_large_file_per_worker(
+        const std::string& input_file,
+        const std::string& parser_type,
+        size_t chunk_size,
+        const WorkerCallback& callback,
+        size_t memory_limit_mb = 2000);
+
+    /**
+     * @brief Aggregate a large log file into per-worker partial results, then merge them
+     *
+     * Each worker folds its batches into its own default-constructed Partial
+     * with accumulate(partial, records), without locks or ordering. The
+     * partials are then combined with merge(result, std::move(partial)).
+     * Which batches land in which partial varies from run to run, so
+     * accumulate and merge must together be commutative and associative
+     * (counts, sets, sums, ...) for the result to be deterministic.
+     *
+     * @return bool True if processing succeeded; result holds what was merged either way
+     */
+    template <typename Partial, typename Accumulate, typename Merge>
+    bool aggregate_large_file(const std::string& input_file, const std::string& parser_type, size_t chunk_size,
+                              Partial& result, Accumulate accumulate, Merge merge, size_t memory_limit_mb = 2000) {
+        std::vector<Partial> partials(pipeline_workers());
+        const bool success = process_large_file_per_worker(
+            input_file, parser_type, chunk_size,
+            [&](size_t worker, const std::vector<LogRecordObject>& records) { accumulate(partials[worker], records); },
+            memory_limit_mb);
+        for (auto& partial : partials) {
+            merge(result, std::move(partial));
+        }
+        return success;
+    }
+
+    /**
+     * @brief Worker threads the batch pipeline runs: num_threads, or one per core
+     */
+    size_t pipeline_workers() const;
+
     /**
      * @brief Apply preprocessing to a batch of log lines
      * 
@@ -133,11 +286,30 @@ public:
     // Process a single batch of log lines
     void process_batch(const LogBatch& batch, ProcessedBatch& result);
 
+    /**
+     * @brief Shared DRAIN template model used by every worker when log_type is "drain"
+     *
+     * Created on first use. Cluster IDs and template statistics are consistent
+     * across all batches parsed by this loader.
+     */
+    std::shared_ptr<DrainParser> template_parser();
+
+    /**
+     * @brief Continue an existing DRAIN model, e.g. the one a checkpoint was taken with
+     *
+     * Must be called before parsing starts. The loader adopts the model's
+     * field schema. A null parser drops the model set before, so that a
+     * fresh one is created on first use.
+     */
+    void set_template_parser(std::shared_ptr<DrainParser> parser);
+
 private:
     std::string filepath_;
     FileDataLoaderConfig config_;
     std::unique_ptr<std::istream> input_stream_;
     std::unique_ptr<LogParser> parser_;
+    std::shared_ptr<DrainParser> template_parser_;
+    std::mutex template_parser_mutex_;
 
     // Initialize input stream based on file type
     void initInputStream();
@@ -145,6 +317,9 @@ private:
     // Initialize parser based on format
     void initParser();
 
+    // Parse line onto the end of entries in one pass; false (and nothing appended) if it fails
+    bool try_parse_into(const std::string& line, std::vector<LogParser::LogEntry>& entries);
+
     // Handle compressed files
     std::unique_ptr<std::istream> openCompressedFile();
 
@@ -159,11 +334,10 @@ private:
     std::string getFileExtension() const;
     void validateEncoding() const;
 
-    std::atomic<size_t> total_lines_read_{0};
-    std::atomic<size_t> processed_lines_{0};
-    std::atomic<size_t> failed_lines_{0};
     std::atomic<bool> running_{false};
-    std::atomic<double> progress_{0.0};
+    std::shared_ptr<PipelineMetrics> metrics_ = std::make_shared<PipelineMetrics>();
+    std::shared_ptr<ParseErrorSink> parse_errors_ = std::make_shared<ParseErrorSink>();
+    std::shared_ptr<FieldSchema> field_schema_ = std::make_shared<FieldSchema>();
     std::atomic<size_t> total_batches_{0};
     
     // Preprocessor (created on demand only if enabled)
@@ -176,6 +350,11 @@ private:
     std::atomic<size_t> queue_high_watermark_{200}; // Queue size to trigger batch size reduction
     std::atomic<size_t> queue_low_watermark_{10};   // Queue size to trigger batch size increase
     std::atomic<bool> memory_pressure_{false};      // Flag for memory pressure detection
+    MemoryBudget memory_budget_;                    // Bytes of batches and records in flight
+    std::atomic<bool> pipeline_failed_{false};      // A pipeline thread of this run stopped on an exception
+    std::atomic<size_t> produced_lines_{0};         // Lines and bytes batched so far, for bytes per line
+    std::atomic<size_t> produced_bytes_{0};
+    std::atomic<size_t> idle_workers_{0};           // Workers waiting for a batch
     
     // Multi-threading components
     ThreadSafeQueue<LogBatch> batch_queue_;
@@ -202,20 +381,44 @@ private:
         const std::string& filepath,
         std::function<void(std::string_view)> callback);
     
+    // Read a file with several io_uring reads in flight and split it into lines
+    void read_file_io_uring(
+        const std::string& filepath,
+        std::function<void(std::string_view)> callback);
+    
+    // Decompress a gzip/bzip2/zlib/zstd/lz4 file on several threads and split it into lines
+    void read_file_decompressed(
+        const std::string& filepath,
+        std::function<void(std::string_view)> callback);
+    
     void reader_thread(const std::string& filepath);
-    void worker_thread(ThreadSafeQueue<LogBatch>& input_queue, ThreadSafeQueue<ProcessedBatch>& output_queue);
+    // Parse batches from input_queue until it is done, handing each result to deliver;
+    // false if an exception stopped it with a batch undelivered
+    bool worker_thread(ThreadSafeQueue<LogBatch>& input_queue,
+                       const std::function<void(ProcessedBatch&&)>& deliver);
     void collector_thread();
     
     ProcessedBatch process_batch(const LogBatch& batch, const std::string& log_format = "");
     std::unique_ptr<LogParser> create_parser();
-    void producer_thread(MemoryMappedFile& file, ThreadSafeQueue<LogBatch>& input_queue, std::atomic<size_t>& total_batches);
-    void consumer_thread(size_t num_threads, ThreadSafeQueue<ProcessedBatch>& output_queue, std::vector<LogRecordObject>& results, std::atomic<size_t>& total_batches);
+    void producer_thread(ThreadSafeQueue<LogBatch>& input_queue, std::atomic<size_t>& total_batches);
+    // Append the batches of output_buffer to results in ID order until the stream ends;
+    // false if an exception stopped it
+    bool consumer_thread(ReorderBuffer<ProcessedBatch>& output_buffer, std::vector<LogRecordObject>& results);
+    // Fail the run after a pipeline thread stopped: wakes and stops every thread that could
+    // wait on its batch or its bytes
+    void abort_pipeline(ReorderBuffer<ProcessedBatch>& output_buffer);
 
     // Read file line by line with callback
     void read_file_line_by_line(const std::string& filepath, 
                                std::function<void(std::string_view)> callback);
                                
     // Memory monitoring functions
+    void reset_pipeline_state(size_t memory_limit_bytes, size_t max_batch_lines);
+    // Batch pipeline behind process_large_file_*: exactly one of the callbacks is set
+    bool process_large_file(const std::string& input_file, const std::string& parser_type, size_t chunk_size,
+                            size_t memory_limit_mb,
+                            const std::function<void(const std::vector<LogRecordObject>&)>& ordered_callback,
+                            const WorkerCallback& worker_callback);
     size_t get_current_memory_usage() const;
     void adjust_batch_size(ThreadSafeQueue<LogBatch>& queue);
     bool detect_memory_pressure() const;
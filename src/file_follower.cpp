@@ -0,0 +1,379 @@
+#include "file_follower.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+namespace logai {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint32_t kFileEvents = IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF;
+constexpr uint32_t kDirEvents = IN_CREATE | IN_MOVED_TO;
+
+std::runtime_error system_error(const std::string& what) {
+    return std::runtime_error(what + ", error: " + strerror(errno));
+}
+
+} // namespace
+
+struct FileFollower::Followed {
+    std::string path;
+    std::string directory;
+    std::string name;
+    LineCallback callback;
+    int fd = -1;
+    int watch = -1;
+    dev_t device = 0;
+    ino_t inode = 0;
+    uint64_t offset = 0;
+    std::string partial;              // Bytes after the last newline
+    bool skipping_long_line = false;  // Dropping the rest of an over-long line
+    bool needs_read = false;          // Data may be available past offset
+    bool check_path = false;          // The path may now name a different file
+};
+
+FileFollower::FileFollower(const FileFollowerConfig& config)
+    : config_(config), read_buffer_(config.read_chunk_bytes) {
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ == -1 || inotify_fd_ == -1 || wake_fd_ == -1) {
+        auto error = system_error("Failed to set up file follower");
+        for (int fd : {epoll_fd_, inotify_fd_, wake_fd_}) {
+            if (fd != -1) ::close(fd);
+        }
+        throw error;
+    }
+    for (int fd : {inotify_fd_, wake_fd_}) {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    }
+    thread_ = std::thread(&FileFollower::run, this);
+}
+
+FileFollower::~FileFollower() {
+    stop();
+    for (auto& [path, file] : files_) {
+        close_file(*file);
+    }
+    ::close(wake_fd_);
+    ::close(inotify_fd_);
+    ::close(epoll_fd_);
+}
+
+void FileFollower::add(const std::string& path, LineCallback callback, bool from_start) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (files_.count(path)) {
+        throw std::runtime_error("File already followed: " + path);
+    }
+
+    auto file = std::make_unique<Followed>();
+    const fs::path absolute = fs::absolute(path);
+    file->path = path;
+    file->directory = absolute.parent_path().string();
+    file->name = absolute.filename().string();
+    file->callback = std::move(callback);
+
+    // Watch the directory before opening, so a file created in between is not missed
+    auto dir_it = dir_watches_.find(file->directory);
+    if (dir_it == dir_watches_.end()) {
+        int watch = inotify_add_watch(inotify_fd_, file->directory.c_str(), kDirEvents);
+        if (watch == -1) {
+            throw system_error("Failed to watch directory: " + file->directory);
+        }
+        dirs_by_watch_[watch] = file->directory;
+        dir_it = dir_watches_.emplace(file->directory, std::make_pair(watch, size_t{0})).first;
+    }
+    ++dir_it->second.second;
+
+    open_file(*file, from_start);
+    file->needs_read = true;
+    files_.emplace(path, std::move(file));
+    wake();
+}
+
+void FileFollower::remove(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = files_.find(path);
+    if (it == files_.end()) {
+        return;
+    }
+    close_file(*it->second);
+
+    auto dir_it = dir_watches_.find(it->second->directory);
+    if (dir_it != dir_watches_.end() && --dir_it->second.second == 0) {
+        inotify_rm_watch(inotify_fd_, dir_it->second.first);
+        dirs_by_watch_.erase(dir_it->second.first);
+        dir_watches_.erase(dir_it);
+    }
+    files_.erase(it);
+}
+
+void FileFollower::stop() {
+    if (!stop_.exchange(true)) {
+        wake();
+    }
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void FileFollower::wake() {
+    uint64_t one = 1;
+    if (::write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        spdlog::warn("Failed to wake file follower: {}", strerror(errno));
+    }
+}
+
+void FileFollower::run() {
+    epoll_event events[2];
+    bool busy = false;
+    while (!stop_.load()) {
+        // Block until an event arrives unless a file still has data beyond its last read budget
+        int ready = epoll_wait(epoll_fd_, events, 2, busy ? 0 : -1);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            spdlog::error("File follower stopped: epoll_wait failed: {}", strerror(errno));
+            return;
+        }
+
+        bool inotify_ready = false;
+        for (int i = 0; i < ready; ++i) {
+            if (events[i].data.fd == wake_fd_) {
+                uint64_t count;
+                while (::read(wake_fd_, &count, sizeof(count)) > 0) {}
+            } else {
+                inotify_ready = true;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (inotify_ready) {
+            handle_inotify_events();
+        }
+        busy = false;
+        for (auto& [path, file] : files_) {
+            if (file->check_path) {
+                file->check_path = false;
+                check_replacement(*file);
+            }
+            if (file->needs_read) {
+                file->needs_read = read_available(*file, config_.max_bytes_per_wakeup);
+                busy = busy || file->needs_read;
+            }
+        }
+    }
+}
+
+void FileFollower::handle_inotify_events() {
+    alignas(inotify_event) char buffer[64 * 1024];
+    for (;;) {
+        ssize_t length = ::read(inotify_fd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;  // Drained (EAGAIN)
+        }
+        for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len) {
+            const auto* event = reinterpret_cast<const inotify_event*>(p);
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                spdlog::warn("inotify queue overflowed, re-checking all followed files");
+                for (auto& [path, file] : files_) {
+                    file->needs_read = true;
+                    file->check_path = true;
+                }
+                continue;
+            }
+
+            auto file_it = files_by_watch_.find(event->wd);
+            if (file_it != files_by_watch_.end()) {
+                Followed& file = *file_it->second;
+                if (event->mask & (IN_MODIFY | IN_ATTRIB)) {
+                    file.needs_read = true;
+                }
+                // Renamed or unlinked (an unlink while we hold the file open only shows as IN_ATTRIB)
+                if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_ATTRIB)) {
+                    file.check_path = true;
+                }
+                if (event->mask & IN_IGNORED) {
+                    file.watch = -1;
+                    files_by_watch_.erase(file_it);
+                }
+                continue;
+            }
+
+            auto dir_it = dirs_by_watch_.find(event->wd);
+            if (dir_it != dirs_by_watch_.end() && event->len > 0) {
+                // A file appeared under a followed name: the replacement after a rotation, or a late creation
+                for (auto& [path, file] : files_) {
+                    if (file->directory == dir_it->second && file->name == event->name) {
+                        file->check_path = true;
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool FileFollower::read_available(Followed& file, size_t budget) {
+    if (file.fd == -1) {
+        return false;
+    }
+    struct stat sb;
+    if (fstat(file.fd, &sb) == -1) {
+        spdlog::warn("Failed to stat followed file {}: {}", file.path, strerror(errno));
+        return false;
+    }
+    if (static_cast<uint64_t>(sb.st_size) < file.offset) {
+        spdlog::info("{} was truncated, reading it from the start", file.path);
+        truncations_.fetch_add(1, std::memory_order_relaxed);
+        file.offset = 0;
+        file.partial.clear();
+        file.skipping_long_line = false;
+    }
+
+    size_t consumed = 0;
+    while (consumed < budget) {
+        ssize_t n = pread(file.fd, read_buffer_.data(), read_buffer_.size(), static_cast<off_t>(file.offset));
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            spdlog::warn("Failed to read followed file {}: {}", file.path, strerror(errno));
+            return false;
+        }
+        if (n == 0) {
+            return false;
+        }
+        file.offset += static_cast<uint64_t>(n);
+        consumed += static_cast<size_t>(n);
+        bytes_read_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        deliver_lines(file, read_buffer_.data(), static_cast<size_t>(n));
+    }
+    return true;
+}
+
+void FileFollower::deliver_lines(Followed& file, const char* data, size_t size) {
+    const char* end = data + size;
+    const char* p = data;
+    while (p < end) {
+        const char* newline = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!newline) {
+            if (!file.skipping_long_line) {
+                file.partial.append(p, static_cast<size_t>(end - p));
+                if (file.partial.size() > config_.max_line_length) {
+                    spdlog::warn("Dropping line longer than {} bytes in {}", config_.max_line_length, file.path);
+                    file.partial.clear();
+                    file.skipping_long_line = true;
+                }
+            }
+            return;
+        }
+
+        if (file.skipping_long_line) {
+            file.skipping_long_line = false;
+        } else if (file.partial.empty()) {
+            emit_line(file, std::string_view(p, static_cast<size_t>(newline - p)));
+        } else {
+            file.partial.append(p, static_cast<size_t>(newline - p));
+            emit_line(file, file.partial);
+            file.partial.clear();
+        }
+        p = newline + 1;
+    }
+}
+
+void FileFollower::emit_line(Followed& file, std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    lines_delivered_.fetch_add(1, std::memory_order_relaxed);
+    try {
+        file.callback(line);
+    } catch (const std::exception& e) {
+        spdlog::warn("Error handling line from {}: {}", file.path, e.what());
+    }
+}
+
+void FileFollower::check_replacement(Followed& file) {
+    struct stat sb;
+    if (stat(file.path.c_str(), &sb) == -1) {
+        return;  // Renamed away or deleted; keep reading the old file until a new one appears
+    }
+    if (file.fd != -1 && sb.st_dev == file.device && sb.st_ino == file.inode) {
+        return;
+    }
+
+    // Finish the rotated file, including an unterminated last line, then switch
+    if (file.fd != -1) {
+        while (read_available(file, std::numeric_limits<size_t>::max())) {}
+        if (!file.partial.empty() && !file.skipping_long_line) {
+            emit_line(file, file.partial);
+        }
+        close_file(file);
+        rotations_.fetch_add(1, std::memory_order_relaxed);
+        spdlog::info("{} was rotated, following the new file", file.path);
+    }
+    if (open_file(file, true)) {
+        file.needs_read = true;
+    }
+}
+
+bool FileFollower::open_file(Followed& file, bool from_start) {
+    file.partial.clear();
+    file.skipping_long_line = false;
+    file.offset = 0;
+
+    int fd = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        if (errno != ENOENT) {
+            spdlog::warn("Failed to open followed file {}: {}", file.path, strerror(errno));
+        }
+        return false;  // Picked up when the directory reports its creation
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+        spdlog::warn("Failed to stat followed file {}: {}", file.path, strerror(errno));
+        ::close(fd);
+        return false;
+    }
+    int watch = inotify_add_watch(inotify_fd_, file.path.c_str(), kFileEvents);
+    if (watch == -1) {
+        spdlog::warn("Failed to watch followed file {}: {}", file.path, strerror(errno));
+        ::close(fd);
+        return false;
+    }
+
+    file.fd = fd;
+    file.watch = watch;
+    file.device = sb.st_dev;
+    file.inode = sb.st_ino;
+    file.offset = from_start ? 0 : static_cast<uint64_t>(sb.st_size);
+    files_by_watch_[watch] = &file;
+    return true;
+}
+
+void FileFollower::close_file(Followed& file) {
+    if (file.watch != -1) {
+        files_by_watch_.erase(file.watch);
+        inotify_rm_watch(inotify_fd_, file.watch);
+        file.watch = -1;
+    }
+    if (file.fd != -1) {
+        ::close(file.fd);
+        file.fd = -1;
+    }
+}
+
+} // namespace logai
@@ -0,0 +1,114 @@
+/**
+ * @file file_follower.h
+ * @brief Event-driven tail -F for growing log files (inotify + epoll)
+ */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <folly/container/F14Map.h>
+
+namespace logai {
+
+/**
+ * @brief Configuration for the FileFollower
+ */
+struct FileFollowerConfig {
+    size_t read_chunk_bytes = 64 * 1024;            ///< Size of one read from a followed file
+    size_t max_bytes_per_wakeup = 4 * 1024 * 1024;  ///< Bytes read from one file before serving the others
+    size_t max_line_length = 1024 * 1024;           ///< Longer lines are dropped
+};
+
+/**
+ * @brief Follows any number of files on one event-loop thread and delivers their new complete lines
+ *
+ * Appends are picked up from inotify events rather than by polling. Each
+ * file's parent directory is watched as well, so a file that is renamed
+ * away (logrotate) or deleted is finished and then replaced by the new file
+ * of the same name once it appears; a file that shrinks below the consumed
+ * offset (copytruncate) is read again from byte 0. A line is delivered once
+ * its newline has been written; the unterminated tail of a rotated file is
+ * delivered when the file is replaced. Files that do not exist yet are
+ * followed from their creation.
+ *
+ * Callbacks run on the event-loop thread, one file at a time, and must not
+ * call add() or remove().
+ */
+class FileFollower {
+public:
+    using LineCallback = std::function<void(std::string_view line)>;
+
+    explicit FileFollower(const FileFollowerConfig& config = FileFollowerConfig());
+    ~FileFollower();
+
+    FileFollower(const FileFollower&) = delete;
+    FileFollower& operator=(const FileFollower&) = delete;
+
+    /**
+     * @brief Start following a file
+     *
+     * @param path File to follow, need not exist yet
+     * @param callback Receives each complete line without its newline
+     * @param from_start Deliver the lines already in the file, otherwise start at its current end
+     * @throws std::runtime_error if the path is already followed or its directory cannot be watched
+     */
+    void add(const std::string& path, LineCallback callback, bool from_start = true);
+
+    /**
+     * @brief Stop following a file; no callback for it runs after this returns
+     */
+    void remove(const std::string& path);
+
+    /**
+     * @brief Stop the event loop; called by the destructor
+     */
+    void stop();
+
+    uint64_t bytes_read() const { return bytes_read_.load(std::memory_order_relaxed); }
+    uint64_t lines_delivered() const { return lines_delivered_.load(std::memory_order_relaxed); }
+    uint64_t rotations() const { return rotations_.load(std::memory_order_relaxed); }
+    uint64_t truncations() const { return truncations_.load(std::memory_order_relaxed); }
+
+private:
+    struct Followed;
+
+    void run();
+    void wake();
+    void handle_inotify_events();
+    bool read_available(Followed& file, size_t budget);
+    void deliver_lines(Followed& file, const char* data, size_t size);
+    void emit_line(Followed& file, std::string_view line);
+    void check_replacement(Followed& file);
+    bool open_file(Followed& file, bool from_start);
+    void close_file(Followed& file);
+
+    FileFollowerConfig config_;
+    int epoll_fd_ = -1;
+    int inotify_fd_ = -1;
+    int wake_fd_ = -1;
+
+    // Guards the tables below; held by the event loop while it reads files and runs callbacks
+    std::mutex mutex_;
+    std::map<std::string, std::unique_ptr<Followed>> files_;
+    folly::F14FastMap<int, Followed*> files_by_watch_;
+    folly::F14FastMap<int, std::string> dirs_by_watch_;
+    std::map<std::string, std::pair<int, size_t>> dir_watches_;  // Directory -> (watch, followed files in it)
+    std::vector<char> read_buffer_;  // Used by the event loop only
+
+    std::atomic<bool> stop_{false};
+    std::atomic<uint64_t> bytes_read_{0};
+    std::atomic<uint64_t> lines_delivered_{0};
+    std::atomic<uint64_t> rotations_{0};
+    std::atomic<uint64_t> truncations_{0};
+    std::thread thread_;
+};
+
+} // namespace logai
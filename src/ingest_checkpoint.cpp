@@ -0,0 +1,154 @@
+#include "ingest_checkpoint.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <sys/stat.h>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+
+namespace logai {
+
+namespace {
+
+constexpr uint64_t kTailHashBytes = 4096;
+constexpr int kCheckpointVersion = 2;
+
+uint64_t fnv1a(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+uint64_t hash_file_tail(const std::string& file_path, uint64_t offset) {
+    std::ifstream file(file_path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + file_path);
+    }
+    const uint64_t start = offset > kTailHashBytes ? offset - kTailHashBytes : 0;
+    std::vector<char> tail(static_cast<size_t>(offset - start));
+    file.seekg(static_cast<std::streamoff>(start));
+    file.read(tail.data(), static_cast<std::streamsize>(tail.size()));
+    if (static_cast<uint64_t>(file.gcount()) != tail.size()) {
+        throw std::runtime_error("Failed to read file: " + file_path);
+    }
+    return fnv1a(tail.data(), tail.size());
+}
+
+void stamp_checkpoint_file(IngestCheckpoint& checkpoint, const std::string& file_path) {
+    struct stat sb;
+    if (stat(file_path.c_str(), &sb) == -1) {
+        throw std::runtime_error("Failed to stat file: " + file_path + ", error: " + strerror(errno));
+    }
+    checkpoint.source_path = file_path;
+    checkpoint.device = static_cast<uint64_t>(sb.st_dev);
+    checkpoint.inode = static_cast<uint64_t>(sb.st_ino);
+    checkpoint.file_size = static_cast<uint64_t>(sb.st_size);
+}
+
+bool checkpoint_matches_file(const IngestCheckpoint& checkpoint, const std::string& file_path) {
+    struct stat sb;
+    if (stat(file_path.c_str(), &sb) == -1) {
+        return false;
+    }
+    // Rotated (new inode) or truncated below what was consumed
+    if (static_cast<uint64_t>(sb.st_dev) != checkpoint.device || static_cast<uint64_t>(sb.st_ino) != checkpoint.inode ||
+        static_cast<uint64_t>(sb.st_size) < checkpoint.offset) {
+        return false;
+    }
+
+    try {
+        if (hash_file_tail(file_path, checkpoint.offset) != checkpoint.tail_hash) {
+            return false;
+        }
+        // A final line parsed without its newline must not have grown since
+        if (checkpoint.unterminated && static_cast<uint64_t>(sb.st_size) > checkpoint.offset) {
+            std::ifstream file(file_path, std::ios::binary);
+            file.seekg(static_cast<std::streamoff>(checkpoint.offset));
+            if (file.get() != '\n') {
+                return false;
+            }
+        }
+    } catch (const std::exception& e) {
+        spdlog::warn("Cannot validate checkpoint for {}: {}", file_path, e.what());
+        return false;
+    }
+    return true;
+}
+
+std::optional<IngestCheckpoint> load_ingest_checkpoint(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.is_open()) {
+        return std::nullopt;
+    }
+    try {
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        nlohmann::json j = nlohmann::json::parse(buffer.str());
+        if (j.at("version").get<int>() != kCheckpointVersion) {
+            return std::nullopt;
+        }
+        IngestCheckpoint checkpoint;
+        checkpoint.source_path = j.at("source_path").get<std::string>();
+        checkpoint.format = j.at("format").get<std::string>();
+        checkpoint.device = j.at("device").get<uint64_t>();
+        checkpoint.inode = j.at("inode").get<uint64_t>();
+        checkpoint.file_size = j.at("file_size").get<uint64_t>();
+        checkpoint.offset = j.at("offset").get<uint64_t>();
+        checkpoint.lines = j.at("lines").get<uint64_t>();
+        checkpoint.records = j.at("records").get<uint64_t>();
+        checkpoint.tail_hash = j.at("tail_hash").get<uint64_t>();
+        checkpoint.unterminated = j.at("unterminated").get<bool>();
+        checkpoint.model_id = j.at("model_id").get<uint64_t>();
+        checkpoint.model_generation = j.at("model_generation").get<uint64_t>();
+        return checkpoint;
+    } catch (const std::exception& e) {
+        spdlog::warn("Ignoring invalid checkpoint {}: {}", path, e.what());
+        return std::nullopt;
+    }
+}
+
+void save_ingest_checkpoint(const std::string& path, const IngestCheckpoint& checkpoint) {
+    nlohmann::json j;
+    j["version"] = kCheckpointVersion;
+    j["source_path"] = checkpoint.source_path;
+    j["format"] = checkpoint.format;
+    j["device"] = checkpoint.device;
+    j["inode"] = checkpoint.inode;
+    j["file_size"] = checkpoint.file_size;
+    j["offset"] = checkpoint.offset;
+    j["lines"] = checkpoint.lines;
+    j["records"] = checkpoint.records;
+    j["tail_hash"] = checkpoint.tail_hash;
+    j["unterminated"] = checkpoint.unterminated;
+    j["model_id"] = checkpoint.model_id;
+    j["model_generation"] = checkpoint.model_generation;
+
+    // Replace the old checkpoint atomically, a crash leaves either one intact
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path, std::ios::trunc);
+        // Invalid UTF-8 in a path is replaced rather than failing the dump
+        out << j.dump(2, ' ', false, nlohmann::json::error_handler_t::replace);
+        if (!out) {
+            throw std::runtime_error("Failed to write checkpoint: " + tmp_path);
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, path, ec);
+    if (ec) {
+        throw std::runtime_error("Failed to replace checkpoint: " + path + ", error: " + ec.message());
+    }
+}
+
+} // namespace logai
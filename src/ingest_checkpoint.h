@@ -0,0 +1,70 @@
+/**
+ * @file ingest_checkpoint.h
+ * @brief Resume point for incremental parsing of an append-only log file
+ */
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace logai {
+
+/**
+ * @brief How far a source file has been parsed
+ *
+ * The offset sits just past a newline, or at the end of a final line that
+ * had none: that line is parsed as it stood, and the checkpoint only
+ * applies as long as the next byte written after it is its newline. A
+ * checkpoint only applies to the same file (device and inode) whose
+ * consumed prefix is unchanged, so rotation, truncation or a line that was
+ * still being written is detected and leads to a full parse.
+ */
+struct IngestCheckpoint {
+    std::string source_path;
+    std::string format;
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    uint64_t file_size = 0;         ///< Size when the checkpoint was taken
+    uint64_t offset = 0;            ///< Bytes consumed, at a line boundary unless unterminated
+    uint64_t lines = 0;             ///< Lines consumed up to offset
+    uint64_t records = 0;           ///< Records produced up to offset, the next row ID
+    uint64_t tail_hash = 0;         ///< Hash of the bytes just before offset
+    bool unterminated = false;      ///< The last line consumed had no newline yet
+    uint64_t model_id = 0;          ///< DRAIN model that produced the records, 0 if none
+    uint64_t model_generation = 0;  ///< DRAIN model generation at the checkpoint
+};
+
+/**
+ * @brief Hash of up to the last 4 KiB of a file before offset
+ *
+ * @throws std::runtime_error if the file cannot be read
+ */
+uint64_t hash_file_tail(const std::string& file_path, uint64_t offset);
+
+/**
+ * @brief Whether file_path is still the file a checkpoint was taken on, with its consumed prefix unchanged
+ */
+bool checkpoint_matches_file(const IngestCheckpoint& checkpoint, const std::string& file_path);
+
+/**
+ * @brief Record the identity and size of a file in a checkpoint
+ *
+ * @throws std::runtime_error if the file cannot be stat'ed
+ */
+void stamp_checkpoint_file(IngestCheckpoint& checkpoint, const std::string& file_path);
+
+/**
+ * @brief Read a checkpoint written by save_ingest_checkpoint()
+ *
+ * @return std::nullopt if the file is missing or not a valid checkpoint
+ */
+std::optional<IngestCheckpoint> load_ingest_checkpoint(const std::string& path);
+
+/**
+ * @brief Atomically write a checkpoint as JSON
+ *
+ * @throws std::runtime_error if the file cannot be written
+ */
+void save_ingest_checkpoint(const std::string& path, const IngestCheckpoint& checkpoint);
+
+} // namespace logai
@@ -0,0 +1,374 @@
+#include "inverted_index.h"
+
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+#include <stdexcept>
+
+namespace logai {
+
+namespace {
+
+bool is_token_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+char to_lower(char c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// Call fn(token) for each lowercased token of text, token is reused between calls
+template <typename Fn>
+void for_each_token(std::string_view text, size_t max_length, std::string& token, Fn&& fn) {
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && !is_token_char(text[i])) ++i;
+        const size_t start = i;
+        while (i < text.size() && is_token_char(text[i])) ++i;
+        const size_t length = i - start;
+        if (length == 0 || length > max_length) {
+            continue;
+        }
+        token.resize(length);
+        for (size_t j = 0; j < length; ++j) {
+            token[j] = to_lower(text[start + j]);
+        }
+        fn(token);
+    }
+}
+
+using RowIds = std::vector<uint32_t>;
+
+RowIds intersect(const RowIds& a, const RowIds& b) {
+    RowIds out;
+    out.reserve(std::min(a.size(), b.size()));
+    std::set_intersection(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+    return out;
+}
+
+RowIds unite(const RowIds& a, const RowIds& b) {
+    RowIds out;
+    out.reserve(a.size() + b.size());
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+    return out;
+}
+
+RowIds subtract(const RowIds& a, const RowIds& b) {
+    RowIds out;
+    out.reserve(a.size());
+    std::set_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(out));
+    return out;
+}
+
+enum class TokenKind { Term, Quoted, And, Or, Not, LParen, RParen, End };
+
+struct QueryToken {
+    TokenKind kind;
+    std::string_view text;
+};
+
+std::vector<QueryToken> lex_query(std::string_view query) {
+    std::vector<QueryToken> tokens;
+    size_t i = 0;
+    while (i < query.size()) {
+        const char c = query[i];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            ++i;
+        } else if (c == '(') {
+            tokens.push_back({TokenKind::LParen, query.substr(i, 1)});
+            ++i;
+        } else if (c == ')') {
+            tokens.push_back({TokenKind::RParen, query.substr(i, 1)});
+            ++i;
+        } else if (c == '"') {
+            const size_t close = query.find('"', i + 1);
+            if (close == std::string_view::npos) {
+                throw std::invalid_argument("Unterminated quote in query");
+            }
+            tokens.push_back({TokenKind::Quoted, query.substr(i + 1, close - i - 1)});
+            i = close + 1;
+        } else {
+            const size_t start = i;
+            while (i < query.size() && query[i] != ' ' && query[i] != '\t' && query[i] != '\n' &&
+                   query[i] != '\r' && query[i] != '(' && query[i] != ')' && query[i] != '"') {
+                ++i;
+            }
+            std::string_view word = query.substr(start, i - start);
+            TokenKind kind = TokenKind::Term;
+            if (word == "AND") kind = TokenKind::And;
+            else if (word == "OR") kind = TokenKind::Or;
+            else if (word == "NOT") kind = TokenKind::Not;
+            tokens.push_back({kind, word});
+        }
+    }
+    tokens.push_back({TokenKind::End, {}});
+    return tokens;
+}
+
+// Recursive-descent evaluator, runs under the index read lock:
+//   or    := and ("OR" and)*
+//   and   := unary (["AND"] unary)*
+//   unary := "NOT"* primary
+//   primary := "(" or ")" | term | quoted
+class QueryEvaluator {
+public:
+    QueryEvaluator(const folly::F14FastMap<std::string, PostingList>& tokens,
+                   const folly::F14FastMap<int, PostingList>& templates,
+                   uint32_t row_count, size_t max_token_length)
+        : tokens_(tokens), templates_(templates), row_count_(row_count), max_token_length_(max_token_length) {}
+
+    RowIds evaluate(std::string_view query) {
+        lexed_ = lex_query(query);
+        pos_ = 0;
+        if (peek() == TokenKind::End) {
+            throw std::invalid_argument("Empty query");
+        }
+        RowIds rows = parse_or();
+        if (peek() != TokenKind::End) {
+            throw std::invalid_argument("Unexpected '" + std::string(lexed_[pos_].text) + "' in query");
+        }
+        return rows;
+    }
+
+private:
+    struct Operand {
+        RowIds rows;
+        bool negated = false;
+    };
+
+    TokenKind peek() const { return lexed_[pos_].kind; }
+
+    static bool starts_operand(TokenKind kind) {
+        return kind == TokenKind::Term || kind == TokenKind::Quoted || kind == TokenKind::Not ||
+               kind == TokenKind::LParen;
+    }
+
+    RowIds parse_or() {
+        RowIds rows = parse_and();
+        while (peek() == TokenKind::Or) {
+            ++pos_;
+            rows = unite(rows, parse_and());
+        }
+        return rows;
+    }
+
+    RowIds parse_and() {
+        std::vector<Operand> operands;
+        operands.push_back(parse_unary());
+        while (true) {
+            if (peek() == TokenKind::And) {
+                ++pos_;
+                if (!starts_operand(peek())) {
+                    throw std::invalid_argument("AND without right-hand operand");
+                }
+            } else if (!starts_operand(peek())) {
+                break;
+            }
+            operands.push_back(parse_unary());
+        }
+
+        // Intersect positives smallest first, then subtract negated operands
+        std::vector<const RowIds*> positive, negative;
+        for (const auto& operand : operands) {
+            (operand.negated ? negative : positive).push_back(&operand.rows);
+        }
+        std::sort(positive.begin(), positive.end(),
+                  [](const RowIds* a, const RowIds* b) { return a->size() < b->size(); });
+
+        RowIds rows = positive.empty() ? all_rows() : *positive.front();
+        for (size_t i = 1; i < positive.size() && !rows.empty(); ++i) {
+            rows = intersect(rows, *positive[i]);
+        }
+        for (size_t i = 0; i < negative.size() && !rows.empty(); ++i) {
+            rows = subtract(rows, *negative[i]);
+        }
+        return rows;
+    }
+
+    Operand parse_unary() {
+        bool negated = false;
+        while (peek() == TokenKind::Not) {
+            ++pos_;
+            negated = !negated;
+        }
+        return Operand{parse_primary(), negated};
+    }
+
+    RowIds parse_primary() {
+        const QueryToken token = lexed_[pos_];
+        switch (token.kind) {
+            case TokenKind::LParen: {
+                ++pos_;
+                RowIds rows = parse_or();
+                if (peek() != TokenKind::RParen) {
+                    throw std::invalid_argument("Missing ')' in query");
+                }
+                ++pos_;
+                return rows;
+            }
+            case TokenKind::Term:
+            case TokenKind::Quoted:
+                ++pos_;
+                return term_rows(token.text, token.kind == TokenKind::Term);
+            default:
+                throw std::invalid_argument("Expected a term in query");
+        }
+    }
+
+    RowIds term_rows(std::string_view text, bool allow_operators) {
+        constexpr std::string_view kTemplatePrefix = "template:";
+        if (allow_operators && text.substr(0, kTemplatePrefix.size()) == kTemplatePrefix) {
+            std::string_view id_text = text.substr(kTemplatePrefix.size());
+            int template_id = -1;
+            if (std::from_chars(id_text.data(), id_text.data() + id_text.size(), template_id).ec != std::errc()) {
+                throw std::invalid_argument("Invalid template ID in query: " + std::string(text));
+            }
+            auto it = templates_.find(template_id);
+            return it != templates_.end() ? it->second.decode() : RowIds();
+        }
+
+        if (allow_operators && text.size() > 1 && text.back() == '*') {
+            return prefix_rows(text.substr(0, text.size() - 1));
+        }
+
+        // A term spanning several tokens ("10.0.0.1", "user_id=17") needs all of them
+        std::vector<const PostingList*> lists;
+        bool missing = false;
+        std::string token;
+        for_each_token(text, max_token_length_, token, [&](const std::string& t) {
+            auto it = tokens_.find(t);
+            if (it == tokens_.end()) {
+                missing = true;
+            } else {
+                lists.push_back(&it->second);
+            }
+        });
+        if (missing || lists.empty()) {
+            return RowIds();
+        }
+        std::sort(lists.begin(), lists.end(),
+                  [](const PostingList* a, const PostingList* b) { return a->size() < b->size(); });
+        RowIds rows = lists.front()->decode();
+        for (size_t i = 1; i < lists.size() && !rows.empty(); ++i) {
+            rows = intersect(rows, lists[i]->decode());
+        }
+        return rows;
+    }
+
+    RowIds prefix_rows(std::string_view prefix) {
+        std::string lowered(prefix.size(), '\0');
+        std::transform(prefix.begin(), prefix.end(), lowered.begin(), to_lower);
+
+        RowIds rows;
+        for (const auto& [token, list] : tokens_) {
+            if (token.size() >= lowered.size() && std::string_view(token).substr(0, lowered.size()) == lowered) {
+                rows = unite(rows, list.decode());
+            }
+        }
+        return rows;
+    }
+
+    RowIds all_rows() const {
+        RowIds rows(row_count_);
+        for (uint32_t i = 0; i < row_count_; ++i) {
+            rows[i] = i;
+        }
+        return rows;
+    }
+
+    const folly::F14FastMap<std::string, PostingList>& tokens_;
+    const folly::F14FastMap<int, PostingList>& templates_;
+    uint32_t row_count_;
+    size_t max_token_length_;
+    std::vector<QueryToken> lexed_;
+    size_t pos_ = 0;
+};
+
+} // namespace
+
+InvertedIndex::InvertedIndex(const InvertedIndexConfig& config)
+    : config_(config) {}
+
+void InvertedIndex::add_locked(Postings& postings, uint32_t row_id, int template_id, std::string_view text,
+                               std::string& token) const {
+    if (template_id >= 0) {
+        postings.templates[template_id].add(row_id);
+    }
+    for_each_token(text, config_.max_token_length, token, [&](const std::string& t) {
+        auto it = postings.tokens.find(t);
+        if (it == postings.tokens.end()) {
+            it = postings.tokens.emplace(t, PostingList()).first;
+        }
+        it->second.add(row_id);
+    });
+    postings.row_count = std::max(postings.row_count, row_id + 1);
+}
+
+void InvertedIndex::add(uint32_t row_id, int template_id, std::string_view text) {
+    std::string token;
+    auto postings = postings_.wlock();
+    add_locked(*postings, row_id, template_id, text, token);
+}
+
+void InvertedIndex::add_batch(uint32_t first_row_id, const std::vector<LogRecordObject>& records) {
+    std::string token;
+    auto postings = postings_.wlock();
+    uint32_t row_id = first_row_id;
+    for (const auto& record : records) {
+        int template_id = -1;
+        if (const auto* cluster_id = record.fields.find(FieldSchema::kClusterId)) {
+            const char* first = cluster_id->data();
+            std::from_chars(first, first + cluster_id->size(), template_id);
+        }
+        const std::string& text = record.message.empty() ? record.body : record.message;
+        add_locked(*postings, row_id++, template_id, text, token);
+    }
+}
+
+std::vector<uint32_t> InvertedIndex::search(std::string_view query) const {
+    auto postings = postings_.rlock();
+    QueryEvaluator evaluator(postings->tokens, postings->templates, postings->row_count, config_.max_token_length);
+    return evaluator.evaluate(query);
+}
+
+size_t InvertedIndex::count(std::string_view query) const {
+    return search(query).size();
+}
+
+std::vector<uint32_t> InvertedIndex::template_rows(int template_id) const {
+    auto postings = postings_.rlock();
+    auto it = postings->templates.find(template_id);
+    return it != postings->templates.end() ? it->second.decode() : std::vector<uint32_t>();
+}
+
+std::vector<uint32_t> InvertedIndex::token_rows(std::string_view token) const {
+    std::string lowered(token.size(), '\0');
+    std::transform(token.begin(), token.end(), lowered.begin(), to_lower);
+    auto postings = postings_.rlock();
+    auto it = postings->tokens.find(lowered);
+    return it != postings->tokens.end() ? it->second.decode() : std::vector<uint32_t>();
+}
+
+InvertedIndexStats InvertedIndex::stats() const {
+    auto postings = postings_.rlock();
+    InvertedIndexStats stats;
+    stats.rows = postings->row_count;
+    stats.tokens = postings->tokens.size();
+    stats.templates = postings->templates.size();
+    for (const auto& [token, list] : postings->tokens) {
+        stats.memory_bytes += token.capacity() + sizeof(PostingList) + list.memory_usage();
+    }
+    for (const auto& [id, list] : postings->templates) {
+        stats.memory_bytes += sizeof(PostingList) + list.memory_usage();
+    }
+    return stats;
+}
+
+void InvertedIndex::clear() {
+    auto postings = postings_.wlock();
+    postings->tokens.clear();
+    postings->templates.clear();
+    postings->row_count = 0;
+}
+
+} // namespace logai
@@ -0,0 +1,123 @@
+/**
+ * @file inverted_index.h
+ * @brief Template and token inverted index over ingested log rows
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include "log_record.h"
+#include "posting_list.h"
+
+namespace logai {
+
+/**
+ * @brief Configuration for the InvertedIndex
+ */
+struct InvertedIndexConfig {
+    size_t max_token_length = 64;  ///< Longer tokens are not indexed
+};
+
+/**
+ * @brief Size of an InvertedIndex
+ */
+struct InvertedIndexStats {
+    size_t rows = 0;          ///< Highest indexed row ID + 1
+    size_t tokens = 0;        ///< Distinct tokens
+    size_t templates = 0;     ///< Distinct template IDs
+    size_t memory_bytes = 0;  ///< Approximate heap bytes of the posting lists
+};
+
+/**
+ * @brief Maps template IDs and message tokens to compressed lists of row IDs
+ *
+ * Tokens are maximal runs of [A-Za-z0-9_], lowercased. Rows must be added
+ * in ascending row ID order. Queries combine terms with AND, OR, NOT and
+ * parentheses:
+ *
+ *   connection refused              (adjacent terms are ANDed)
+ *   timeout OR (reset AND NOT retry)
+ *   template:42 AND db*             (template ID, token prefix)
+ *   "user_id=17"                    (all tokens of the quoted text)
+ *
+ * Operators are recognized in upper case only. Thread-safe: queries share
+ * a read lock, adds take the write lock.
+ */
+class InvertedIndex {
+public:
+    /**
+     * @brief Construct a new InvertedIndex object
+     *
+     * @param config Tokenizer settings
+     */
+    explicit InvertedIndex(const InvertedIndexConfig& config = InvertedIndexConfig());
+
+    /**
+     * @brief Index one row
+     *
+     * @param row_id Row ID, not smaller than any previously added row
+     * @param template_id Template (DRAIN cluster) ID, negative if none
+     * @param text Message text to tokenize
+     */
+    void add(uint32_t row_id, int template_id, std::string_view text);
+
+    /**
+     * @brief Index a parsed batch as rows first_row_id, first_row_id + 1, ...
+     *
+     * The template ID is read from the cluster_id field; the message is
+     * indexed, or the body when the message is empty.
+     */
+    void add_batch(uint32_t first_row_id, const std::vector<LogRecordObject>& records);
+
+    /**
+     * @brief Evaluate a query
+     *
+     * @param query Query string, see the class description
+     * @return std::vector<uint32_t> Matching row IDs in ascending order
+     * @throws std::invalid_argument if the query is malformed
+     */
+    std::vector<uint32_t> search(std::string_view query) const;
+
+    /**
+     * @brief Number of rows matching a query
+     *
+     * @throws std::invalid_argument if the query is malformed
+     */
+    size_t count(std::string_view query) const;
+
+    /**
+     * @brief Rows of one template in ascending order
+     */
+    std::vector<uint32_t> template_rows(int template_id) const;
+
+    /**
+     * @brief Rows containing a token (case-insensitive) in ascending order
+     */
+    std::vector<uint32_t> token_rows(std::string_view token) const;
+
+    InvertedIndexStats stats() const;
+
+    /**
+     * @brief Drop all postings
+     */
+    void clear();
+
+private:
+    struct Postings {
+        folly::F14FastMap<std::string, PostingList> tokens;
+        folly::F14FastMap<int, PostingList> templates;
+        uint32_t row_count = 0;
+    };
+
+    void add_locked(Postings& postings, uint32_t row_id, int template_id, std::string_view text,
+                    std::string& token) const;
+
+    InvertedIndexConfig config_;
+    folly::Synchronized<Postings> postings_;
+};
+
+} // namespace logai
@@ -3,7 +3,12 @@
 
 namespace logai {
 
-JsonParser::JsonParser(const DataLoaderConfig& config) : config_(config) {}
+JsonParser::JsonParser(const DataLoaderConfig& config, std::shared_ptr<FieldSchema> schema)
+    : LogParser(std::move(schema)), config_(config) {
+    for (const auto& dimension : config_.dimensions) {
+        dimension_ids_.push_back(field_schema_->intern(dimension));
+    }
+}
 
 JsonParser::~JsonParser() noexcept {}
 
@@ -48,84 +53,103 @@ std::optional<std::chrono::system_clock::time_point> JsonParser::parse_timestamp
 
 LogParser::LogEntry JsonParser::parse(const std::string& line) {
     LogParser::LogEntry entry;
-    try {
-        // Use the existing parse_line implementation to get the LogRecordObject
-        LogRecordObject record = parse_line(line);
-        
-        // Convert LogRecordObject to LogEntry
-        entry.timestamp = record.timestamp ? std::to_string(record.timestamp->time_since_epoch().count()) : "";
-        entry.level = record.level;
-        entry.message = record.message;
-        
-        // Copy fields to fields
-        for (const auto& [key, value] : record.fields) {
-            entry.fields[key.toStdString()] = value.toStdString();
-        }
-    } catch (const std::exception& e) {
-        throw std::runtime_error("Failed to parse log line: " + std::string(e.what()));
-    }
-    
+    throw_if_failed(try_parse(line, entry), "JSON");
     return entry;
 }
 
-bool JsonParser::validate(const std::string& line) {
-    try {
-        auto json = nlohmann::json::parse(line);
-        return !json.empty();
-    } catch (const nlohmann::json::exception&) {
-        return false;
+ParseStatus JsonParser::try_parse(const std::string& line, LogEntry& entry) noexcept {
+    LogRecordObject record;
+    const ParseStatus status = try_parse_line(line, record);
+    if (status != ParseStatus::Ok) {
+        return status;
     }
+    return guarded([&] {
+        entry = LogEntry::from_record(std::move(record));
+        return ParseStatus::Ok;
+    });
+}
+
+bool JsonParser::validate(const std::string& line) {
+    // Without exceptions, invalid JSON parses to a discarded value
+    auto json = nlohmann::json::parse(line, nullptr, false);
+    return !json.is_discarded() && !json.empty();
 }
 
 LogRecordObject JsonParser::parse_line(const std::string& line) {
     LogRecordObject record;
-    try {
-        nlohmann::json json = nlohmann::json::parse(line);
-        
+    throw_if_failed(try_parse_line(line, record), "JSON");
+    return record;
+}
+
+ParseStatus JsonParser::try_parse_line(const std::string& line, LogRecordObject& record) noexcept {
+    return guarded([&] {
+        const nlohmann::json json = nlohmann::json::parse(line, nullptr, false);
+        if (json.is_discarded() || !json.is_object()) {
+            return ParseStatus::Malformed;
+        }
+        record.fields.reset(field_schema_.get());
+
+        // Value of key if it is a string; a key of another type makes the record invalid
+        bool invalid = false;
+        auto string_at = [&](const std::string& key) -> const std::string* {
+            auto it = json.find(key);
+            if (it == json.end()) {
+                return nullptr;
+            }
+            if (!it->is_string()) {
+                invalid = true;
+                return nullptr;
+            }
+            return it->get_ptr<const std::string*>();
+        };
+
         // Extract fields based on config dimensions
-        for (const auto& dimension : config_.dimensions) {
-            if (json.contains(dimension)) {
-                if (dimension == "body") {
-                    record.body = json[dimension].get<std::string>();
-                } else if (dimension == "timestamp") {
-                    record.timestamp = parse_timestamp(json[dimension].get<std::string>(), config_.datetime_format);
-                } else if (dimension == "severity") {
-                    record.severity = json[dimension].get<std::string>();
-                } else if (dimension == "level") {
-                    record.level = json[dimension].get<std::string>();
-                } else if (dimension == "message") {
-                    record.message = json[dimension].get<std::string>();
-                } else {
-                    // Store all other fields in fields map
-                    record.set_field(dimension, json[dimension].get<std::string>());
-                }
+        for (size_t i = 0; i < config_.dimensions.size(); ++i) {
+            const auto& dimension = config_.dimensions[i];
+            const std::string* value = string_at(dimension);
+            if (!value) {
+                continue;
+            }
+            if (dimension == "body") {
+                record.body = *value;
+            } else if (dimension == "timestamp") {
+                record.timestamp = parse_timestamp(*value, config_.datetime_format);
+            } else if (dimension == "severity") {
+                record.severity = *value;
+            } else if (dimension == "level") {
+                record.level = *value;
+            } else if (dimension == "message") {
+                record.message = *value;
+            } else {
+                // Store all other fields in fields map
+                record.set_field(dimension_ids_[i], *value);
             }
         }
         
         // If no dimensions specified, try to extract common fields
         if (config_.dimensions.empty()) {
-            if (json.contains("message")) {
-                record.message = json["message"].get<std::string>();
-            } else if (json.contains("msg")) {
-                record.message = json["msg"].get<std::string>();
+            if (const auto* message = string_at("message")) {
+                record.message = *message;
+            } else if (const auto* msg = string_at("msg")) {
+                record.message = *msg;
             }
             
-            if (json.contains("level")) {
-                record.level = json["level"].get<std::string>();
-            } else if (json.contains("severity")) {
-                record.level = json["severity"].get<std::string>();
+            if (const auto* level = string_at("level")) {
+                record.level = *level;
+            } else if (const auto* severity = string_at("severity")) {
+                record.level = *severity;
             }
             
-            if (json.contains("timestamp")) {
-                record.timestamp = parse_timestamp(json["timestamp"].get<std::string>(), config_.datetime_format);
-            } else if (json.contains("time")) {
-                record.timestamp = parse_timestamp(json["time"].get<std::string>(), config_.datetime_format);
+            if (const auto* timestamp = string_at("timestamp")) {
+                record.timestamp = parse_timestamp(*timestamp, config_.datetime_format);
+            } else if (const auto* time = string_at("time")) {
+                record.timestamp = parse_timestamp(*time, config_.datetime_format);
             }
             
             // Add all fields to the fields map
             for (auto it = json.begin(); it != json.end(); ++it) {
                 if (it.value().is_string()) {
-                    record.set_field(it.key(), it.value().get<std::string>());
+                    record.set_field(it.key(), it.value().get_ref<const std::string&>());
                 } else if (it.value().is_number()) {
                     record.set_field(it.key(), it.value().dump());
                 } else if (it.value().is_boolean()) {
@@ -133,10 +157,7 @@ LogRecordObject JsonParser::parse_line(const std::string& line) {
                 }
             }
         }
-    } catch (const nlohmann::json::exception& e) {
-        throw std::runtime_error("Failed to parse JSON line: " + std::string(e.what()));
-    }
-    
-    return record;
+        return invalid ? ParseStatus::InvalidField : ParseStatus::Ok;
+    });
 }
 } 
\ No newline at end of file
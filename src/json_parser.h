@@ -11,15 +11,18 @@ namespace logai {
 
 class JsonParser : public LogParser {
 public:
-    explicit JsonParser(const DataLoaderConfig& config);
+    explicit JsonParser(const DataLoaderConfig& config, std::shared_ptr<FieldSchema> schema = nullptr);
     ~JsonParser() noexcept override;
     
     LogEntry parse(const std::string& line) override;
     bool validate(const std::string& line) override;
+    ParseStatus try_parse(const std::string& line, LogEntry& entry) noexcept override;
     LogRecordObject parse_line(const std::string& line) override;
+    ParseStatus try_parse_line(const std::string& line, LogRecordObject& record) noexcept override;
 
 private:
     DataLoaderConfig config_;
+    std::vector<FieldSchema::Id> dimension_ids_;  // Interned once, parallel to config_.dimensions
     std::map<std::string, std::string> parse_json(std::string_view json_str);
     std::optional<std::chrono::system_clock::time_point> parse_timestamp(std::string_view timestamp, const std::string& format);
 };
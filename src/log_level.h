@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace logai {
+
+/**
+ * @brief Normalized log severity
+ *
+ * Syslog severities are folded onto the closest level (NOTICE -> INFO,
+ * ERR/CRIT -> ERROR, ALERT/EMERG -> FATAL).
+ */
+enum class LogLevel : uint8_t {
+    Trace = 0,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Fatal,
+    Unknown
+};
+
+constexpr size_t kLogLevelCount = 7;
+
+inline const char* log_level_name(LogLevel level) {
+    static constexpr std::array<const char*, kLogLevelCount> names = {
+        "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL", "UNKNOWN"};
+    return names[static_cast<size_t>(level)];
+}
+
+/**
+ * @brief Parse a single level word, case-insensitively
+ *
+ * @param word Level word such as "info", "WARNING" or "err"
+ * @return LogLevel::Unknown if the word is not a level
+ */
+inline LogLevel parse_log_level(std::string_view word) {
+    struct Alias {
+        std::string_view name;
+        LogLevel level;
+    };
+    static constexpr Alias aliases[] = {
+        {"TRACE", LogLevel::Trace},   {"DEBUG", LogLevel::Debug},
+        {"INFO", LogLevel::Info},     {"NOTICE", LogLevel::Info},
+        {"WARN", LogLevel::Warn},     {"WARNING", LogLevel::Warn},
+        {"ERROR", LogLevel::Error},   {"ERR", LogLevel::Error},
+        {"CRIT", LogLevel::Error},    {"CRITICAL", LogLevel::Error},
+        {"FATAL", LogLevel::Fatal},   {"ALERT", LogLevel::Fatal},
+        {"EMERG", LogLevel::Fatal},   {"PANIC", LogLevel::Fatal}};
+
+    if (word.empty() || word.size() > 8) {
+        return LogLevel::Unknown;
+    }
+    for (const auto& alias : aliases) {
+        if (alias.name.size() != word.size()) continue;
+        bool equal = true;
+        for (size_t i = 0; i < word.size() && equal; ++i) {
+            char c = word[i];
+            if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+            equal = c == alias.name[i];
+        }
+        if (equal) return alias.level;
+    }
+    return LogLevel::Unknown;
+}
+
+/**
+ * @brief Find the level word among the first few words of a raw log line
+ *
+ * Words may be wrapped in brackets or followed by a colon, e.g. "[INFO]" or "ERROR:".
+ *
+ * @param line Raw log line
+ * @param max_words Number of leading words to inspect
+ */
+inline LogLevel detect_log_level(std::string_view line, size_t max_words = 6) {
+    size_t pos = 0;
+    for (size_t word_index = 0; word_index < max_words && pos < line.size(); ++word_index) {
+        while (pos < line.size() && line[pos] == ' ') ++pos;
+        size_t end = line.find(' ', pos);
+        if (end == std::string_view::npos) end = line.size();
+
+        std::string_view word = line.substr(pos, end - pos);
+        while (!word.empty() && (word.front() == '[' || word.front() == '<' || word.front() == '(')) {
+            word.remove_prefix(1);
+        }
+        while (!word.empty() && (word.back() == ']' || word.back() == '>' ||
+                                 word.back() == ')' || word.back() == ':' || word.back() == ',')) {
+            word.remove_suffix(1);
+        }
+
+        LogLevel level = parse_log_level(word);
+        if (level != LogLevel::Unknown) {
+            return level;
+        }
+        pos = end;
+    }
+    return LogLevel::Unknown;
+}
+
+} // namespace logai
@@ -9,7 +9,11 @@
 #include <sstream>
 #include <iomanip>
 #include <folly/container/F14Map.h>
+#include <new>
+#include <stdexcept>
 #include "log_record.h"
+#include "parse_status.h"
+#include "timestamp_utils.h"
 
 namespace logai {
 
@@ -18,43 +22,143 @@ namespace logai {
  */
 class LogParser {
 public:
+    /**
+     * @brief String-typed view of a LogRecordObject
+     *
+     * timestamp is ISO 8601 ("YYYY-MM-DDTHH:MM:SS.fffZ" when converted from
+     * a record). Conversions from and to an rvalue move every string and
+     * the field map, so they allocate at most the timestamp text.
+     */
     struct LogEntry {
         std::string timestamp;
         std::string level;
         std::string message;
-        folly::F14FastMap<std::string, std::string> fields;
+        LogRecordObject::Fields fields;
 
-        LogRecordObject to_record_object() const {
-            LogRecordObject record;
-            record.body = message;
-            for (const auto& [key, value] : fields) {
-                record.fields[folly::fbstring(key)] = folly::fbstring(value);
+        /**
+         * @brief View of record: level falls back to severity, message to body
+         */
+        static LogEntry from_record(LogRecordObject&& record) {
+            LogEntry entry;
+            if (record.timestamp) {
+                entry.timestamp = format_epoch_millis(millis_from_time_point(*record.timestamp));
             }
-            if (!timestamp.empty()) {
-                try {
-                    // Parse ISO 8601 timestamp
-                    std::tm tm = {};
-                    std::stringstream ss(timestamp);
-                    ss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%S");
-                    if (!ss.fail()) {
-                        record.timestamp = std::chrono::system_clock::from_time_t(std::mktime(&tm));
-                    }
-                } catch (const std::exception&) {
-                    // If parsing fails, just ignore the timestamp
-                }
+            entry.level = !record.level.empty() ? std::move(record.level) : std::move(record.severity).value_or("");
+            entry.message = !record.message.empty() ? std::move(record.message) : std::move(record.body);
+            entry.fields = std::move(record.fields);
+            return entry;
+        }
+
+        LogRecordObject to_record_object() const& {
+            return LogEntry(*this).to_record_object();
+        }
+
+        LogRecordObject to_record_object() && {
+            LogRecordObject record;
+            if (auto millis = parse_epoch_millis(timestamp)) {
+                record.timestamp = time_point_from_millis(*millis);
             }
+            record.level = std::move(level);
+            record.body = std::move(message);
+            record.fields = std::move(fields);
             return record;
         }
     };
 
     virtual ~LogParser() = default;
+
+    /**
+     * @brief Dictionary the field keys of this parser's records are interned in
+     */
+    const std::shared_ptr<FieldSchema>& field_schema() const { return field_schema_; }
+
     virtual LogEntry parse(const std::string& line) = 0;
     virtual bool validate(const std::string& line) = 0;
 
     virtual LogRecordObject parse_line(const std::string& line) {
-        LogEntry entry = parse(line);
-        return entry.to_record_object();
+        return parse(line).to_record_object();
+    }
+
+    /**
+     * @brief validate() and parse() in one pass, without throwing
+     *
+     * A line validate() rejects gives ParseStatus::Malformed. entry is only
+     * meaningful when ParseStatus::Ok is returned. The default runs both
+     * calls; parsers whose validate() does the work of parsing override it
+     * so that each line is scanned once.
+     *
+     * Limitation: the default only avoids exceptions for lines validate()
+     * rejects. A parser whose parse() throws on a line validate() accepted
+     * still pays for that exception here, caught by guarded().
+     */
+    virtual ParseStatus try_parse(const std::string& line, LogEntry& entry) noexcept {
+        return guarded([&] {
+            if (!validate(line)) {
+                return ParseStatus::Malformed;
+            }
+            entry = parse(line);
+            return ParseStatus::Ok;
+        });
     }
+
+    /**
+     * @brief Parse a line into record without throwing
+     *
+     * record is only meaningful when ParseStatus::Ok is returned. The
+     * default adapts parse_line() for parsers that only have the throwing
+     * API. Parsers the loader runs override it so that a malformed line
+     * costs a return value instead of an exception, and implement
+     * parse_line() on top of it.
+     *
+     * Limitation: with the default, a parser that signals a malformed line
+     * by throwing still throws once per such line; the exception is only
+     * turned into a status. CsvParser, JsonParser, RegexParser and
+     * DrainParser override it. SyslogParser and LineParser keep the default
+     * because their parse() accepts every line. LogfmtParser, JsonlParser,
+     * Log4jParser and CefParser keep it too, so malformed lines cost them
+     * an exception each.
+     */
+    virtual ParseStatus try_parse_line(const std::string& line, LogRecordObject& record) noexcept {
+        return guarded([&] {
+            record = parse_line(line);
+            return ParseStatus::Ok;
+        });
+    }
+
+protected:
+    /**
+     * @param schema Key dictionary shared with the other parsers of a load; a null schema selects FieldSchema::shared_default()
+     */
+    explicit LogParser(std::shared_ptr<FieldSchema> schema = nullptr)
+        : field_schema_(schema ? std::move(schema) : FieldSchema::shared_default()) {}
+
+    /**
+     * @brief Run a parse, turning an escaping exception into a status, for noexcept overrides
+     */
+    template <typename Body>
+    static ParseStatus guarded(Body&& body) noexcept {
+        try {
+            return body();
+        } catch (const std::bad_alloc&) {
+            return ParseStatus::OutOfMemory;
+        } catch (...) {
+            return ParseStatus::Error;
+        }
+    }
+
+    /**
+     * @brief The throwing API on top of the non-throwing one: throws unless status is Ok
+     */
+    static void throw_if_failed(ParseStatus status, const char* format) {
+        if (status == ParseStatus::OutOfMemory) {
+            throw std::bad_alloc();
+        }
+        if (status != ParseStatus::Ok) {
+            throw std::runtime_error(std::string("Failed to parse ") + format + " line: " + to_string(status));
+        }
+    }
+
+    std::shared_ptr<FieldSchema> field_schema_;
 };
 
 /**
@@ -87,7 +191,10 @@ class SyslogParser : public LogParser {
 public:
     LogEntry parse(const std::string& line) override;
     bool validate(const std::string& line) override;
+    ParseStatus try_parse(const std::string& line, LogEntry& entry) noexcept override;
 private:
+    // Fills entry; returns false if the line is not syslog, stopping early if strict
+    bool parse_into(const std::string& line, LogEntry& entry, bool strict);
     std::chrono::system_clock::time_point parseTimestamp(const std::string& ts);
 };
 
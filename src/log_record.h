@@ -1,35 +1,66 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <chrono>
 #include <optional>
-#include <folly/container/F14Map.h>
 #include <folly/FBString.h>
+#include "record_fields.h"
 
 namespace logai {
 
+/**
+ * @brief The record every parser produces
+ *
+ * LogParser::LogEntry is a view onto the same data for the older
+ * string-typed API; both use Fields, so converting between them moves the
+ * field map instead of copying it entry by entry.
+ */
 class LogRecordObject {
 public:
+    using Fields = RecordFields;
+
     std::string body;
     std::string template_str;
-    folly::F14FastMap<folly::fbstring, folly::fbstring> fields;
+    Fields fields;
     std::optional<std::string> severity;
     std::optional<std::chrono::system_clock::time_point> timestamp;
     std::string level;
     std::string message;
 
-    bool has_field(const std::string& key) const {
-        return fields.find(folly::fbstring(key)) != fields.end();
+    bool has_field(std::string_view key) const {
+        return fields.contains(key);
+    }
+
+    std::string get_field(std::string_view key) const {
+        const auto* value = fields.find(key);
+        return value ? value->toStdString() : "";
+    }
+
+    void set_field(std::string_view key, std::string_view value) {
+        fields.set(key, value);
+    }
+
+    void set_field(FieldSchema::Id id, std::string_view value) {
+        fields.set(id, value);
     }
 
-    std::string get_field(const std::string& key) const {
-        auto it = fields.find(folly::fbstring(key));
-        return it != fields.end() ? it->second.toStdString() : "";
+    /**
+     * @brief Approximate bytes this record occupies, inline and on the heap, for memory budgeting
+     */
+    size_t memory_usage() const {
+        size_t bytes = sizeof(*this) + heap_bytes(body) + heap_bytes(template_str) + heap_bytes(level) +
+                       heap_bytes(message) + (severity ? heap_bytes(*severity) : 0) + fields.heap_bytes();
+        return bytes;
     }
 
-    void set_field(const std::string& key, const std::string& value) {
-        fields[folly::fbstring(key)] = folly::fbstring(value);
+private:
+    // Heap bytes of a string beyond its inline (small-string) buffer
+    template <typename String>
+    static size_t heap_bytes(const String& s) {
+        static const size_t inline_capacity = String().capacity();
+        return s.capacity() > inline_capacity ? s.capacity() + 1 : 0;
     }
 };
 
@@ -0,0 +1,76 @@
+#include "memory_budget.h"
+
+namespace logai {
+
+MemoryBudget::MemoryBudget(size_t limit_bytes) : limit_(limit_bytes) {}
+
+void MemoryBudget::set_limit(size_t limit_bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        limit_.store(limit_bytes, std::memory_order_relaxed);
+    }
+    cv_.notify_all();
+}
+
+bool MemoryBudget::acquire(size_t bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto fits = [&] {
+        const size_t limit = limit_.load(std::memory_order_relaxed);
+        const size_t used = in_use_.load(std::memory_order_relaxed);
+        return closed_ || limit == 0 || used == 0 || used + bytes <= limit;
+    };
+    if (!fits()) {
+        waits_.fetch_add(1, std::memory_order_relaxed);
+        cv_.wait(lock, fits);
+    }
+    if (closed_) {
+        return false;
+    }
+    add(bytes);
+    return true;
+}
+
+void MemoryBudget::charge(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    add(bytes);
+}
+
+void MemoryBudget::release(size_t bytes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const size_t used = in_use_.load(std::memory_order_relaxed);
+        in_use_.store(used > bytes ? used - bytes : 0, std::memory_order_relaxed);
+    }
+    cv_.notify_all();
+}
+
+void MemoryBudget::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    cv_.notify_all();
+}
+
+void MemoryBudget::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = false;
+    in_use_.store(0, std::memory_order_relaxed);
+    peak_.store(0, std::memory_order_relaxed);
+    waits_.store(0, std::memory_order_relaxed);
+}
+
+double MemoryBudget::utilization() const {
+    const size_t limit = limit_.load(std::memory_order_relaxed);
+    return limit == 0 ? 0.0 : static_cast<double>(in_use()) / static_cast<double>(limit);
+}
+
+void MemoryBudget::add(size_t bytes) {
+    const size_t used = in_use_.load(std::memory_order_relaxed) + bytes;
+    in_use_.store(used, std::memory_order_relaxed);
+    if (used > peak_.load(std::memory_order_relaxed)) {
+        peak_.store(used, std::memory_order_relaxed);
+    }
+}
+
+} // namespace logai
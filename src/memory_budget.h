@@ -0,0 +1,81 @@
+/**
+ * @file memory_budget.h
+ * @brief Byte budget shared by the stages of a loading pipeline
+ */
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace logai {
+
+/**
+ * @brief Counts the bytes in flight between pipeline stages and blocks producers over the limit
+ *
+ * Only the stage that creates work (the reader) waits in acquire(); later
+ * stages account for what they turn the work into with charge(), which
+ * never blocks, so a full budget cannot stall the stages that drain it.
+ * The limit is therefore exceeded by at most what the workers hold while
+ * parsing. A request larger than the whole limit is admitted once nothing
+ * else is in flight, so it cannot wait forever.
+ */
+class MemoryBudget {
+public:
+    explicit MemoryBudget(size_t limit_bytes = 0);
+
+    /**
+     * @brief Change the limit; 0 disables blocking but bytes are still counted
+     */
+    void set_limit(size_t limit_bytes);
+
+    /**
+     * @brief Wait until bytes fit in the budget, then take them
+     * @return false if the budget was closed while waiting (the bytes are not taken)
+     */
+    bool acquire(size_t bytes);
+
+    /**
+     * @brief Take bytes without waiting
+     */
+    void charge(size_t bytes);
+
+    /**
+     * @brief Give bytes back and wake waiting producers
+     */
+    void release(size_t bytes);
+
+    /**
+     * @brief Wake all waiters and make further acquire() calls fail, e.g. on shutdown
+     */
+    void close();
+
+    /**
+     * @brief Zero the counters and reopen a closed budget for the next run
+     */
+    void reset();
+
+    size_t limit() const { return limit_.load(std::memory_order_relaxed); }
+    size_t in_use() const { return in_use_.load(std::memory_order_relaxed); }
+    size_t peak() const { return peak_.load(std::memory_order_relaxed); }
+    uint64_t waits() const { return waits_.load(std::memory_order_relaxed); }  ///< acquire() calls that blocked
+
+    /**
+     * @brief Fraction of the limit in use, 0 without a limit
+     */
+    double utilization() const;
+
+private:
+    void add(size_t bytes);
+
+    std::atomic<size_t> limit_;
+    std::atomic<size_t> in_use_{0};
+    std::atomic<size_t> peak_{0};
+    std::atomic<uint64_t> waits_{0};
+    bool closed_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+};
+
+} // namespace logai
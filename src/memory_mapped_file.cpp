@@ -1,5 +1,6 @@
 #include "memory_mapped_file.h"
 #include "simd_scanner.h"
+#include <algorithm>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -22,7 +23,7 @@ MemoryMappedFile::MemoryMappedFile()
 #endif
 }
 
-MemoryMappedFile::MemoryMappedFile(const std::string& path)
+MemoryMappedFile::MemoryMappedFile(const std::string& path, const MappingOptions& options)
     : mapped_data_(nullptr), file_size_(0), is_open_(false) {
 #ifdef _WIN32
     file_handle_ = INVALID_HANDLE_VALUE;
@@ -30,15 +31,18 @@ MemoryMappedFile::MemoryMappedFile(const std::string& path)
 #else
     file_descriptor_ = -1;
 #endif
-    open(path);
+    open(path, options);
 }
 
 MemoryMappedFile::~MemoryMappedFile() {
     close();
 }
 
-bool MemoryMappedFile::open(const std::string& path) {
+bool MemoryMappedFile::open(const std::string& path, const MappingOptions& options) {
     close();
+    options_ = options;
+    released_ = 0;
+    prefetched_ = 0;
 
 #ifdef _WIN32
     // Windows implementation
@@ -106,11 +110,15 @@ bool MemoryMappedFile::open(const std::string& path) {
     }
     file_size_ = static_cast<size_t>(sb.st_size);
 
+    int flags = MAP_PRIVATE;
+    if (file_size_ > 0 && file_size_ <= options_.populate_max_bytes) {
+        flags |= MAP_POPULATE;  // Small file: fault everything in with one call
+    }
     mapped_data_ = mmap(
         nullptr,
         file_size_,
         PROT_READ,
-        MAP_PRIVATE,
+        flags,
         file_descriptor_,
         0
     );
@@ -121,12 +129,55 @@ bool MemoryMappedFile::open(const std::string& path) {
         mapped_data_ = nullptr;
         return false;
     }
+
+    if (options_.sequential) {
+        advise(0, file_size_, MADV_SEQUENTIAL);
+    }
+#ifdef MADV_HUGEPAGE
+    if (options_.huge_pages) {
+        advise(0, file_size_, MADV_HUGEPAGE);
+    }
+#endif
 #endif
 
     is_open_ = true;
+    advance(0);
     return true;
 }
 
+void MemoryMappedFile::advise([[maybe_unused]] size_t begin, [[maybe_unused]] size_t end,
+                              [[maybe_unused]] int advice) const {
+#ifndef _WIN32
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    // madvise() wants a page-aligned start; round it down (end is clamped to the mapping)
+    begin -= begin % page_size;
+    end = std::min(end, file_size_);
+    if (mapped_data_ && begin < end) {
+        madvise(static_cast<char*>(mapped_data_) + begin, end - begin, advice);
+    }
+#endif
+}
+
+void MemoryMappedFile::advance(size_t position) {
+#ifndef _WIN32
+    constexpr size_t kReleaseStep = 8 * 1024 * 1024;  // Batch releases to keep madvise() calls rare
+    static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+
+    if (options_.release_consumed && position >= released_ + kReleaseStep) {
+        // Only whole pages before position; the page holding position is still in use
+        size_t end = position - position % page_size;
+        advise(released_, end, MADV_DONTNEED);
+        released_ = end;
+    }
+    if (options_.prefetch_window > 0 && prefetched_ < file_size_ &&
+        position + options_.prefetch_window / 2 >= prefetched_) {
+        size_t end = std::min(file_size_, position + options_.prefetch_window);
+        advise(std::max(prefetched_, position), end, MADV_WILLNEED);
+        prefetched_ = end;
+    }
+#endif
+}
+
 void MemoryMappedFile::close() {
     if (!is_open_) return;
 
@@ -10,23 +10,50 @@
 
 namespace logai {
 
+/**
+ * @brief Access hints for a mapping; all of them are advisory and ignored where unsupported
+ */
+struct MappingOptions {
+    bool sequential = false;        ///< MADV_SEQUENTIAL: aggressive readahead, pages reclaimed early
+    size_t prefetch_window = 0;     ///< Bytes kept MADV_WILLNEED ahead of the scan position, 0 = off
+    bool release_consumed = false;  ///< MADV_DONTNEED the pages behind the scan position
+    size_t populate_max_bytes = 0;  ///< MAP_POPULATE files up to this size
+    bool huge_pages = false;        ///< MADV_HUGEPAGE, where the kernel supports it for file mappings
+};
+
 class MemoryMappedFile {
 public:
     MemoryMappedFile();
-    explicit MemoryMappedFile(const std::string& path);
+    explicit MemoryMappedFile(const std::string& path, const MappingOptions& options = MappingOptions());
     ~MemoryMappedFile();
     
-    bool open(const std::string& path);
+    bool open(const std::string& path, const MappingOptions& options = MappingOptions());
     void close();
     const char* data() const;
     size_t size() const;
     bool isOpen() const;
     std::unique_ptr<SimdLogScanner> getScanner() const;
 
+    /**
+     * @brief Report how far a front-to-back scan has got
+     *
+     * Everything before position is no longer needed: with release_consumed
+     * its pages leave the process (the page cache keeps them), so resident
+     * memory stays bounded by the prefetch window on arbitrarily large files.
+     * With a prefetch_window the next window is requested once half of the
+     * current one is consumed. Cheap enough to call per line; not thread-safe.
+     */
+    void advance(size_t position);
+
 private:
+    void advise(size_t begin, size_t end, int advice) const;
+
     void* mapped_data_;
     size_t file_size_;
     bool is_open_;
+    MappingOptions options_;
+    size_t released_ = 0;    // Pages before this offset were released
+    size_t prefetched_ = 0;  // Pages before this offset were requested
 
 #ifdef _WIN32
     HANDLE file_handle_;
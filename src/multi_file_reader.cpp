@@ -1,142 +1,178 @@
 #include "multi_file_reader.h"
 #include <algorithm>
+#include <future>
+#include <limits>
 #include <stdexcept>
+#include <boost/algorithm/string.hpp>
+#include "timestamp_utils.h"
 
 namespace logai {
 
-MultiFileReader::MultiFileReader(const std::vector<FileEntry>& files) : files_(files) {
+struct MultiFileReader::Cursor {
+    std::unique_ptr<FileDataLoader> loader;  // nullptr for followed files
+    std::vector<TimedEntry> batch;
+    size_t pos = 0;
+    std::future<std::vector<TimedEntry>> next;  // Batch being parsed ahead
+    bool eof = false;
+    bool header_skipped = false;
+    int64_t carry_ms = std::numeric_limits<int64_t>::min();  // Given to entries without a timestamp
+
+    bool has_entry() const { return pos < batch.size(); }
+};
+
+MultiFileReader::MultiFileReader(const std::vector<FileEntry>& files, size_t batch_size)
+    : batch_size_(std::max<size_t>(batch_size, 1)) {
     for (const auto& file : files) {
+        addFile(file);
+    }
+}
+
+MultiFileReader::~MultiFileReader() = default;
+
+void MultiFileReader::openFile(const FileEntry& file) {
+    auto cursor = std::make_unique<Cursor>();
+    if (!file.follow) {
         FileDataLoaderConfig config;
         config.file_path = file.filename;
         config.format = file.format;
-        // Maps follow and compressed fields to appropriate settings
-        // These don't exist directly in FileDataLoaderConfig, map to appropriate fields
-        if (file.follow) {
-            // Handle follow mode settings
-        }
         if (file.compressed) {
             config.decompress = file.compressed;
         }
-        
-        auto loader = std::make_unique<FileDataLoader>(file.filename, config);
-        loaders_.push_back(std::move(loader));
+
+        cursor->loader = std::make_unique<FileDataLoader>(file.filename, config);
+        cursor->next = std::async(std::launch::async, [this, c = cursor.get()] { return readBatch(*c); });
+        refill(*cursor);
+        cursors_.push_back(std::move(cursor));
+        return;
     }
-    
-    fillQueue();
+
+    if (file.compressed) {
+        throw std::runtime_error("Cannot follow a compressed file: " + file.filename);
+    }
+    if (!follower_) {
+        follower_ = std::make_unique<FileFollower>();
+    }
+
+    // Followed lines go through the same parsers as loadData(), on the follower thread
+    std::shared_ptr<LogParser> parser = LogParserFactory::create(file.format);
+    follower_->add(file.filename, [this, parser, filename = file.filename](std::string_view line) {
+        std::string text(line);
+        boost::trim(text);
+        LogParser::LogEntry entry;
+        if (!text.empty() && parser->try_parse(text, entry) == ParseStatus::Ok) {
+            followed_entries_.push(FollowedEntry{filename, std::move(entry)});
+        }
+    });
+    cursors_.push_back(std::move(cursor));
 }
 
 void MultiFileReader::addFile(const FileEntry& file) {
     // Check if file already exists
-    auto it = std::find_if(files_.begin(), files_.end(),
-        [&](const FileEntry& entry) { return entry.filename == file.filename; });
-    
-    if (it != files_.end()) {
+    if (file_index_.count(file.filename)) {
         throw std::runtime_error("File already exists: " + file.filename);
     }
-    
+
+    openFile(file);
+    file_index_[file.filename] = files_.size();
     files_.push_back(file);
-    
-    FileDataLoaderConfig config;
-    config.file_path = file.filename;
-    config.format = file.format;
-    // Maps follow and compressed fields to appropriate settings
-    if (file.follow) {
-        // Handle follow mode settings
-    }
-    if (file.compressed) {
-        config.decompress = file.compressed;
-    }
-    
-    auto loader = std::make_unique<FileDataLoader>(file.filename, config);
-    loaders_.push_back(std::move(loader));
-    
-    fillQueue();
+    rebuildTree();
 }
 
 void MultiFileReader::removeFile(const std::string& filename) {
-    auto file_it = std::find_if(files_.begin(), files_.end(),
-        [&](const FileEntry& entry) { return entry.filename == filename; });
-    
-    if (file_it == files_.end()) {
+    auto index_it = file_index_.find(filename);
+    if (index_it == file_index_.end()) {
         throw std::runtime_error("File not found: " + filename);
     }
-    
-    size_t index = file_it - files_.begin();
-    
-    files_.erase(file_it);
-    loaders_.erase(loaders_.begin() + index);
-    
-    // Remove entries from this file from the queue
-    std::vector<QueueEntry> remaining_entries;
-    while (!entry_queue_.empty()) {
-        auto entry = entry_queue_.top();
-        entry_queue_.pop();
-        
-        if (entry.file_index != index) {
-            // Adjust file indices for entries from files after the removed one
-            if (entry.file_index > index) {
-                entry.file_index--;
-            }
-            remaining_entries.push_back(entry);
+
+    size_t index = index_it->second;
+    if (files_[index].follow) {
+        follower_->remove(filename);
+    }
+    if (cursors_[index]->loader) {
+        retired_schemas_.push_back(cursors_[index]->loader->field_schema());
+    }
+    files_.erase(files_.begin() + index);
+    cursors_.erase(cursors_.begin() + index);
+
+    file_index_.clear();
+    for (size_t i = 0; i < files_.size(); ++i) {
+        file_index_[files_[i].filename] = i;
+    }
+    rebuildTree();
+}
+
+std::vector<LogParser::LogEntry> MultiFileReader::nextBatch(size_t max_entries) {
+    std::vector<LogParser::LogEntry> result;
+    drainFollowedEntries();
+    if (tree_.empty()) {
+        return result;
+    }
+    result.reserve(std::min(max_entries, batch_size_));
+
+    while (result.size() < max_entries) {
+        const size_t winner = tree_[0];
+        Cursor& cursor = *cursors_[winner];
+        if (!cursor.has_entry()) {
+            break;  // The winner only has nothing left if every cursor is drained
+        }
+        result.push_back(std::move(cursor.batch[cursor.pos].entry));
+        bytes_read_ += result.back().message.size();
+        if (++cursor.pos == cursor.batch.size()) {
+            refill(cursor);
         }
+        replay(winner);
+    }
+
+    entries_read_ += result.size();
+    return result;
+}
+
+std::vector<LogParser::LogEntry> MultiFileReader::waitBatch(size_t max_entries, std::chrono::milliseconds timeout) {
+    auto result = nextBatch(max_entries);
+    if (!result.empty() || !follower_) {
+        return result;
+    }
+
+    FollowedEntry followed;
+    if (!followed_entries_.wait_and_pop_for(followed, timeout)) {
+        return result;
     }
-    
-    for (const auto& entry : remaining_entries) {
-        entry_queue_.push(entry);
+    if (queueFollowedEntry(followed)) {
+        rebuildTree();
     }
+    return nextBatch(max_entries);
 }
 
 std::optional<LogParser::LogEntry> MultiFileReader::nextEntry() {
-    if (entry_queue_.empty()) {
-        fillQueue();
-        if (entry_queue_.empty()) {
-            return std::nullopt;
-        }
+    auto batch = nextBatch(1);
+    if (batch.empty()) {
+        return std::nullopt;
     }
-    
-    auto entry = entry_queue_.top();
-    entry_queue_.pop();
-    
-    entries_read_++;
-    bytes_read_ += entry.entry.message.size();
-    
-    // Try to read next entry from the same file
-    // Use loadData or streamData instead of nextEntry which doesn't exist in FileDataLoader
-    LogParser::LogEntry next_log_entry;
-    bool has_next = false;
-    
-    // Use a temporary vector to get a single entry
-    std::vector<LogParser::LogEntry> entries;
-    loaders_[entry.file_index]->loadData(entries);
-    
-    if (!entries.empty()) {
-        has_next = true;
-        next_log_entry = entries[0];
-    }
-    
-    if (has_next) {
-        // Create a QueueEntry and push it
-        QueueEntry next_queue_entry;
-        next_queue_entry.entry = next_log_entry;
-        next_queue_entry.file_index = entry.file_index;
-        entry_queue_.push(next_queue_entry);
-    }
-    
-    return entry.entry;
+    return std::move(batch.front());
+}
+
+std::optional<LogParser::LogEntry> MultiFileReader::waitEntry(std::chrono::milliseconds timeout) {
+    auto batch = waitBatch(1, timeout);
+    if (batch.empty()) {
+        return std::nullopt;
+    }
+    return std::move(batch.front());
 }
 
 bool MultiFileReader::hasMore() const {
-    if (!entry_queue_.empty()) {
+    if (!followed_entries_.empty()) {
         return true;
     }
-    
-    for (const auto& loader : loaders_) {
-        // Use get_progress() to check if there's more data
-        if (loader->get_progress() < 1.0) {
+
+    for (const auto& cursor : cursors_) {
+        if (!cursor->loader) {
+            return true;  // Followed files never end
+        }
+        if (cursor->has_entry() || !cursor->eof) {
             return true;
         }
     }
-    
+
     return false;
 }
 
@@ -152,23 +188,106 @@ size_t MultiFileReader::getBytesRead() const {
     return bytes_read_;
 }
 
-void MultiFileReader::fillQueue() {
-    for (size_t i = 0; i < loaders_.size(); ++i) {
-        // Check if there are potentially more entries to read
-        if (entry_queue_.empty() || loaders_[i]->get_progress() < 1.0) {
-            // Use loadData to get entries instead of nextEntry
-            std::vector<LogParser::LogEntry> entries;
-            loaders_[i]->loadData(entries);
-            
-            if (!entries.empty()) {
-                // Create a QueueEntry for the first entry
-                QueueEntry queue_entry;
-                queue_entry.entry = entries[0];
-                queue_entry.file_index = i;
-                entry_queue_.push(queue_entry);
-            }
+std::vector<MultiFileReader::TimedEntry> MultiFileReader::readBatch(Cursor& cursor) const {
+    std::vector<TimedEntry> batch;
+    batch.reserve(batch_size_);
+
+    // streamData() continues where the previous call stopped
+    cursor.loader->streamData([&](const LogParser::LogEntry& entry) {
+        cursor.carry_ms = parse_epoch_millis(entry.timestamp).value_or(cursor.carry_ms);
+        batch.push_back(TimedEntry{cursor.carry_ms, entry});
+        return batch.size() < batch_size_;
+    });
+    if (!cursor.header_skipped) {
+        cursor.loader->setHasHeader(false);  // Only the first call starts at the header
+        cursor.header_skipped = true;
+    }
+    return batch;
+}
+
+void MultiFileReader::refill(Cursor& cursor) {
+    cursor.batch.clear();
+    cursor.pos = 0;
+    if (!cursor.loader || !cursor.next.valid()) {
+        return;  // Followed files are refilled by drainFollowedEntries()
+    }
+
+    cursor.batch = cursor.next.get();
+    if (cursor.batch.empty()) {
+        cursor.eof = true;
+        return;
+    }
+    // Parse the next batch while this one is merged
+    cursor.next = std::async(std::launch::async, [this, c = &cursor] { return readBatch(*c); });
+}
+
+bool MultiFileReader::beats(size_t a, size_t b) const {
+    // Index k (one past the last cursor) is the sentinel used while building, it beats every cursor
+    const size_t k = cursors_.size();
+    if (a == k || b == k) {
+        return a == k;
+    }
+    const Cursor& x = *cursors_[a];
+    const Cursor& y = *cursors_[b];
+    if (x.has_entry() != y.has_entry()) {
+        return x.has_entry();
+    }
+    if (x.has_entry()) {
+        int64_t x_ms = x.batch[x.pos].timestamp_ms;
+        int64_t y_ms = y.batch[y.pos].timestamp_ms;
+        if (x_ms != y_ms) {
+            return x_ms < y_ms;
+        }
+    }
+    return a < b;
+}
+
+void MultiFileReader::replay(size_t leaf) {
+    // Leaf i sits below inner node (i + k) / 2; the loser of each match stays, the winner moves up
+    size_t winner = leaf;
+    for (size_t node = (leaf + cursors_.size()) / 2; node > 0; node /= 2) {
+        if (beats(tree_[node], winner)) {
+            std::swap(tree_[node], winner);
         }
     }
+    tree_[0] = winner;
+}
+
+void MultiFileReader::rebuildTree() {
+    const size_t k = cursors_.size();
+    tree_.assign(k, k);
+    for (size_t i = k; i-- > 0;) {
+        replay(i);
+    }
+}
+
+void MultiFileReader::drainFollowedEntries() {
+    FollowedEntry followed;
+    bool rejoined = false;
+    while (followed_entries_.try_pop(followed)) {
+        rejoined |= queueFollowedEntry(followed);
+    }
+    if (rejoined) {
+        rebuildTree();
+    }
+}
+
+bool MultiFileReader::queueFollowedEntry(FollowedEntry& followed) {
+    auto index_it = file_index_.find(followed.filename);
+    if (index_it == file_index_.end()) {
+        return false;  // Removed since the line was parsed
+    }
+    Cursor& cursor = *cursors_[index_it->second];
+    bool was_empty = !cursor.has_entry();
+    if (was_empty) {
+        cursor.batch.clear();
+        cursor.pos = 0;
+    }
+    cursor.carry_ms = parse_epoch_millis(followed.entry.timestamp).value_or(cursor.carry_ms);
+    cursor.batch.push_back(TimedEntry{cursor.carry_ms, std::move(followed.entry)});
+    // A drained cursor rejoins the merge. Replaying its leaf is not enough: the matches it lost
+    // while drained are stored along other paths, so the tree is rebuilt
+    return was_empty;
 }
 
-} // namespace logai 
\ No newline at end of file
+} // namespace logai
@@ -3,11 +3,27 @@
 #include <string>
 #include <vector>
 #include <memory>
-#include <queue>
+#include <chrono>
+#include <cstdint>
+#include <folly/container/F14Map.h>
 #include "file_data_loader.h"
+#include "file_follower.h"
+#include "thread_safe_queue.h"
 
 namespace logai {
 
+/**
+ * @brief Merges the entries of several log files into one stream ordered by timestamp
+ *
+ * Each file has a cursor that parses the next batch of entries in the
+ * background while the current one is merged. Cursors are merged with a
+ * loser tree keyed on epoch-millisecond timestamps, so an entry costs
+ * O(log k) for k files. Entries without a parseable timestamp keep the
+ * timestamp of the entry before them in the same file; ties go to the file
+ * added first. Followed files join the merge with the lines that have
+ * arrived so far. Entries refer to the field schema of the file they came
+ * from, which the reader keeps, so they must not outlive the reader.
+ */
 class MultiFileReader {
 public:
     struct FileEntry {
@@ -16,49 +32,89 @@ public:
         bool follow;
         bool compressed;
     };
-    
-    // Initialize with a list of files to read
-    explicit MultiFileReader(const std::vector<FileEntry>& files);
-    
+
+    // Initialize with a list of files to read; batch_size entries per file are parsed ahead
+    explicit MultiFileReader(const std::vector<FileEntry>& files, size_t batch_size = 1024);
+    ~MultiFileReader();
+
     // Add a new file to read
     void addFile(const FileEntry& file);
-    
+
     // Remove a file by name
     void removeFile(const std::string& filename);
-    
+
+    // Get up to max_entries next log entries from all files, ordered by timestamp
+    std::vector<LogParser::LogEntry> nextBatch(size_t max_entries = 4096);
+
+    // Like nextBatch(), but if nothing is left waits up to timeout for new lines of followed files
+    std::vector<LogParser::LogEntry> waitBatch(size_t max_entries, std::chrono::milliseconds timeout);
+
     // Get next log entry from any file, ordered by timestamp
     std::optional<LogParser::LogEntry> nextEntry();
-    
-    // Check if there are more entries to read
+
+    // Like nextEntry(), but waits up to timeout for new lines of followed files
+    std::optional<LogParser::LogEntry> waitEntry(std::chrono::milliseconds timeout);
+
+    // Check if there are more entries to read (always true while a file is followed)
     bool hasMore() const;
-    
+
     // Get list of current files
     std::vector<FileEntry> getFiles() const;
-    
+
     // Get number of entries read so far
     size_t getEntriesRead() const;
-    
+
     // Get number of bytes read so far
     size_t getBytesRead() const;
-    
+
 private:
-    struct QueueEntry {
+    struct TimedEntry {
+        int64_t timestamp_ms;
         LogParser::LogEntry entry;
-        size_t file_index;
-        
-        bool operator>(const QueueEntry& other) const {
-            return entry.timestamp > other.entry.timestamp;
-        }
     };
-    
+
+    struct FollowedEntry {
+        std::string filename;
+        LogParser::LogEntry entry;
+    };
+
+    // Parsed entries of one file, read a batch ahead of the merge
+    struct Cursor;
+
     std::vector<FileEntry> files_;
-    std::vector<std::unique_ptr<FileDataLoader>> loaders_;
-    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<>> entry_queue_;
+    std::vector<std::unique_ptr<Cursor>> cursors_;  // Parallel to files_
+    std::vector<std::shared_ptr<FieldSchema>> retired_schemas_;  // Of removed files, for entries already returned
+    folly::F14FastMap<std::string, size_t> file_index_;  // filename -> index into files_
+    // Loser tree over cursors_: tree_[0] holds the winner, tree_[1..k-1] the loser at each inner node
+    std::vector<size_t> tree_;
+    size_t batch_size_;
     size_t entries_read_ = 0;
     size_t bytes_read_ = 0;
-    
-    // Fill the queue with next entries from files
-    void fillQueue();
+
+    // Entries parsed from followed files on the follower thread
+    ThreadSafeQueue<FollowedEntry> followed_entries_;
+    // Shared event loop of all followed files, created with the first one; declared last so
+    // it stops before the queue it feeds is destroyed
+    std::unique_ptr<FileFollower> follower_;
+
+    // Open a file for reading or following
+    void openFile(const FileEntry& file);
+
+    // Parse the next batch of a file's entries (runs on a prefetch thread)
+    std::vector<TimedEntry> readBatch(Cursor& cursor) const;
+
+    // Replace an exhausted batch with the prefetched one and start the next prefetch
+    void refill(Cursor& cursor);
+
+    // Loser tree maintenance
+    bool beats(size_t a, size_t b) const;
+    void replay(size_t leaf);
+    void rebuildTree();
+
+    // Move entries parsed from followed files into their cursors; queueFollowedEntry() returns
+    // true if the entry refilled a drained cursor, which the tree must then be rebuilt for
+    void drainFollowedEntries();
+    bool queueFollowedEntry(FollowedEntry& followed);
 };
 
-} // namespace logai 
\ No newline at end of file
+} // namespace logai
@@ -0,0 +1,1142 @@
+#include "parallel_decompressor.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <bzlib.h>
+#include <lz4frame.h>
+#include <zlib.h>
+#include <zstd.h>
+#include <spdlog/spdlog.h>
+#include "memory_mapped_file.h"
+
+namespace logai {
+
+namespace {
+
+constexpr uint64_t kBzipBlockMagic = 0x314159265359ULL;
+constexpr uint64_t kBzipEndMagic = 0x177245385090ULL;
+constexpr uint64_t kMask48 = (1ULL << 48) - 1;
+constexpr size_t kGzipProbeBytes = 4096;  // Output inflated to confirm a member header
+constexpr size_t kMaxZlibInput = 1u << 30;  // zlib counts input in uInt
+constexpr uint32_t kZstdMagic = 0xFD2FB528;
+constexpr uint32_t kLz4Magic = 0x184D2204;
+constexpr uint32_t kSkippableMagic = 0x184D2A50;  // zstd and lz4 skippable frames, low nibble free
+constexpr uint32_t kSkippableMask = 0xFFFFFFF0;
+constexpr uint32_t kSeekTableMagic = 0x184D2A5E;  // Skippable frame holding the zstd seek table
+constexpr uint32_t kSeekTableFooterMagic = 0x8F92EAB1;
+
+using EmitChunk = std::function<bool(std::string&&)>;  // Returns false to stop decoding
+
+// A run of compressed input that decodes on its own
+struct Piece {
+    uint64_t begin = 0;       // Byte offset (gzip) or bit offset (bzip2)
+    uint64_t end = 0;
+    uint64_t out_begin = 0;   // Uncompressed offset, BGZF only
+    uint64_t out_size = 0;    // Uncompressed size, BGZF only
+};
+
+uint32_t read_le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+uint32_t read_le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+uint64_t read_le64(const uint8_t* p) { return read_le32(p) | (static_cast<uint64_t>(read_le32(p + 4)) << 32); }
+
+using ZstdContext = std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)>;
+using Lz4Context = std::unique_ptr<LZ4F_dctx, decltype(&LZ4F_freeDecompressionContext)>;
+
+Lz4Context make_lz4_context() {
+    LZ4F_dctx* ctx = nullptr;
+    if (LZ4F_isError(LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION))) {
+        throw std::runtime_error("Failed to create lz4 decompression context");
+    }
+    return Lz4Context(ctx, LZ4F_freeDecompressionContext);
+}
+
+// ---- Sequential decoders -------------------------------------------------
+
+// Inflate all members/streams; window_bits selects gzip (16 + 15) or zlib (15)
+void inflate_all(const uint8_t* data, size_t size, int window_bits, size_t chunk_bytes, const EmitChunk& emit) {
+    z_stream zs{};
+    if (inflateInit2(&zs, window_bits) != Z_OK) {
+        throw std::runtime_error("Failed to initialize zlib");
+    }
+    std::string out(chunk_bytes, '\0');
+    size_t produced = 0;
+    size_t pos = 0;  // Input handed to zlib so far
+    try {
+        while (true) {
+            if (zs.avail_in == 0 && pos < size) {
+                zs.next_in = const_cast<Bytef*>(data + pos);
+                zs.avail_in = static_cast<uInt>(std::min(size - pos, kMaxZlibInput));
+                pos += zs.avail_in;
+            }
+            zs.next_out = reinterpret_cast<Bytef*>(&out[produced]);
+            zs.avail_out = static_cast<uInt>(out.size() - produced);
+            int ret = inflate(&zs, Z_NO_FLUSH);
+            produced = out.size() - zs.avail_out;
+
+            if (produced == out.size()) {
+                if (!emit(std::move(out))) break;
+                out.assign(chunk_bytes, '\0');
+                produced = 0;
+            }
+            if (ret == Z_STREAM_END) {
+                // Another member follows unless only zero padding is left
+                const uint8_t* rest = zs.next_in;
+                if (std::all_of(rest, data + size, [](uint8_t b) { return b == 0; })) {
+                    break;
+                }
+                inflateReset(&zs);
+            } else if (ret == Z_BUF_ERROR && zs.avail_in == 0 && pos == size) {
+                throw std::runtime_error("Unexpected end of compressed data");
+            } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+                throw std::runtime_error(std::string("Corrupt compressed data: ") + (zs.msg ? zs.msg : "unknown error"));
+            }
+        }
+    } catch (...) {
+        inflateEnd(&zs);
+        throw;
+    }
+    inflateEnd(&zs);
+    if (produced > 0) {
+        out.resize(produced);
+        emit(std::move(out));
+    }
+}
+
+// Decompress all bzip2 streams
+void bunzip_all(const uint8_t* data, size_t size, size_t chunk_bytes, const EmitChunk& emit) {
+    bz_stream bs{};
+    if (BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK) {
+        throw std::runtime_error("Failed to initialize bzip2");
+    }
+    std::string out(chunk_bytes, '\0');
+    size_t produced = 0;
+    size_t pos = 0;  // Input handed to libbz2 so far
+    try {
+        while (true) {
+            if (bs.avail_in == 0 && pos < size) {
+                bs.next_in = const_cast<char*>(reinterpret_cast<const char*>(data + pos));
+                bs.avail_in = static_cast<unsigned>(std::min(size - pos, kMaxZlibInput));
+                pos += bs.avail_in;
+            }
+            bs.next_out = &out[produced];
+            bs.avail_out = static_cast<unsigned>(out.size() - produced);
+            int ret = BZ2_bzDecompress(&bs);
+            produced = out.size() - bs.avail_out;
+
+            if (produced == out.size()) {
+                if (!emit(std::move(out))) break;
+                out.assign(chunk_bytes, '\0');
+                produced = 0;
+            }
+            if (ret == BZ_STREAM_END) {
+                // Concatenated streams (pbzip2) continue with another "BZh" header
+                size_t next = static_cast<size_t>(reinterpret_cast<const uint8_t*>(bs.next_in) - data);
+                if (size - next < 4 || std::memcmp(data + next, "BZh", 3) != 0) {
+                    break;
+                }
+                BZ2_bzDecompressEnd(&bs);
+                bs = bz_stream{};
+                if (BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK) {
+                    throw std::runtime_error("Failed to initialize bzip2");
+                }
+                pos = next;
+            } else if (ret != BZ_OK) {
+                throw std::runtime_error("Corrupt bzip2 data, error " + std::to_string(ret));
+            } else if (bs.avail_in == 0 && pos == size && produced < out.size()) {
+                throw std::runtime_error("Unexpected end of compressed data");
+            }
+        }
+    } catch (...) {
+        BZ2_bzDecompressEnd(&bs);
+        throw;
+    }
+    BZ2_bzDecompressEnd(&bs);
+    if (produced > 0) {
+        out.resize(produced);
+        emit(std::move(out));
+    }
+}
+
+// Decode all zstd frames, skipping skippable ones (including a seek table)
+void unzstd_all(const uint8_t* data, size_t size, size_t chunk_bytes, const EmitChunk& emit) {
+    ZstdContext dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    ZSTD_inBuffer in{data, size, 0};
+    size_t ret = 0;
+    while (true) {
+        std::string out(chunk_bytes, '\0');
+        ZSTD_outBuffer buffer{out.data(), out.size(), 0};
+        ret = ZSTD_decompressStream(dctx.get(), &buffer, &in);
+        if (ZSTD_isError(ret)) {
+            throw std::runtime_error(std::string("zstd decompression failed: ") + ZSTD_getErrorName(ret));
+        }
+        bool full = buffer.pos == buffer.size;
+        if (buffer.pos > 0) {
+            out.resize(buffer.pos);
+            if (!emit(std::move(out))) return;
+        }
+        if (in.pos == in.size && !full) {
+            break;
+        }
+    }
+    if (ret != 0) {
+        throw std::runtime_error("Truncated zstd stream");
+    }
+}
+
+// Decode all lz4 frames
+void unlz4_all(const uint8_t* data, size_t size, size_t chunk_bytes, const EmitChunk& emit) {
+    auto dctx = make_lz4_context();
+    size_t pos = 0;
+    size_t hint = 0;
+    while (true) {
+        std::string out(chunk_bytes, '\0');
+        size_t out_size = out.size();
+        size_t in_size = size - pos;
+        hint = LZ4F_decompress(dctx.get(), out.data(), &out_size, data + pos, &in_size, nullptr);
+        if (LZ4F_isError(hint)) {
+            throw std::runtime_error(std::string("lz4 decompression failed: ") + LZ4F_getErrorName(hint));
+        }
+        pos += in_size;
+        bool full = out_size == out.size();
+        if (out_size > 0) {
+            out.resize(out_size);
+            if (!emit(std::move(out))) return;
+        }
+        if (pos == size && !full) {
+            break;
+        }
+    }
+    if (hint != 0) {
+        throw std::runtime_error("Truncated lz4 stream");
+    }
+}
+
+// ---- Piece decoders ------------------------------------------------------
+
+// Inflate gzip members that must end exactly at the end of the piece
+std::optional<std::string> inflate_piece(const uint8_t* data, size_t size) {
+    z_stream zs{};
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        return std::nullopt;
+    }
+    std::string out;
+    out.resize(std::max<size_t>(size * 4, 64 * 1024));
+    size_t produced = 0;
+    zs.next_in = const_cast<Bytef*>(data);
+    zs.avail_in = static_cast<uInt>(size);
+    bool ok = false;
+    while (true) {
+        if (produced == out.size()) {
+            out.resize(out.size() * 2);
+        }
+        zs.next_out = reinterpret_cast<Bytef*>(&out[produced]);
+        zs.avail_out = static_cast<uInt>(std::min(out.size() - produced, kMaxZlibInput));
+        int ret = inflate(&zs, Z_NO_FLUSH);
+        produced = static_cast<size_t>(reinterpret_cast<char*>(zs.next_out) - out.data());
+        if (ret == Z_STREAM_END) {
+            if (zs.avail_in == 0) {
+                ok = true;
+                break;
+            }
+            inflateReset(&zs);
+        } else if (ret == Z_BUF_ERROR && zs.avail_out > 0) {
+            break;  // Input ended inside a member: the piece end is not a member boundary
+        } else if (ret != Z_OK && ret != Z_BUF_ERROR) {
+            break;
+        }
+    }
+    inflateEnd(&zs);
+    if (!ok) {
+        return std::nullopt;
+    }
+    out.resize(produced);
+    return out;
+}
+
+// Whether inflating from data starts like a valid gzip member
+bool probe_gzip_member(const uint8_t* data, size_t size) {
+    z_stream zs{};
+    if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) {
+        return false;
+    }
+    char out[kGzipProbeBytes];
+    zs.next_in = const_cast<Bytef*>(data);
+    zs.avail_in = static_cast<uInt>(std::min<size_t>(size, 16 * kGzipProbeBytes));
+    zs.next_out = reinterpret_cast<Bytef*>(out);
+    zs.avail_out = sizeof(out);
+    int ret = inflate(&zs, Z_NO_FLUSH);
+    inflateEnd(&zs);
+    return ret == Z_OK || ret == Z_STREAM_END || ret == Z_BUF_ERROR;
+}
+
+// Bit-level access to bzip2 data, most significant bit first
+class BitWriter {
+public:
+    void put(uint32_t value, int bits) {
+        acc_ = (acc_ << bits) | (value & ((bits == 32) ? 0xFFFFFFFFu : ((1u << bits) - 1)));
+        count_ += bits;
+        while (count_ >= 8) {
+            count_ -= 8;
+            out_.push_back(static_cast<char>((acc_ >> count_) & 0xFF));
+        }
+    }
+    void copy(const uint8_t* data, size_t size, uint64_t bit, uint64_t bits) {
+        out_.reserve(out_.size() + bits / 8 + 16);
+        const int shift = static_cast<int>(bit & 7);
+        size_t byte = static_cast<size_t>(bit >> 3);
+        for (; bits >= 8; bits -= 8, ++byte) {
+            uint32_t hi = data[byte];
+            uint32_t lo = byte + 1 < size ? data[byte + 1] : 0;
+            put(((hi << 8 | lo) >> (8 - shift)) & 0xFF, 8);
+        }
+        if (bits > 0) {
+            uint32_t hi = data[byte];
+            uint32_t lo = byte + 1 < size ? data[byte + 1] : 0;
+            uint32_t window = (hi << 8 | lo) >> (8 - shift);
+            put((window >> (8 - bits)) & ((1u << bits) - 1), static_cast<int>(bits));
+        }
+    }
+    std::string finish() {
+        if (count_ > 0) {
+            put(0, 8 - count_);
+        }
+        return std::move(out_);
+    }
+
+private:
+    uint64_t acc_ = 0;
+    int count_ = 0;
+    std::string out_;
+};
+
+uint32_t read_bits32(const uint8_t* data, size_t size, uint64_t bit) {
+    uint64_t window = 0;
+    size_t byte = static_cast<size_t>(bit >> 3);
+    for (size_t i = 0; i < 5; ++i) {
+        window = (window << 8) | (byte + i < size ? data[byte + i] : 0);
+    }
+    return static_cast<uint32_t>((window >> (8 - (bit & 7))) & 0xFFFFFFFFu);
+}
+
+// Decode one bzip2 block (from its magic up to the next magic) by wrapping it as a single-block stream
+std::optional<std::string> bunzip_block(const uint8_t* data, size_t size, uint64_t begin_bit, uint64_t end_bit) {
+    BitWriter writer;
+    for (char c : std::string("BZh9")) {
+        writer.put(static_cast<uint8_t>(c), 8);  // Level 9 fits any block size
+    }
+    writer.copy(data, size, begin_bit, end_bit - begin_bit);
+    writer.put(static_cast<uint32_t>(kBzipEndMagic >> 24), 24);
+    writer.put(static_cast<uint32_t>(kBzipEndMagic & 0xFFFFFF), 24);
+    writer.put(read_bits32(data, size, begin_bit + 48), 32);  // Stream CRC of one block = block CRC
+    std::string stream = writer.finish();
+
+    bz_stream bs{};
+    if (BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK) {
+        return std::nullopt;
+    }
+    std::string out(stream.size() * 6 + 64 * 1024, '\0');
+    size_t produced = 0;
+    bs.next_in = stream.data();
+    bs.avail_in = static_cast<unsigned>(stream.size());
+    bool ok = false;
+    while (true) {
+        if (produced == out.size()) {
+            out.resize(out.size() * 2);
+        }
+        bs.next_out = &out[produced];
+        bs.avail_out = static_cast<unsigned>(out.size() - produced);
+        int ret = BZ2_bzDecompress(&bs);
+        produced = out.size() - bs.avail_out;
+        if (ret == BZ_STREAM_END) {
+            ok = true;
+            break;
+        }
+        if (ret != BZ_OK || (bs.avail_in == 0 && bs.avail_out > 0)) {
+            break;
+        }
+    }
+    BZ2_bzDecompressEnd(&bs);
+    if (!ok) {
+        return std::nullopt;
+    }
+    out.resize(produced);
+    return out;
+}
+
+// Decode whole zstd frames; out_size is their total content size if known, else 0
+std::optional<std::string> unzstd_piece(const uint8_t* data, size_t size, uint64_t out_size) {
+    thread_local ZstdContext dctx(ZSTD_createDCtx(), ZSTD_freeDCtx);
+    if (out_size > 0) {
+        // Known size: decode straight into the delivered buffer
+        std::string out(static_cast<size_t>(out_size), '\0');
+        size_t ret = ZSTD_decompressDCtx(dctx.get(), out.data(), out.size(), data, size);
+        if (ZSTD_isError(ret) || ret != out.size()) {
+            return std::nullopt;
+        }
+        return out;
+    }
+
+    ZSTD_DCtx_reset(dctx.get(), ZSTD_reset_session_only);
+    std::string out(std::max<size_t>(size * 4, 64 * 1024), '\0');
+    ZSTD_inBuffer in{data, size, 0};
+    ZSTD_outBuffer buffer{out.data(), out.size(), 0};
+    while (true) {
+        size_t ret = ZSTD_decompressStream(dctx.get(), &buffer, &in);
+        if (ZSTD_isError(ret)) {
+            return std::nullopt;
+        }
+        if (in.pos == in.size && buffer.pos < buffer.size) {
+            if (ret != 0) return std::nullopt;
+            break;
+        }
+        if (buffer.pos == buffer.size) {
+            out.resize(out.size() * 2);
+            buffer.dst = out.data();
+            buffer.size = out.size();
+        }
+    }
+    out.resize(buffer.pos);
+    return out;
+}
+
+// Decode whole lz4 frames; out_size is their total content size if known, else 0
+std::optional<std::string> unlz4_piece(const uint8_t* data, size_t size, uint64_t out_size) {
+    auto dctx = make_lz4_context();
+    std::string out(out_size > 0 ? static_cast<size_t>(out_size) + 1 : std::max<size_t>(size * 4, 64 * 1024), '\0');
+    size_t produced = 0;
+    size_t pos = 0;
+    size_t hint = 0;
+    while (true) {
+        if (produced == out.size()) {
+            out.resize(out.size() * 2);
+        }
+        size_t out_avail = out.size() - produced;
+        size_t in_size = size - pos;
+        hint = LZ4F_decompress(dctx.get(), &out[produced], &out_avail, data + pos, &in_size, nullptr);
+        if (LZ4F_isError(hint)) {
+            return std::nullopt;
+        }
+        pos += in_size;
+        produced += out_avail;
+        if (pos == size && produced < out.size()) {
+            break;
+        }
+    }
+    if (hint != 0) {
+        return std::nullopt;
+    }
+    out.resize(produced);
+    return out;
+}
+
+// ---- Piece discovery -----------------------------------------------------
+
+// BGZF: every member carries its compressed size in a "BC" extra field
+bool find_bgzf_members(const uint8_t* data, size_t size, std::vector<Piece>& members) {
+    uint64_t offset = 0;
+    uint64_t out_offset = 0;
+    while (offset < size) {
+        const uint8_t* p = data + offset;
+        if (size - offset < 18 || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8 || !(p[3] & 4)) {
+            return false;
+        }
+        uint32_t xlen = read_le16(p + 10);
+        uint32_t block_size = 0;
+        for (uint32_t x = 12; x + 4 <= 12 + xlen && offset + x + 4 <= size;) {
+            uint32_t slen = read_le16(p + x + 2);
+            if (p[x] == 'B' && p[x + 1] == 'C' && slen == 2) {
+                block_size = read_le16(p + x + 4) + 1;
+                break;
+            }
+            x += 4 + slen;
+        }
+        if (block_size < 26 || offset + block_size > size) {
+            return false;
+        }
+        uint32_t isize = read_le32(p + block_size - 4);
+        members.push_back(Piece{offset, offset + block_size, out_offset, isize});
+        offset += block_size;
+        out_offset += isize;
+    }
+    return !members.empty();
+}
+
+// Member starts of a multi-member gzip file, at least min_gap bytes apart
+std::vector<uint64_t> find_gzip_members(const uint8_t* data, size_t size, size_t min_gap) {
+    std::vector<uint64_t> starts{0};
+    uint64_t pos = min_gap;
+    while (pos + 10 < size) {
+        const void* hit = std::memchr(data + pos, 0x1f, size - pos - 10);
+        if (!hit) break;
+        pos = static_cast<uint64_t>(static_cast<const uint8_t*>(hit) - data);
+        const uint8_t* p = data + pos;
+        // Magic, deflate, no reserved flags, plausible XFL/OS, and inflates cleanly
+        if (p[1] == 0x8b && p[2] == 8 && (p[3] & 0xE0) == 0 && (p[8] == 0 || p[8] == 2 || p[8] == 4) &&
+            (p[9] <= 13 || p[9] == 255) && probe_gzip_member(p, size - pos)) {
+            starts.push_back(pos);
+            pos += min_gap;
+        } else {
+            ++pos;
+        }
+    }
+    return starts;
+}
+
+// zstd seekable format: frame sizes from the seek table in the trailing skippable frame
+bool find_zstd_seek_table(const uint8_t* data, size_t size, std::vector<Piece>& frames) {
+    if (size < 17 || read_le32(data + size - 4) != kSeekTableFooterMagic) {
+        return false;
+    }
+    const uint64_t num_frames = read_le32(data + size - 9);
+    const uint8_t descriptor = data[size - 5];
+    const size_t entry_size = (descriptor & 0x80) ? 12 : 8;
+    const uint64_t table_size = num_frames * entry_size + 9;
+    if (table_size + 8 > size) {
+        return false;
+    }
+    const uint8_t* table = data + size - table_size - 8;
+    if (read_le32(table) != kSeekTableMagic || read_le32(table + 4) != table_size) {
+        return false;
+    }
+
+    uint64_t offset = 0;
+    uint64_t out_offset = 0;
+    for (uint64_t i = 0; i < num_frames; ++i) {
+        const uint8_t* entry = table + 8 + i * entry_size;
+        uint32_t compressed = read_le32(entry);
+        uint32_t decompressed = read_le32(entry + 4);
+        frames.push_back(Piece{offset, offset + compressed, out_offset, decompressed});
+        offset += compressed;
+        out_offset += decompressed;
+    }
+    if (offset != static_cast<uint64_t>(table - data)) {
+        frames.clear();
+        return false;
+    }
+    return !frames.empty();
+}
+
+// zstd frames walked via their headers; true if every frame declares its content size
+bool find_zstd_frames(const uint8_t* data, size_t size, std::vector<Piece>& frames) {
+    if (find_zstd_seek_table(data, size, frames)) {
+        return true;
+    }
+    bool sized = true;
+    uint64_t offset = 0;
+    uint64_t out_offset = 0;
+    while (offset < size) {
+        size_t frame_size = ZSTD_findFrameCompressedSize(data + offset, size - offset);
+        if (ZSTD_isError(frame_size)) {
+            frames.clear();  // Let the sequential decoder report the corruption
+            return false;
+        }
+        unsigned long long content = ZSTD_getFrameContentSize(data + offset, size - offset);
+        if (content == ZSTD_CONTENTSIZE_UNKNOWN || content == ZSTD_CONTENTSIZE_ERROR) {
+            sized = false;
+            content = 0;
+        }
+        frames.push_back(Piece{offset, offset + frame_size, out_offset, content});
+        offset += frame_size;
+        out_offset += content;
+    }
+    return sized && !frames.empty();
+}
+
+// Compressed size of the lz4 (or skippable) frame at data, walking its block headers
+std::optional<size_t> lz4_frame_size(const uint8_t* data, size_t size, uint64_t& content_size, bool& sized) {
+    if (size < 8) {
+        return std::nullopt;
+    }
+    uint32_t magic = read_le32(data);
+    if ((magic & kSkippableMask) == kSkippableMagic) {
+        uint64_t frame_size = 8 + static_cast<uint64_t>(read_le32(data + 4));
+        content_size = 0;
+        return frame_size <= size ? std::optional<size_t>(frame_size) : std::nullopt;
+    }
+    if (magic != kLz4Magic) {
+        return std::nullopt;
+    }
+
+    const uint8_t flags = data[4];
+    const bool block_checksum = flags & 0x10;
+    const bool has_content_size = flags & 0x08;
+    const bool content_checksum = flags & 0x04;
+    const bool has_dict_id = flags & 0x01;
+    if ((flags >> 6) != 1) {
+        return std::nullopt;
+    }
+    size_t pos = 7 + (has_content_size ? 8 : 0) + (has_dict_id ? 4 : 0);
+    if (pos > size) {
+        return std::nullopt;
+    }
+    sized = has_content_size;
+    content_size = has_content_size ? read_le64(data + 6) : 0;
+
+    while (true) {
+        if (pos + 4 > size) {
+            return std::nullopt;
+        }
+        uint32_t block = read_le32(data + pos);
+        pos += 4;
+        if (block == 0) {
+            break;  // End mark
+        }
+        pos += (block & 0x7FFFFFFF) + (block_checksum ? 4 : 0);
+    }
+    pos += content_checksum ? 4 : 0;
+    return pos <= size ? std::optional<size_t>(pos) : std::nullopt;
+}
+
+// lz4 frames; true if every frame declares its content size
+bool find_lz4_frames(const uint8_t* data, size_t size, std::vector<Piece>& frames) {
+    bool all_sized = true;
+    uint64_t offset = 0;
+    uint64_t out_offset = 0;
+    while (offset < size) {
+        uint64_t content = 0;
+        bool sized = true;
+        auto frame_size = lz4_frame_size(data + offset, size - offset, content, sized);
+        if (!frame_size) {
+            frames.clear();
+            return false;
+        }
+        all_sized = all_sized && sized;
+        frames.push_back(Piece{offset, offset + *frame_size, out_offset, content});
+        offset += *frame_size;
+        out_offset += content;
+    }
+    return all_sized && !frames.empty();
+}
+
+struct BzipMagic {
+    uint64_t bit;
+    bool block;  // Block start, otherwise end of stream
+};
+
+// Bit offsets of all block and end-of-stream magics, scanned on several threads
+std::vector<BzipMagic> find_bzip2_magics(const uint8_t* data, size_t size, size_t threads) {
+    const size_t segments = std::max<size_t>(1, std::min(threads, size / (1 << 20)));
+    std::vector<std::vector<BzipMagic>> found(segments);
+    auto scan = [&](size_t s) {
+        const size_t begin = size * s / segments;
+        const size_t end = size * (s + 1) / segments;
+        uint64_t reg = 0;
+        // Preload the bytes before the segment so magics straddling the boundary are seen once
+        for (size_t i = begin >= 7 ? begin - 7 : 0; i < end; ++i) {
+            reg = (reg << 8) | data[i];
+            if (i + 1 < 6 || i < begin) continue;
+            for (int shift = 0; shift < 8; ++shift) {
+                uint64_t window = (reg >> shift) & kMask48;
+                if (window == kBzipBlockMagic || window == kBzipEndMagic) {
+                    uint64_t end_bit = (static_cast<uint64_t>(i) + 1) * 8 - shift;
+                    if (end_bit >= 48) {
+                        found[s].push_back(BzipMagic{end_bit - 48, window == kBzipBlockMagic});
+                    }
+                }
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t s = 1; s < segments; ++s) {
+        workers.emplace_back(scan, s);
+    }
+    scan(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<BzipMagic> magics;
+    for (auto& segment : found) {
+        magics.insert(magics.end(), segment.begin(), segment.end());
+    }
+    std::sort(magics.begin(), magics.end(), [](const BzipMagic& a, const BzipMagic& b) { return a.bit < b.bit; });
+    return magics;
+}
+
+// ---- Execution -----------------------------------------------------------
+
+// Decode pieces on worker threads and deliver them in order. Returns the
+// number of pieces delivered before the first one that failed to decode.
+size_t run_pieces(size_t count, size_t threads, size_t in_flight,
+                  const std::function<std::optional<std::string>(size_t)>& decode,
+                  const std::function<void(size_t, const std::string&)>& deliver) {
+    struct Slot {
+        bool done = false;
+        std::optional<std::string> data;
+    };
+    std::vector<Slot> slots(count);
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t next = 0;
+    size_t delivered = 0;
+    bool abort = false;
+
+    auto worker = [&] {
+        while (true) {
+            size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return abort || next >= count || next < delivered + in_flight; });
+                if (abort || next >= count) return;
+                index = next++;
+            }
+            std::optional<std::string> data;
+            try {
+                data = decode(index);
+            } catch (const std::exception&) {
+                data.reset();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            slots[index].data = std::move(data);
+            slots[index].done = true;
+            cv.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < std::min(threads, count); ++t) {
+        workers.emplace_back(worker);
+    }
+    auto stop = [&] {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            abort = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers) w.join();
+    };
+
+    try {
+        for (size_t i = 0; i < count; ++i) {
+            std::optional<std::string> data;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return slots[i].done; });
+                data = std::move(slots[i].data);
+            }
+            if (!data) {
+                stop();
+                return i;
+            }
+            deliver(i, *data);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                delivered = i + 1;
+            }
+            cv.notify_all();
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+    stop();
+    return count;
+}
+
+// Sequential decoding on a background thread, handing chunks to the caller
+void run_sequential(const std::function<void(const EmitChunk&)>& decode_all,
+                    const std::function<void(const std::string&)>& deliver) {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::string> chunks;
+    bool finished = false;
+    bool cancelled = false;
+    std::exception_ptr error;
+    constexpr size_t kMaxChunks = 4;
+
+    std::thread producer([&] {
+        try {
+            decode_all([&](std::string&& chunk) {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return cancelled || chunks.size() < kMaxChunks; });
+                if (cancelled) return false;
+                chunks.push_back(std::move(chunk));
+                cv.notify_all();
+                return true;
+            });
+        } catch (...) {
+            error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        cv.notify_all();
+    });
+
+    try {
+        while (true) {
+            std::string chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return finished || !chunks.empty(); });
+                if (chunks.empty()) break;
+                chunk = std::move(chunks.front());
+                chunks.pop_front();
+                cv.notify_all();
+            }
+            deliver(chunk);
+        }
+    } catch (...) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cancelled = true;
+        }
+        cv.notify_all();
+        producer.join();
+        throw;
+    }
+    producer.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace
+
+CompressionFormat compression_from_extension(const std::string& path) {
+    auto dot = path.find_last_of('.');
+    std::string ext = dot == std::string::npos ? "" : path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (ext == "gz" || ext == "gzip") return CompressionFormat::Gzip;
+    if (ext == "bz2") return CompressionFormat::Bzip2;
+    if (ext == "z") return CompressionFormat::Zlib;
+    if (ext == "zst" || ext == "zstd") return CompressionFormat::Zstd;
+    if (ext == "lz4") return CompressionFormat::Lz4;
+    return CompressionFormat::None;
+}
+
+CompressionFormat detect_compression(const std::string& path) {
+    uint8_t magic[4] = {};
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return compression_from_extension(path);
+    }
+    if (!file.read(reinterpret_cast<char*>(magic), sizeof(magic))) {
+        return CompressionFormat::None;  // Too short to be compressed
+    }
+
+    const uint32_t word = read_le32(magic);
+    if (magic[0] == 0x1f && magic[1] == 0x8b) return CompressionFormat::Gzip;
+    if (magic[0] == 'B' && magic[1] == 'Z' && magic[2] == 'h' && magic[3] >= '1' && magic[3] <= '9') {
+        return CompressionFormat::Bzip2;
+    }
+    if (word == kZstdMagic) return CompressionFormat::Zstd;
+    if (word == kLz4Magic) return CompressionFormat::Lz4;
+    if ((word & kSkippableMask) == kSkippableMagic) {
+        // Skippable frames are shared by zstd and lz4; the extension decides, zstd otherwise
+        return compression_from_extension(path) == CompressionFormat::Lz4 ? CompressionFormat::Lz4
+                                                                          : CompressionFormat::Zstd;
+    }
+    // Deflate method, 32K window or less, header checksum, no preset dictionary
+    if ((magic[0] & 0x0f) == 8 && (magic[0] >> 4) <= 7 && ((magic[0] << 8) | magic[1]) % 31 == 0 &&
+        !(magic[1] & 0x20) && compression_from_extension(path) == CompressionFormat::Zlib) {
+        return CompressionFormat::Zlib;
+    }
+    return CompressionFormat::None;
+}
+
+ParallelDecompressor::ParallelDecompressor(const DecompressorConfig& config) : config_(config) {
+    if (config_.num_threads == 0) {
+        config_.num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (config_.max_pieces_in_flight == 0) {
+        config_.max_pieces_in_flight = 2 * config_.num_threads;
+    }
+    config_.chunk_bytes = std::max<size_t>(config_.chunk_bytes, 4096);
+}
+
+void ParallelDecompressor::decompress(const std::string& path, CompressionFormat format,
+                                      const ChunkCallback& callback, uint64_t start_offset) {
+    stats_ = DecompressorStats();
+    if (std::filesystem::file_size(path) == 0) {
+        return;
+    }
+    // Input is consumed front to back; pages behind the delivered pieces are released
+    MappingOptions options;
+    options.sequential = true;
+    options.release_consumed = true;
+    MemoryMappedFile file(path, options);
+    if (!file.isOpen()) {
+        throw std::runtime_error("Failed to open compressed file: " + path);
+    }
+    const auto* data = reinterpret_cast<const uint8_t*>(file.data());
+    const size_t size = file.size();
+    stats_.bytes_in = size;
+
+    // Output before start_offset is decoded (unless skipped via an index) but not delivered
+    uint64_t skip = start_offset;
+    auto deliver = [&](const std::string& chunk) {
+        const char* p = chunk.data();
+        size_t n = chunk.size();
+        if (skip >= n) {
+            skip -= n;
+            return;
+        }
+        p += skip;
+        n -= static_cast<size_t>(skip);
+        skip = 0;
+        stats_.bytes_out += n;
+        callback(p, n);
+    };
+    auto sequential = [&] {
+        skip = start_offset + stats_.bytes_out;
+        run_sequential([&](const EmitChunk& emit) {
+            switch (format) {
+                case CompressionFormat::Gzip: inflate_all(data, size, 16 + MAX_WBITS, config_.chunk_bytes, emit); break;
+                case CompressionFormat::Zlib: inflate_all(data, size, MAX_WBITS, config_.chunk_bytes, emit); break;
+                case CompressionFormat::Bzip2: bunzip_all(data, size, config_.chunk_bytes, emit); break;
+                case CompressionFormat::Zstd: unzstd_all(data, size, config_.chunk_bytes, emit); break;
+                case CompressionFormat::Lz4: unlz4_all(data, size, config_.chunk_bytes, emit); break;
+                case CompressionFormat::None:
+                    for (size_t offset = 0; offset < size; offset += config_.chunk_bytes) {
+                        if (!emit(std::string(reinterpret_cast<const char*>(data) + offset,
+                                              std::min(config_.chunk_bytes, size - offset)))) break;
+                    }
+                    break;
+            }
+        }, deliver);
+    };
+
+    // Frames whose uncompressed sizes are all known (BGZF, seekable or sized zstd/lz4) are
+    // grouped into pieces of min_piece_bytes, and whole groups before start_offset are dropped
+    std::vector<Piece> frames;
+    bool sized = false;
+    switch (format) {
+        case CompressionFormat::Gzip:
+            sized = find_bgzf_members(data, size, frames);
+            if (!sized) frames.clear();  // Not BGZF, members are searched for below
+            break;
+        case CompressionFormat::Zstd: sized = find_zstd_frames(data, size, frames); break;
+        case CompressionFormat::Lz4: sized = find_lz4_frames(data, size, frames); break;
+        default: break;
+    }
+    if (!sized) {
+        for (auto& frame : frames) {
+            frame.out_begin = frame.out_size = 0;
+        }
+    }
+
+    std::vector<Piece> pieces;
+    for (const auto& frame : frames) {
+        if (pieces.empty() || pieces.back().end - pieces.back().begin >= config_.min_piece_bytes) {
+            pieces.push_back(frame);
+        } else {
+            pieces.back().end = frame.end;
+            pieces.back().out_size += frame.out_size;
+        }
+    }
+    if (sized) {
+        auto first = std::find_if(pieces.begin(), pieces.end(),
+                                  [&](const Piece& p) { return p.out_begin + p.out_size > start_offset; });
+        if (first == pieces.end()) {
+            return;
+        }
+        skip = start_offset - first->out_begin;
+        pieces.erase(pieces.begin(), first);
+    } else if (format == CompressionFormat::Gzip) {
+        auto starts = find_gzip_members(data, size, config_.min_piece_bytes);
+        for (size_t i = 0; i < starts.size(); ++i) {
+            pieces.push_back(Piece{starts[i], i + 1 < starts.size() ? starts[i + 1] : size, 0, 0});
+        }
+    } else if (format == CompressionFormat::Bzip2) {
+        auto magics = find_bzip2_magics(data, size, config_.num_threads);
+        // A block without a following magic means truncation; let the sequential decoder report it
+        if (!magics.empty() && magics.back().block) {
+            magics.clear();
+        }
+        for (size_t i = 0; i < magics.size(); ++i) {
+            if (magics[i].block && i + 1 < magics.size()) {
+                pieces.push_back(Piece{magics[i].bit, magics[i + 1].bit, 0, 0});
+            }
+        }
+    }
+
+    if (pieces.size() < 2) {
+        sequential();
+        return;
+    }
+
+    stats_.pieces = pieces.size();
+    stats_.parallel = config_.num_threads > 1;
+    auto decode = [&](size_t i) -> std::optional<std::string> {
+        const Piece& piece = pieces[i];
+        const auto* begin = data + piece.begin;
+        const auto length = static_cast<size_t>(piece.end - piece.begin);
+        switch (format) {
+            case CompressionFormat::Bzip2: return bunzip_block(data, size, piece.begin, piece.end);
+            case CompressionFormat::Zstd: return unzstd_piece(begin, length, piece.out_size);
+            case CompressionFormat::Lz4: return unlz4_piece(begin, length, piece.out_size);
+            default: return inflate_piece(begin, length);
+        }
+    };
+    auto deliver_piece = [&](size_t i, const std::string& chunk) {
+        deliver(chunk);
+        // Workers have moved past piece i, so the input before the next piece is no longer read
+        if (i + 1 < pieces.size()) {
+            file.advance(format == CompressionFormat::Bzip2 ? pieces[i + 1].begin / 8 : pieces[i + 1].begin);
+        }
+    };
+    size_t delivered = run_pieces(pieces.size(), config_.num_threads, config_.max_pieces_in_flight, decode,
+                                  deliver_piece);
+    if (delivered < pieces.size()) {
+        // A boundary was not real; finish with one decoder, skipping what was already delivered
+        spdlog::warn("Piece {} of {} does not decode on its own, decompressing the rest sequentially", delivered, path);
+        stats_.fell_back = true;
+        sequential();
+    }
+}
+
+// Hands the decompressor's output chunks to the reading thread through a short queue
+class DecompressedStream::Buffer : public std::streambuf {
+public:
+    Buffer(const std::string& path, CompressionFormat format, const DecompressorConfig& config)
+        : path_(path), format_(format), config_(config) {}
+
+    ~Buffer() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cancelled_ = true;
+        }
+        cv_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        if (!thread_.joinable()) {
+            // Only the reading thread gets here, the decoder starts with the first read
+            thread_ = std::thread([this] { run(format_, config_); });
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return finished_ || !chunks_.empty(); });
+        if (chunks_.empty()) {
+            if (!error_.empty()) {
+                spdlog::error("Failed to decompress {}: {}", path_, error_);
+                error_.clear();
+                throw std::runtime_error("Failed to decompress " + path_);  // Sets badbit on the stream
+            }
+            return traits_type::eof();
+        }
+        current_ = std::move(chunks_.front());
+        chunks_.pop_front();
+        cv_.notify_all();
+        setg(current_.data(), current_.data(), current_.data() + current_.size());
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    struct Cancelled {};
+    static constexpr size_t kMaxChunks = 4;
+
+    void run(CompressionFormat format, const DecompressorConfig& config) {
+        try {
+            ParallelDecompressor decompressor(config);
+            decompressor.decompress(path_, format, [&](const char* data, size_t size) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [&] { return cancelled_ || chunks_.size() < kMaxChunks; });
+                if (cancelled_) throw Cancelled{};
+                chunks_.emplace_back(data, size);
+                cv_.notify_all();
+            });
+        } catch (const Cancelled&) {
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = e.what();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+        cv_.notify_all();
+    }
+
+    std::string path_;
+    CompressionFormat format_;
+    DecompressorConfig config_;
+    std::string current_;
+    std::deque<std::string> chunks_;
+    std::string error_;
+    bool finished_ = false;
+    bool cancelled_ = false;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread thread_;  // Started by the first underflow()
+};
+
+DecompressedStream::DecompressedStream(const std::string& path, CompressionFormat format,
+                                       const DecompressorConfig& config)
+    : std::istream(nullptr), buffer_(std::make_unique<Buffer>(path, format, config)) {
+    rdbuf(buffer_.get());
+}
+
+DecompressedStream::~DecompressedStream() = default;
+
+LineSplitter::LineSplitter(LineCallback callback, size_t max_line_length)
+    : callback_(std::move(callback)), max_line_length_(max_line_length) {}
+
+void LineSplitter::feed(const char* data, size_t size) {
+    const char* end = data + size;
+    const char* p = data;
+    while (p < end) {
+        const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!newline) {
+            if (!skipping_) {
+                partial_.append(p, static_cast<size_t>(end - p));
+                if (partial_.size() > max_line_length_) {
+                    spdlog::warn("Skipping line {}: longer than {} bytes", lines_ + 1, max_line_length_);
+                    partial_.clear();
+                    skipping_ = true;
+                }
+            }
+            return;
+        }
+        if (skipping_) {
+            skipping_ = false;
+        } else if (partial_.empty()) {
+            emit(std::string_view(p, static_cast<size_t>(newline - p)));
+        } else {
+            partial_.append(p, static_cast<size_t>(newline - p));
+            emit(partial_);
+            partial_.clear();
+        }
+        ++lines_;
+        p = newline + 1;
+    }
+}
+
+void LineSplitter::finish() {
+    if (!partial_.empty() && !skipping_) {
+        emit(partial_);
+        ++lines_;
+    }
+    partial_.clear();
+    skipping_ = false;
+}
+
+void LineSplitter::emit(std::string_view line) {
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (line.empty()) {
+        return;
+    }
+    if (line.size() > max_line_length_) {
+        spdlog::warn("Skipping line {}: longer than {} bytes", lines_ + 1, max_line_length_);
+        return;
+    }
+    callback_(line);
+}
+
+} // namespace logai
@@ -0,0 +1,158 @@
+/**
+ * @file parallel_decompressor.h
+ * @brief Multi-threaded decompression of gzip, bzip2, zstd and lz4 log archives
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace logai {
+
+enum class CompressionFormat {
+    None,
+    Gzip,
+    Bzip2,
+    Zlib,
+    Zstd,
+    Lz4
+};
+
+/**
+ * @brief Compression of a file judged by its extension (.gz/.gzip, .bz2, .z, .zst/.zstd, .lz4)
+ */
+CompressionFormat compression_from_extension(const std::string& path);
+
+/**
+ * @brief Compression of a file judged by its leading magic bytes
+ *
+ * gzip, bzip2, zstd (including a leading skippable frame) and lz4 frames are
+ * recognized by content whatever the file is called. zlib has no real magic,
+ * so a zlib header is only trusted when the extension is .z as well.
+ * Unreadable files fall back to compression_from_extension().
+ */
+CompressionFormat detect_compression(const std::string& path);
+
+/**
+ * @brief Configuration for the ParallelDecompressor
+ */
+struct DecompressorConfig {
+    size_t num_threads = 0;                 ///< Decoding threads, 0 = hardware concurrency
+    size_t min_piece_bytes = 4 * 1024 * 1024;  ///< Compressed bytes per work item; gzip members are grouped up to this
+    size_t max_pieces_in_flight = 0;        ///< Decoded pieces buffered ahead of the consumer, 0 = 2 * num_threads
+    size_t chunk_bytes = 256 * 1024;        ///< Output chunk size of sequential decoding
+};
+
+/**
+ * @brief What the last decompress() call did
+ */
+struct DecompressorStats {
+    size_t pieces = 0;           ///< Independently decoded pieces, 0 if decoded sequentially
+    bool parallel = false;       ///< Pieces were decoded on several threads
+    bool fell_back = false;      ///< A piece boundary turned out to be wrong; the rest was decoded sequentially
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;      ///< Bytes delivered to the callback
+};
+
+/**
+ * @brief Decompresses a file on several threads and delivers the output in order
+ *
+ * The compressed file is memory-mapped and split into pieces that decode
+ * independently:
+ *  - bzip2: every block. Blocks are found by their bit-aligned magic and
+ *    each is rewrapped as a single-block stream, so ordinary single-stream
+ *    .bz2 files decode in parallel.
+ *  - gzip: members. BGZF member boundaries (and, from each member's ISIZE,
+ *    their uncompressed offsets) are read from the headers; other
+ *    multi-member files (pigz --independent, concatenated archives) are
+ *    split at validated member headers.
+ *  - zstd: frames. The seek table of the seekable format gives frame sizes
+ *    and uncompressed offsets directly; otherwise frames are walked via
+ *    their headers, and frames declaring their content size are decoded
+ *    into exactly sized buffers.
+ *  - lz4: frames, walked via their block headers.
+ *
+ * A single-member gzip or zlib stream cannot be split and is decoded on one
+ * background thread, still overlapping with the consumer. A piece that
+ * fails to decode (a false boundary) makes the rest of the file decode
+ * sequentially, so the output is always the same as a sequential decoder's.
+ */
+class ParallelDecompressor {
+public:
+    using ChunkCallback = std::function<void(const char* data, size_t size)>;
+
+    explicit ParallelDecompressor(const DecompressorConfig& config = DecompressorConfig());
+
+    /**
+     * @brief Decompress a file, calling callback with consecutive chunks of output
+     *
+     * @param path Compressed file
+     * @param format Compression of the file; None copies the file unchanged
+     * @param callback Receives the output in order, on the calling thread
+     * @param start_offset Uncompressed offset to start at; BGZF, seekable zstd and zstd/lz4 frames with
+     *                     known content sizes skip whole pieces
+     * @throws std::runtime_error if the file cannot be read or is corrupt
+     */
+    void decompress(const std::string& path, CompressionFormat format, const ChunkCallback& callback,
+                    uint64_t start_offset = 0);
+
+    const DecompressorStats& stats() const { return stats_; }
+
+private:
+    DecompressorConfig config_;
+    DecompressorStats stats_;
+};
+
+/**
+ * @brief Input stream over a compressed file, decoded by a ParallelDecompressor on a background thread
+ *
+ * Decoding starts with the first read, so a stream that is never read costs
+ * nothing. Decoding errors are logged and end the stream with badbit set.
+ */
+class DecompressedStream : public std::istream {
+public:
+    DecompressedStream(const std::string& path, CompressionFormat format,
+                       const DecompressorConfig& config = DecompressorConfig());
+    ~DecompressedStream() override;
+
+private:
+    class Buffer;
+    std::unique_ptr<Buffer> buffer_;
+};
+
+/**
+ * @brief Splits a stream of chunks into lines, carrying partial lines across chunks
+ *
+ * Lines are passed without their newline (and trailing '\r'); empty lines are
+ * skipped and lines longer than max_line_length are dropped with a warning.
+ */
+class LineSplitter {
+public:
+    using LineCallback = std::function<void(std::string_view line)>;
+
+    LineSplitter(LineCallback callback, size_t max_line_length);
+
+    void feed(const char* data, size_t size);
+
+    /**
+     * @brief Deliver a last line that has no trailing newline
+     */
+    void finish();
+
+    uint64_t lines() const { return lines_; }
+
+private:
+    void emit(std::string_view line);
+
+    LineCallback callback_;
+    size_t max_line_length_;
+    std::string partial_;
+    bool skipping_ = false;
+    uint64_t lines_ = 0;
+};
+
+} // namespace logai
@@ -0,0 +1,54 @@
+#include "parse_error_sink.h"
+
+#include <algorithm>
+
+namespace logai {
+
+void ParseErrorRing::record(uint64_t line, uint64_t offset, ParseStatus code) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!slots_.empty()) {
+        slots_[recorded_ % slots_.size()] = Slot{line, offset, code};
+    }
+    ++recorded_;
+}
+
+void ParseErrorSink::reset(size_t capacity_per_thread) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rings_.clear();
+    capacity_ = capacity_per_thread;
+}
+
+ParseErrorRing& ParseErrorSink::register_thread(const std::string& parser) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rings_.emplace_back(parser, capacity_);
+}
+
+uint64_t ParseErrorSink::total() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t total = 0;
+    for (const auto& ring : rings_) {
+        std::lock_guard<std::mutex> ring_lock(ring.mutex_);
+        total += ring.recorded_;
+    }
+    return total;
+}
+
+ParseErrorReport ParseErrorSink::report() const {
+    ParseErrorReport report;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& ring : rings_) {
+        std::lock_guard<std::mutex> ring_lock(ring.mutex_);
+        const uint64_t kept = std::min<uint64_t>(ring.recorded_, ring.slots_.size());
+        report.total += ring.recorded_;
+        report.dropped += ring.recorded_ - kept;
+        for (uint64_t i = 0; i < kept; ++i) {
+            const auto& slot = ring.slots_[i];
+            report.errors.push_back(ParseError{slot.line, slot.offset, ring.parser_, slot.code});
+        }
+    }
+    std::sort(report.errors.begin(), report.errors.end(),
+              [](const ParseError& a, const ParseError& b) { return a.line < b.line; });
+    return report;
+}
+
+} // namespace logai
@@ -0,0 +1,103 @@
+/**
+ * @file parse_error_sink.h
+ * @brief Bounded, per-thread record of the lines a pipeline failed to parse
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "parse_status.h"
+
+namespace logai {
+
+/**
+ * @brief One failed line
+ *
+ * line counts the non-blank lines read, from 1. offset assumes one
+ * terminator per line, so it is exact up to the first blank line, CRLF
+ * ending or dropped over-long line, and a close estimate after one.
+ */
+struct ParseError {
+    uint64_t line = 0;
+    uint64_t offset = 0;
+    std::string parser;
+    ParseStatus code = ParseStatus::Malformed;
+};
+
+/**
+ * @brief The errors a sink kept, sorted by line, and how many it saw
+ */
+struct ParseErrorReport {
+    std::vector<ParseError> errors;
+    uint64_t total = 0;    ///< Errors recorded, kept or not
+    uint64_t dropped = 0;  ///< Older errors overwritten in full rings
+};
+
+/**
+ * @brief Fixed-size ring of one thread's most recent parse errors
+ *
+ * Recording copies three integers into a preallocated slot and never
+ * allocates, formats or writes anywhere, so a run of bad lines costs
+ * little more than a run of good ones. Only the owning thread records;
+ * the lock is there for readers and is uncontended otherwise.
+ */
+class ParseErrorRing {
+public:
+    ParseErrorRing(std::string parser, size_t capacity) : parser_(std::move(parser)), slots_(capacity) {}
+
+    void record(uint64_t line, uint64_t offset, ParseStatus code);
+
+    const std::string& parser() const { return parser_; }
+
+private:
+    friend class ParseErrorSink;
+
+    struct Slot {
+        uint64_t line;
+        uint64_t offset;
+        ParseStatus code;
+    };
+
+    const std::string parser_;
+    mutable std::mutex mutex_;
+    std::vector<Slot> slots_;
+    uint64_t recorded_ = 0;  // Slot recorded_ % capacity is written next
+};
+
+/**
+ * @brief Parse error rings of one loader's pipeline runs
+ *
+ * Each worker registers a ring when it starts; report() merges them, and
+ * may be called while a run is in progress.
+ */
+class ParseErrorSink {
+public:
+    explicit ParseErrorSink(size_t capacity_per_thread = 1024) : capacity_(capacity_per_thread) {}
+
+    /**
+     * @brief Forget the previous run's errors
+     */
+    void reset(size_t capacity_per_thread);
+
+    /**
+     * @brief Ring for the calling thread; valid until the next reset()
+     */
+    ParseErrorRing& register_thread(const std::string& parser);
+
+    ParseErrorReport report() const;
+
+    /**
+     * @brief ParseErrorReport::total without copying the errors
+     */
+    uint64_t total() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::deque<ParseErrorRing> rings_;  // Deque: registering never moves existing rings
+    size_t capacity_;
+};
+
+} // namespace logai
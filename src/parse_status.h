@@ -0,0 +1,37 @@
+/**
+ * @file parse_status.h
+ * @brief Outcome of parsing one line, for the non-throwing parser API
+ */
+#pragma once
+#include <cstdint>
+
+namespace logai {
+
+/**
+ * @brief Why a line was or was not turned into a record
+ */
+enum class ParseStatus : uint8_t {
+    Ok,
+    Malformed,     ///< Not in the parser's format: invalid JSON, no regex match, ...
+    InvalidField,  ///< Well-formed, but a field has a value or type the parser cannot use
+    OutOfMemory,   ///< An allocation failed while parsing
+    Error,         ///< Any other failure, e.g. an exception from a parser without a non-throwing path
+};
+
+inline const char* to_string(ParseStatus status) {
+    switch (status) {
+    case ParseStatus::Ok:
+        return "ok";
+    case ParseStatus::Malformed:
+        return "malformed";
+    case ParseStatus::InvalidField:
+        return "invalid_field";
+    case ParseStatus::OutOfMemory:
+        return "out_of_memory";
+    case ParseStatus::Error:
+        break;
+    }
+    return "error";
+}
+
+} // namespace logai
@@ -0,0 +1,205 @@
+#include "pipeline_metrics.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace logai {
+
+namespace {
+
+constexpr uint64_t kSubBuckets = uint64_t{1} << LatencyHistogram::kSubBucketBits;
+
+double seconds(uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / 1e9;
+}
+
+double per_second(uint64_t count, double elapsed_seconds) {
+    return elapsed_seconds > 0.0 ? static_cast<double>(count) / elapsed_seconds : 0.0;
+}
+
+uint64_t bucket_upper_bound(size_t bucket) {
+    return bucket + 1 < LatencyHistogram::kBuckets ? LatencyHistogram::bucket_lower_bound(bucket + 1)
+                                                   : std::numeric_limits<uint64_t>::max();
+}
+
+} // namespace
+
+size_t LatencyHistogram::bucket_of(uint64_t value) {
+    if (value < kSubBuckets) {
+        return static_cast<size_t>(value);
+    }
+    const unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(value));
+    const uint64_t sub_bucket = (value >> (exponent - kSubBucketBits)) & (kSubBuckets - 1);
+    return static_cast<size_t>(((exponent - kSubBucketBits + 1) << kSubBucketBits) + sub_bucket);
+}
+
+uint64_t LatencyHistogram::bucket_lower_bound(size_t bucket) {
+    if (bucket < kSubBuckets) {
+        return bucket;
+    }
+    const unsigned exponent = static_cast<unsigned>(bucket >> kSubBucketBits) + kSubBucketBits - 1;
+    const uint64_t sub_bucket = bucket & (kSubBuckets - 1);
+    return (kSubBuckets + sub_bucket) << (exponent - kSubBucketBits);
+}
+
+void LatencyHistogram::add_to(std::array<uint64_t, kBuckets>& counts) const {
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts[i] += counts_[i].load(std::memory_order_relaxed);
+    }
+}
+
+LatencySummary LatencySummary::from_counts(const std::array<uint64_t, LatencyHistogram::kBuckets>& counts) {
+    LatencySummary summary;
+    double sum_ns = 0.0;
+    size_t highest = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] > 0) {
+            const uint64_t low = LatencyHistogram::bucket_lower_bound(i);
+            sum_ns += static_cast<double>(counts[i]) * (static_cast<double>(low) +
+                      static_cast<double>(bucket_upper_bound(i) - low) / 2.0);
+            summary.count += counts[i];
+            highest = i;
+        }
+    }
+    if (summary.count == 0) {
+        return summary;
+    }
+    summary.mean_us = sum_ns / static_cast<double>(summary.count) / 1e3;
+    summary.max_us = static_cast<double>(bucket_upper_bound(highest)) / 1e3;
+
+    // Percentiles are reported as the midpoint of the bucket they fall in
+    auto percentile = [&](double fraction) {
+        const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(fraction * static_cast<double>(summary.count) + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                const uint64_t low = LatencyHistogram::bucket_lower_bound(i);
+                return (static_cast<double>(low) + static_cast<double>(bucket_upper_bound(i) - low) / 2.0) / 1e3;
+            }
+        }
+        return summary.max_us;
+    };
+    summary.p50_us = percentile(0.50);
+    summary.p90_us = percentile(0.90);
+    summary.p99_us = percentile(0.99);
+    return summary;
+}
+
+void PipelineMetrics::start(uint64_t input_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.clear();
+    started_ = Clock::now();
+    finished_ = started_;
+    running_ = true;
+    input_bytes_ = input_bytes;
+    input_depth_ = 0;
+    input_peak_ = 0;
+    output_depth_ = 0;
+    output_peak_ = 0;
+}
+
+void PipelineMetrics::finish() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    finished_ = Clock::now();
+    running_ = false;
+    input_depth_ = 0;
+    output_depth_ = 0;
+}
+
+ThreadMetrics& PipelineMetrics::register_thread(PipelineStage stage, const std::string& parser) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return threads_.emplace_back(stage, parser);
+}
+
+void PipelineMetrics::set_gauge(std::atomic<size_t>& gauge, std::atomic<size_t>& peak, size_t value) {
+    gauge.store(value, std::memory_order_relaxed);
+    size_t highest = peak.load(std::memory_order_relaxed);
+    while (value > highest && !peak.compare_exchange_weak(highest, value, std::memory_order_relaxed)) {
+    }
+}
+
+double PipelineMetrics::progress() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t bytes_read = 0;
+    for (const auto& thread : threads_) {
+        if (thread.stage == PipelineStage::Read) {
+            bytes_read += thread.bytes.load(std::memory_order_relaxed);
+        }
+    }
+    return progress_locked(bytes_read);
+}
+
+double PipelineMetrics::progress_locked(uint64_t bytes_read) const {
+    if (!running_) {
+        return 1.0;
+    }
+    if (input_bytes_ == 0) {
+        return 0.0;
+    }
+    // Compressed inputs expand and dropped lines are never counted, so stop short of done
+    return std::min(0.99, static_cast<double>(bytes_read) / static_cast<double>(input_bytes_));
+}
+
+PipelineMetricsSnapshot PipelineMetrics::snapshot() const {
+    PipelineMetricsSnapshot snapshot;
+    std::array<uint64_t, LatencyHistogram::kBuckets> parse_counts{};
+    std::array<uint64_t, LatencyHistogram::kBuckets> deliver_counts{};
+    uint64_t worker_busy_ns = 0;
+    uint64_t worker_idle_ns = 0;
+    uint64_t reader_blocked_ns = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        snapshot.running = running_;
+        snapshot.elapsed_seconds = std::chrono::duration<double>((running_ ? Clock::now() : finished_) - started_).count();
+
+        for (const auto& thread : threads_) {
+            const uint64_t lines = thread.lines.load(std::memory_order_relaxed);
+            const uint64_t batches = thread.batches.load(std::memory_order_relaxed);
+            switch (thread.stage) {
+            case PipelineStage::Read:
+                snapshot.bytes_read += thread.bytes.load(std::memory_order_relaxed);
+                snapshot.lines_read += lines;
+                snapshot.batches_read += batches;
+                reader_blocked_ns += thread.idle_ns.load(std::memory_order_relaxed);
+                break;
+            case PipelineStage::Parse: {
+                const uint64_t errors = thread.errors.load(std::memory_order_relaxed);
+                snapshot.lines_parsed += lines;
+                snapshot.batches_parsed += batches;
+                snapshot.parse_errors += errors;
+                snapshot.errors_by_parser[thread.parser] += errors;
+                ++snapshot.workers;
+                worker_busy_ns += thread.busy_ns.load(std::memory_order_relaxed);
+                worker_idle_ns += thread.idle_ns.load(std::memory_order_relaxed);
+                thread.batch_latency.add_to(parse_counts);
+                break;
+            }
+            case PipelineStage::Deliver:
+                snapshot.records_delivered += lines;
+                snapshot.batches_delivered += batches;
+                thread.batch_latency.add_to(deliver_counts);
+                break;
+            }
+        }
+
+        snapshot.progress = progress_locked(snapshot.bytes_read);
+    }
+
+    snapshot.bytes_read_per_second = per_second(snapshot.bytes_read, snapshot.elapsed_seconds);
+    snapshot.lines_read_per_second = per_second(snapshot.lines_read, snapshot.elapsed_seconds);
+    snapshot.lines_parsed_per_second = per_second(snapshot.lines_parsed, snapshot.elapsed_seconds);
+    snapshot.records_delivered_per_second = per_second(snapshot.records_delivered, snapshot.elapsed_seconds);
+    snapshot.input_queue_depth = input_depth_.load(std::memory_order_relaxed);
+    snapshot.input_queue_peak = input_peak_.load(std::memory_order_relaxed);
+    snapshot.output_queue_depth = output_depth_.load(std::memory_order_relaxed);
+    snapshot.output_queue_peak = output_peak_.load(std::memory_order_relaxed);
+    snapshot.worker_busy_seconds = seconds(worker_busy_ns);
+    snapshot.worker_idle_seconds = seconds(worker_idle_ns);
+    snapshot.reader_blocked_seconds = seconds(reader_blocked_ns);
+    snapshot.parse_latency = LatencySummary::from_counts(parse_counts);
+    snapshot.deliver_latency = LatencySummary::from_counts(deliver_counts);
+    return snapshot;
+}
+
+} // namespace logai
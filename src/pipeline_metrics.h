@@ -0,0 +1,191 @@
+/**
+ * @file pipeline_metrics.h
+ * @brief Counters and latency histograms for the stages of a loading pipeline
+ */
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace logai {
+
+/**
+ * @brief Log-linear latency histogram in nanoseconds, in the style of HdrHistogram
+ *
+ * Each power of two is split into 16 linear sub-buckets, so a recorded
+ * value is off by at most 1/16 (about 6%) across the full uint64 range,
+ * in a fixed 8 KB of counters. record() is a relaxed increment; another
+ * thread may read the counts at any time.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned kSubBucketBits = 4;
+    static constexpr size_t kBuckets = (64 - kSubBucketBits + 1) << kSubBucketBits;
+
+    void record(uint64_t nanoseconds) {
+        counts_[bucket_of(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Add this histogram's counts to counts
+     */
+    void add_to(std::array<uint64_t, kBuckets>& counts) const;
+
+    static size_t bucket_of(uint64_t value);
+    static uint64_t bucket_lower_bound(size_t bucket);
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts_{};
+};
+
+/**
+ * @brief Distribution of a latency histogram, in microseconds
+ */
+struct LatencySummary {
+    uint64_t count = 0;
+    double mean_us = 0.0;
+    double p50_us = 0.0;
+    double p90_us = 0.0;
+    double p99_us = 0.0;
+    double max_us = 0.0;  ///< Upper bound of the highest non-empty bucket
+
+    static LatencySummary from_counts(const std::array<uint64_t, LatencyHistogram::kBuckets>& counts);
+};
+
+/**
+ * @brief Stages of the batch pipeline
+ */
+enum class PipelineStage {
+    Read,     ///< Producer: reads lines and forms batches
+    Parse,    ///< Worker: parses batches into records
+    Deliver,  ///< Consumer: hands records to the caller
+};
+
+/**
+ * @brief Counters owned by one pipeline thread
+ *
+ * Only the owning thread writes, once per batch, with relaxed atomics on
+ * its own cache lines, so counting never contends with other threads.
+ * Readers may load any field at any time.
+ */
+struct alignas(64) ThreadMetrics {
+    ThreadMetrics(PipelineStage stage, std::string parser) : stage(stage), parser(std::move(parser)) {}
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t n) { counter.fetch_add(n, std::memory_order_relaxed); }
+
+    const PipelineStage stage;
+    const std::string parser;  ///< Parser a worker runs, empty for other stages
+
+    std::atomic<uint64_t> bytes{0};    ///< Read: bytes of the lines read
+    std::atomic<uint64_t> lines{0};    ///< Lines read, parsed or delivered (as records), by stage
+    std::atomic<uint64_t> batches{0};  ///< Batches formed, parsed or delivered, by stage
+    std::atomic<uint64_t> errors{0};   ///< Parse: lines the parser rejected
+    std::atomic<uint64_t> busy_ns{0};  ///< Time spent on batches
+    std::atomic<uint64_t> idle_ns{0};  ///< Time spent waiting for a batch (Parse) or for memory (Read)
+    LatencyHistogram batch_latency;    ///< Time per batch: parsing (Parse) or the caller's callback (Deliver)
+};
+
+/**
+ * @brief Point-in-time view of a pipeline, see PipelineMetrics::snapshot()
+ *
+ * Rates are averages since the run started.
+ */
+struct PipelineMetricsSnapshot {
+    bool running = false;
+    double elapsed_seconds = 0.0;
+    double progress = 0.0;  ///< Fraction of the input read, 1 once the run is finished
+
+    uint64_t bytes_read = 0;
+    uint64_t lines_read = 0;
+    uint64_t batches_read = 0;
+    uint64_t lines_parsed = 0;
+    uint64_t batches_parsed = 0;
+    uint64_t parse_errors = 0;
+    uint64_t records_delivered = 0;
+    uint64_t batches_delivered = 0;
+
+    double bytes_read_per_second = 0.0;
+    double lines_read_per_second = 0.0;
+    double lines_parsed_per_second = 0.0;
+    double records_delivered_per_second = 0.0;
+
+    size_t input_queue_depth = 0;   ///< Batches waiting for a worker
+    size_t input_queue_peak = 0;
+    size_t output_queue_depth = 0;  ///< Parsed batches waiting for delivery
+    size_t output_queue_peak = 0;
+
+    size_t workers = 0;
+    double worker_busy_seconds = 0.0;  ///< Summed over workers
+    double worker_idle_seconds = 0.0;  ///< Summed over workers
+    double reader_blocked_seconds = 0.0;  ///< Reader waiting on the memory budget
+
+    LatencySummary parse_latency;    ///< Per batch
+    LatencySummary deliver_latency;  ///< Per batch, time in the caller's callback
+    std::map<std::string, uint64_t> errors_by_parser;
+};
+
+/**
+ * @brief Live metrics of one loader's pipeline runs
+ *
+ * Each pipeline thread registers once and then counts into its own
+ * ThreadMetrics. snapshot() sums the threads on demand, so it can be
+ * polled from any thread while a run is in progress without slowing it.
+ */
+class PipelineMetrics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Forget the previous run and start timing a new one
+     * @param input_bytes Size of the input for progress, 0 if unknown
+     */
+    void start(uint64_t input_bytes);
+
+    /**
+     * @brief Mark the run finished; elapsed time and rates stop moving
+     */
+    void finish();
+
+    /**
+     * @brief Counters for the calling thread; valid until the next start()
+     */
+    ThreadMetrics& register_thread(PipelineStage stage, const std::string& parser = "");
+
+    void set_input_queue_depth(size_t depth) { set_gauge(input_depth_, input_peak_, depth); }
+    void set_output_queue_depth(size_t depth) { set_gauge(output_depth_, output_peak_, depth); }
+
+    PipelineMetricsSnapshot snapshot() const;
+
+    /**
+     * @brief PipelineMetricsSnapshot::progress without building the rest of the snapshot
+     */
+    double progress() const;
+
+    static uint64_t nanoseconds_since(Clock::time_point start) {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+    }
+
+private:
+    static void set_gauge(std::atomic<size_t>& gauge, std::atomic<size_t>& peak, size_t value);
+    double progress_locked(uint64_t bytes_read) const;
+
+    mutable std::mutex mutex_;
+    std::deque<ThreadMetrics> threads_;  // Deque: registering never moves existing entries
+    Clock::time_point started_ = Clock::now();
+    Clock::time_point finished_ = started_;
+    bool running_ = false;
+    uint64_t input_bytes_ = 0;
+    std::atomic<size_t> input_depth_{0};
+    std::atomic<size_t> input_peak_{0};
+    std::atomic<size_t> output_depth_{0};
+    std::atomic<size_t> output_peak_{0};
+};
+
+} // namespace logai
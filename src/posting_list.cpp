@@ -0,0 +1,101 @@
+#include "posting_list.h"
+
+namespace logai {
+
+namespace {
+
+uint8_t bits_needed(uint32_t value) {
+    uint8_t bits = 0;
+    while (value != 0) {
+        ++bits;
+        value >>= 1;
+    }
+    return bits;
+}
+
+} // namespace
+
+void PostingList::add(uint32_t row_id) {
+    if (size_ > 0 && row_id <= last_row_) {
+        return;
+    }
+    tail_.push_back(row_id);
+    last_row_ = row_id;
+    ++size_;
+    if (tail_.size() == kBlockSize) {
+        freeze_tail();
+    }
+}
+
+void PostingList::freeze_tail() {
+    // Gaps between ascending distinct rows are >= 1, pack gap - 1
+    uint32_t max_gap = 0;
+    for (size_t i = 1; i < tail_.size(); ++i) {
+        max_gap |= tail_[i] - tail_[i - 1] - 1;
+    }
+
+    Block block;
+    block.first_row = tail_.front();
+    block.word_offset = static_cast<uint32_t>(words_.size());
+    block.bit_width = bits_needed(max_gap);
+
+    if (block.bit_width > 0) {
+        const size_t total_bits = (tail_.size() - 1) * block.bit_width;
+        words_.resize(words_.size() + (total_bits + 31) / 32, 0);
+        uint32_t* packed = words_.data() + block.word_offset;
+        size_t bit = 0;
+        for (size_t i = 1; i < tail_.size(); ++i, bit += block.bit_width) {
+            const uint64_t gap = tail_[i] - tail_[i - 1] - 1;
+            const size_t word = bit / 32;
+            const size_t shift = bit % 32;
+            packed[word] |= static_cast<uint32_t>(gap << shift);
+            if (shift + block.bit_width > 32) {
+                packed[word + 1] |= static_cast<uint32_t>(gap >> (32 - shift));
+            }
+        }
+    }
+
+    blocks_.push_back(block);
+    tail_.clear();
+}
+
+void PostingList::decode(std::vector<uint32_t>& out) const {
+    out.reserve(out.size() + size_);
+    for (const Block& block : blocks_) {
+        uint32_t row = block.first_row;
+        out.push_back(row);
+        if (block.bit_width == 0) {
+            for (size_t i = 1; i < kBlockSize; ++i) {
+                out.push_back(++row);
+            }
+            continue;
+        }
+        const uint32_t* packed = words_.data() + block.word_offset;
+        const uint64_t mask = (uint64_t{1} << block.bit_width) - 1;
+        size_t bit = 0;
+        for (size_t i = 1; i < kBlockSize; ++i, bit += block.bit_width) {
+            const size_t word = bit / 32;
+            const size_t shift = bit % 32;
+            uint64_t value = packed[word] >> shift;
+            if (shift + block.bit_width > 32) {
+                value |= static_cast<uint64_t>(packed[word + 1]) << (32 - shift);
+            }
+            row += static_cast<uint32_t>(value & mask) + 1;
+            out.push_back(row);
+        }
+    }
+    out.insert(out.end(), tail_.begin(), tail_.end());
+}
+
+std::vector<uint32_t> PostingList::decode() const {
+    std::vector<uint32_t> rows;
+    decode(rows);
+    return rows;
+}
+
+size_t PostingList::memory_usage() const {
+    return blocks_.capacity() * sizeof(Block) + words_.capacity() * sizeof(uint32_t) +
+           tail_.capacity() * sizeof(uint32_t);
+}
+
+} // namespace logai
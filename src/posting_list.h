@@ -0,0 +1,66 @@
+/**
+ * @file posting_list.h
+ * @brief Compressed, append-only list of ascending row IDs
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace logai {
+
+/**
+ * @brief Ascending row IDs stored as bit-packed deltas
+ *
+ * Rows are appended in ascending order into an uncompressed tail. Every
+ * kBlockSize rows the tail is frozen into a block: the first row is kept
+ * as is and the remaining gaps are packed at the bit width of the largest
+ * gap. Dense lists cost about one bit per row, sparse ones a few bytes.
+ */
+class PostingList {
+public:
+    static constexpr size_t kBlockSize = 128;
+
+    /**
+     * @brief Append a row ID
+     *
+     * @param row_id Must not be smaller than the last appended ID; repeats are ignored
+     */
+    void add(uint32_t row_id);
+
+    /**
+     * @brief Number of distinct row IDs
+     */
+    size_t size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * @brief Decode into an ascending vector (appended to out)
+     */
+    void decode(std::vector<uint32_t>& out) const;
+
+    std::vector<uint32_t> decode() const;
+
+    /**
+     * @brief Approximate heap bytes used
+     */
+    size_t memory_usage() const;
+
+private:
+    struct Block {
+        uint32_t first_row;  // First row of the block, stored uncompressed
+        uint32_t word_offset;  // Start of the packed gaps in words_
+        uint8_t bit_width;  // Bits per packed gap (gap - 1)
+    };
+
+    void freeze_tail();
+
+    std::vector<Block> blocks_;
+    std::vector<uint32_t> words_;  // Packed gaps of all blocks
+    std::vector<uint32_t> tail_;   // Rows not yet frozen into a block
+    uint32_t size_ = 0;
+    uint32_t last_row_ = 0;
+};
+
+} // namespace logai
@@ -5,7 +5,17 @@
 #include "file_data_loader.h"
 #include "log_parser.h"
 #include "gemini_vectorizer.h"
+#include "ingest_checkpoint.h"
+#include "inverted_index.h"
+#include "segment_store.h"
+#include "template_anomaly_detector.h"
+#include "template_time_series.h"
+#include "timestamp_utils.h"
 #include <curl/curl.h>
+#include <algorithm>
+#include <ctime>
+#include <exception>
+#include <filesystem>
 #include <sstream>
 #include <vector>
 #include <string>
@@ -16,6 +26,158 @@ using json = nlohmann::json;
 
 // Global objects to maintain state between calls
 static std::unique_ptr<logai::GeminiVectorizer> g_vectorizer;
+static std::shared_ptr<logai::DrainParser> g_template_parser;  // DRAIN model of the last "drain" load
+static std::shared_ptr<logai::TemplateTimeSeries> g_time_series;  // Per-template counts of the last "drain" load
+static std::shared_ptr<logai::TemplateAnomalyDetector> g_anomaly_detector;  // Template anomalies of the last "drain" load
+static std::shared_ptr<logai::InvertedIndex> g_log_index;  // Token/template index of the last load, rows in load order
+static std::string g_segment_store_root;  // Segment stores are kept per source below this directory, empty = disabled
+static std::shared_ptr<logai::SegmentStore> g_segment_store;  // Segment store of the last load
+static bool g_segment_store_reused = false;  // Last load found a complete store for an unchanged source
+static std::string g_loaded_source;  // Absolute path the state above was built from by parse_log_file, empty if none
+static logai::IngestCheckpoint g_checkpoint;  // How far g_loaded_source has been parsed
+static logai::IncrementalParseResult g_last_ingest;  // Outcome of the last parse_log_file (records not kept)
+static std::shared_ptr<const logai::PipelineMetrics> g_pipeline_metrics;  // Pipeline of the current or last large-file load
+static std::shared_ptr<const logai::ParseErrorSink> g_parse_errors;  // Parse errors of the same load
+static std::shared_ptr<const logai::FieldSchema> g_field_schema;  // Field keys and value dictionaries of the last load
+static constexpr const char* kCheckpointFile = "checkpoint.json";
+
+// Convert a parsed record to a Python dictionary
+static py::dict record_to_dict(const logai::LogRecordObject& record) {
+    py::dict record_dict;
+    record_dict["body"] = record.body;
+    record_dict["template"] = record.template_str;
+    record_dict["level"] = record.level;
+    record_dict["message"] = record.message;
+
+    // Convert timestamp if present
+    if (record.timestamp) {
+        auto time_t = std::chrono::system_clock::to_time_t(*record.timestamp);
+        std::stringstream ss;
+        ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+        record_dict["timestamp"] = ss.str();
+    } else {
+        record_dict["timestamp"] = py::none();
+    }
+
+    // Convert severity if present
+    record_dict["severity"] = record.severity ? py::cast(*record.severity) : py::none();
+
+    // Convert fields
+    py::dict fields_dict;
+    for (const auto& [key, value] : record.fields) {
+        fields_dict[py::str(std::string(key))] = py::str(value.c_str());
+    }
+    record_dict["fields"] = fields_dict;
+
+    // Codes of the dictionary-encoded fields, indexes into get_field_dictionaries()
+    py::dict codes_dict;
+    for (logai::FieldSchema::Id id = 0; id < logai::FieldSchema::kEncodedEnd; ++id) {
+        if (auto code = record.fields.code(id)) {
+            codes_dict[py::str(std::string(record.fields.schema()->name(id)))] = *code;
+        }
+    }
+    record_dict["field_codes"] = codes_dict;
+
+    // DRAIN records carry their template ID as the cluster_id field
+    if (const auto* cluster_id = record.fields.find(logai::FieldSchema::kClusterId)) {
+        record_dict["template_id"] = py::str(cluster_id->c_str());
+    }
+
+    return record_dict;
+}
+
+// Configure a loader config for the requested format
+static logai::FileDataLoaderConfig make_loader_config(const std::string& format) {
+    logai::FileDataLoaderConfig config;
+    config.format = format.empty() ? "logfmt" : format;
+    config.encoding = "utf-8";
+    if (config.format == "drain") {
+        config.log_type = "drain";
+    }
+    return config;
+}
+
+// Remember the DRAIN model of a loader and attach a fresh time series to it
+static void track_template_parser(logai::FileDataLoader& loader, const logai::FileDataLoaderConfig& config) {
+    if (config.log_type != "drain") {
+        g_template_parser = nullptr;
+        g_time_series = nullptr;
+        g_anomaly_detector = nullptr;
+        return;
+    }
+    g_template_parser = loader.template_parser();
+    g_time_series = std::make_shared<logai::TemplateTimeSeries>();
+    g_template_parser->set_time_series(g_time_series);
+    g_anomaly_detector = std::make_shared<logai::TemplateAnomalyDetector>();
+}
+
+// Identity of a source file: path, size and modification time
+static std::string source_tag(const std::filesystem::path& path) {
+    return path.string() + "|" + std::to_string(std::filesystem::file_size(path)) + "|" +
+           std::to_string(std::filesystem::last_write_time(path).time_since_epoch().count());
+}
+
+// Directory holding the segment store and checkpoint of a source, empty if stores are disabled
+static std::filesystem::path source_state_dir(const std::filesystem::path& source) {
+    if (g_segment_store_root.empty()) {
+        return {};
+    }
+    std::stringstream dir_name;
+    dir_name << std::hex << std::hash<std::string>{}(source.string());
+    return std::filesystem::path(g_segment_store_root) / dir_name.str();
+}
+
+// Open the segment store of a source; returns true if it already holds a complete ingest of it.
+// Unless keep_rows is set, a store that does not match the source is emptied and its checkpoint dropped.
+static bool open_segment_store(const std::string& file_path, bool keep_rows = false) {
+    g_segment_store = nullptr;
+    g_segment_store_reused = false;
+    const auto source = std::filesystem::absolute(file_path);
+    const auto state_dir = source_state_dir(source);
+    if (state_dir.empty()) {
+        return false;
+    }
+
+    logai::SegmentStoreConfig store_config;
+    store_config.directory = state_dir.string();
+    g_segment_store = std::make_shared<logai::SegmentStore>(store_config);
+    if (g_segment_store->completed_source() == source_tag(source)) {
+        g_segment_store_reused = true;
+        return true;
+    }
+    if (!keep_rows) {
+        g_segment_store->reset();
+        std::error_code ec;
+        std::filesystem::remove(state_dir / kCheckpointFile, ec);
+    }
+    return false;
+}
+
+// Seal the segment store of a source after a successful load
+static void complete_segment_store(const std::string& file_path) {
+    if (g_segment_store && !g_segment_store_reused) {
+        g_segment_store->mark_complete(source_tag(std::filesystem::absolute(file_path)));
+    }
+}
+
+// Parse a user-supplied time (same local-time convention as record_to_dict) to epoch milliseconds
+static std::optional<int64_t> parse_local_time_ms(const std::string& text) {
+    auto utc_ms = logai::parse_epoch_millis(text);
+    if (!utc_ms && text.size() == 10) {
+        utc_ms = logai::parse_epoch_millis(text + " 00:00:00");  // Date only
+    }
+    if (!utc_ms) {
+        return std::nullopt;
+    }
+    // An explicit offset or 'Z' after "YYYY-MM-DD HH:MM:SS" makes the time absolute
+    if (text.find_first_of("Z+", 19) != std::string::npos || text.find('-', 19) != std::string::npos) {
+        return utc_ms;
+    }
+    std::time_t seconds = static_cast<std::time_t>(*utc_ms / 1000);
+    std::tm civil = *std::gmtime(&seconds);
+    civil.tm_isdst = -1;
+    return static_cast<int64_t>(std::mktime(&civil)) * 1000 + *utc_ms % 1000;
+}
 
 // Helper function for HTTP requests
 static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp) {
@@ -46,120 +208,292 @@ std::vector<float> generate_template_embedding(const std::string& template_text)
     }
 }
 
-// Function to parse a log file and return parsed records
-py::list parse_log_file(const std::string& file_path, const std::string& format = "") {
+// Rebuild the token/template index of a source from its segment store
+static std::shared_ptr<logai::InvertedIndex> index_from_segment_store(const logai::SegmentStore& store) {
+    auto index = std::make_shared<logai::InvertedIndex>();
+    auto rows = store.query(logai::SegmentQuery());
+    for (auto it = rows.rbegin(); it != rows.rend(); ++it) {
+        index->add(static_cast<uint32_t>(it->row_id), it->template_id, it->message);
+    }
+    return index;
+}
+
+// Checkpoint of a source: the in-memory one if its state is loaded, else the one stored with its segments
+static logai::IngestCheckpoint checkpoint_for(const std::string& source) {
+    if (source == g_loaded_source) {
+        return g_checkpoint;
+    }
+    const auto state_dir = source_state_dir(source);
+    if (!state_dir.empty()) {
+        auto stored = logai::load_ingest_checkpoint((state_dir / kCheckpointFile).string());
+        // Rows written after the checkpoint by an interrupted run would be stored twice
+        logai::SegmentStoreConfig store_config;
+        store_config.directory = state_dir.string();
+        if (stored && logai::SegmentStore(store_config).row_count() == stored->records) {
+            return *stored;
+        }
+    }
+    return logai::IngestCheckpoint();
+}
+
+// Function to parse a log file and return parsed records.
+// A file parsed before is continued from its checkpoint and only the appended records are returned;
+// get_ingest_state() tells which happened.
+py::list parse_log_file(const std::string& file_path, const std::string& format = "", bool resume = true) {
     try {
         // Create file data loader with appropriate configuration
-        logai::FileDataLoaderConfig config;
-        config.format = format.empty() ? "logfmt" : format;
-        config.encoding = "utf-8";
-        
+        auto config = make_loader_config(format);
         logai::FileDataLoader loader(file_path, config);
+        const std::string source = std::filesystem::absolute(file_path).string();
         
-        // Parse the log file and get records
-        auto records = loader.parse_log_file(file_path, config.format);
+        logai::IngestCheckpoint checkpoint;
+        const bool continues_loaded = resume && source == g_loaded_source;
+        if (resume) {
+            checkpoint = checkpoint_for(source);
+        }
+        // Cluster IDs of a DRAIN checkpoint only mean something in the model that produced them, and
+        // models are not persisted: without this process's model of the source, parse it in full
+        const bool continues_model = continues_loaded && config.log_type == "drain" && g_template_parser;
+        if (config.log_type == "drain" && !continues_model) {
+            checkpoint = logai::IngestCheckpoint();
+        }
+        if (continues_model) {
+            loader.set_template_parser(g_template_parser);
+        }
+        const bool resumable = loader.can_resume(file_path, checkpoint);
+        if (continues_model && !resumable) {
+            // A full parse must not add to the old model's cluster statistics and time series
+            loader.set_template_parser(nullptr);
+        }
+        if (!continues_model || !resumable) {
+            track_template_parser(loader, config);
+        }
+        
+        // Parse the log file from the checkpoint, or in full if it no longer applies
+        g_last_ingest = loader.parse_log_file_incremental(file_path, config.format, checkpoint);
+        auto records = std::move(g_last_ingest.records);
+        g_last_ingest.records.clear();
+        // The last interval stays open: a later load of the same file may add to its counts
+        if (g_anomaly_detector) {
+            g_anomaly_detector->observe_batch(records);
+        }
+        
+        // Row IDs count from the start of the file, new rows extend the state of the earlier load
+        if (!g_last_ingest.resumed) {
+            g_log_index = std::make_shared<logai::InvertedIndex>();
+            open_segment_store(file_path);
+        } else if (!continues_loaded) {
+            open_segment_store(file_path, true);
+            g_log_index = g_segment_store ? index_from_segment_store(*g_segment_store)
+                                          : std::make_shared<logai::InvertedIndex>();
+        }
+        if (g_last_ingest.resumed) {
+            g_segment_store_reused = false;  // The source grew, the store takes the new rows
+        }
+        g_log_index->add_batch(static_cast<uint32_t>(g_last_ingest.first_record), records);
+        if (g_segment_store && !g_segment_store_reused) {
+            g_segment_store->append(g_last_ingest.first_record, records);
+            complete_segment_store(file_path);
+        }
+        const auto state_dir = source_state_dir(source);
+        if (!state_dir.empty()) {
+            logai::save_ingest_checkpoint((state_dir / kCheckpointFile).string(), checkpoint);
+        }
+        g_loaded_source = source;
+        g_checkpoint = checkpoint;
+        g_field_schema = loader.field_schema();
         
         // Convert to Python list of dictionaries
         py::list result;
         for (const auto& record : records) {
-            py::dict record_dict;
-            record_dict["body"] = record.body;
-            record_dict["template"] = record.template_str;
-            record_dict["level"] = record.level;
-            record_dict["message"] = record.message;
-            
-            // Convert timestamp if present
-            if (record.timestamp) {
-                auto time_t = std::chrono::system_clock::to_time_t(*record.timestamp);
-                std::stringstream ss;
-                ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-                record_dict["timestamp"] = ss.str();
-            } else {
-                record_dict["timestamp"] = py::none();
-            }
-            
-            // Convert severity if present
-            record_dict["severity"] = record.severity ? py::cast(*record.severity) : py::none();
-            
-            // Convert fields
-            py::dict fields_dict;
-            for (const auto& [key, value] : record.fields) {
-                fields_dict[py::str(key.c_str())] = py::str(value.c_str());
-            }
-            record_dict["fields"] = fields_dict;
-            
-            result.append(record_dict);
+            result.append(record_to_dict(record));
         }
         
         return result;
     } catch (const std::exception& e) {
+        g_loaded_source.clear();
         py::print("Error parsing log file:", e.what());
         return py::list();
     }
 }
 
+// Outcome of the last parse_log_file: whether it continued an earlier load and which rows it returned
+py::dict get_ingest_state() {
+    py::dict state;
+    state["source"] = g_loaded_source;
+    state["resumed"] = g_last_ingest.resumed;
+    state["first_row"] = g_last_ingest.first_record;
+    state["rows"] = g_checkpoint.records;
+    state["offset"] = g_checkpoint.offset;
+    state["file_size"] = g_checkpoint.file_size;
+    return state;
+}
+
 // Process large log file with callback to Python
 bool process_large_file_with_callback(const std::string& file_path, const std::string& format, py::function callback, int chunk_size = 10000) {
     try {
         // Create file data loader with appropriate configuration
-        logai::FileDataLoaderConfig config;
-        config.format = format.empty() ? "logfmt" : format;
-        config.encoding = "utf-8";
-        
+        auto config = make_loader_config(format);
         logai::FileDataLoader loader(file_path, config);
+        track_template_parser(loader, config);
+        g_loaded_source.clear();
+        g_pipeline_metrics = loader.metrics();
+        g_parse_errors = loader.parse_error_sink();
+        g_field_schema = loader.field_schema();  // Dictionaries grow as batches arrive
         
         // Create a C++ callback that calls the Python function
-        auto cpp_callback = [&callback](const std::vector<logai::LogRecordObject>& batch) {
-            // Convert batch to a Python list
-            py::list py_batch;
+        auto detector = g_anomaly_detector;
+        auto index = std::make_shared<logai::InvertedIndex>();
+        g_log_index = index;
+        auto store = open_segment_store(file_path) ? nullptr : g_segment_store;
+        uint32_t next_row_id = 0;
+        std::exception_ptr callback_error;  // Raised by the Python callback, rethrown on this thread
+        auto cpp_callback = [&callback, &detector, &index, &store, &next_row_id, &callback_error](const std::vector<logai::LogRecordObject>& batch) {
+            // Score template counts incrementally as batches arrive
+            if (detector) {
+                detector->observe_batch(batch);
+            }
             
-            for (const auto& record : batch) {
-                py::dict record_dict;
-                record_dict["body"] = record.body;
-                record_dict["template"] = record.template_str;
-                record_dict["level"] = record.level;
-                record_dict["message"] = record.message;
-                
-                // Convert timestamp if present
-                if (record.timestamp) {
-                    auto time_t = std::chrono::system_clock::to_time_t(*record.timestamp);
-                    std::stringstream ss;
-                    ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
-                    record_dict["timestamp"] = ss.str();
-                } else {
-                    record_dict["timestamp"] = py::none();
-                }
-                
-                // Convert severity if present
-                record_dict["severity"] = record.severity ? py::cast(*record.severity) : py::none();
-                
-                // Convert fields
-                py::dict fields_dict;
-                for (const auto& [key, value] : record.fields) {
-                    fields_dict[py::str(key.c_str())] = py::str(value.c_str());
-                }
-                record_dict["fields"] = fields_dict;
-                
-                py_batch.append(record_dict);
+            // Batches arrive in file order, rows are numbered across batches
+            index->add_batch(next_row_id, batch);
+            if (store) {
+                store->append(next_row_id, batch);
             }
+            next_row_id += static_cast<uint32_t>(batch.size());
             
-            // Call the Python function
-            callback(py_batch);
+            // Only the conversion and the Python call need the interpreter
+            py::gil_scoped_acquire gil;
+            if (callback_error) {
+                return;  // The load is stopping, Python gets no further batches
+            }
+            py::list py_batch;
+            for (const auto& record : batch) {
+                py_batch.append(record_to_dict(record));
+            }
+            try {
+                callback(py_batch);
+            } catch (py::error_already_set&) {
+                // Must not escape the pipeline thread; stopping the pipeline makes the load fail
+                callback_error = std::current_exception();
+                throw std::runtime_error("Python callback raised an exception");
+            }
         };
         
-        // Process the file
-        return loader.process_large_file_with_callback(
-            file_path,
-            config.format,
-            chunk_size,
-            cpp_callback
-        );
+        // Process the file without holding the GIL, so other Python threads (e.g. one polling
+        // get_pipeline_metrics()) run while batches are parsed, indexed and stored
+        bool success;
+        {
+            py::gil_scoped_release release;
+            success = loader.process_large_file_with_callback(
+                file_path,
+                config.format,
+                chunk_size,
+                cpp_callback
+            );
+        }
+        if (detector) {
+            detector->flush();
+        }
+        if (success) {
+            complete_segment_store(file_path);
+        } else if (store) {
+            store->flush();
+        }
+        if (callback_error) {
+            std::rethrow_exception(callback_error);
+        }
+        return success;
+    } catch (const py::error_already_set&) {
+        throw;  // The callback's exception, raised again in the caller
     } catch (const std::exception& e) {
         py::print("Error processing log file:", e.what());
         return false;
     }
 }
 
+static py::dict latency_to_dict(const logai::LatencySummary& latency) {
+    py::dict result;
+    result["count"] = latency.count;
+    result["mean_us"] = latency.mean_us;
+    result["p50_us"] = latency.p50_us;
+    result["p90_us"] = latency.p90_us;
+    result["p99_us"] = latency.p99_us;
+    result["max_us"] = latency.max_us;
+    return result;
+}
+
+// Throughput, latencies, queue depths and errors of the current or last process_large_file_with_callback,
+// e.g. polled from its batch callback
+py::dict get_pipeline_metrics() {
+    py::dict result;
+    auto metrics = g_pipeline_metrics ? g_pipeline_metrics->snapshot() : logai::PipelineMetricsSnapshot();
+    result["running"] = metrics.running;
+    result["elapsed_seconds"] = metrics.elapsed_seconds;
+    result["progress"] = metrics.progress;
+    result["bytes_read"] = metrics.bytes_read;
+    result["lines_read"] = metrics.lines_read;
+    result["batches_read"] = metrics.batches_read;
+    result["lines_parsed"] = metrics.lines_parsed;
+    result["batches_parsed"] = metrics.batches_parsed;
+    result["parse_errors"] = metrics.parse_errors;
+    result["records_delivered"] = metrics.records_delivered;
+    result["batches_delivered"] = metrics.batches_delivered;
+    result["bytes_read_per_second"] = metrics.bytes_read_per_second;
+    result["lines_read_per_second"] = metrics.lines_read_per_second;
+    result["lines_parsed_per_second"] = metrics.lines_parsed_per_second;
+    result["records_delivered_per_second"] = metrics.records_delivered_per_second;
+    result["input_queue_depth"] = metrics.input_queue_depth;
+    result["input_queue_peak"] = metrics.input_queue_peak;
+    result["output_queue_depth"] = metrics.output_queue_depth;
+    result["output_queue_peak"] = metrics.output_queue_peak;
+    result["workers"] = metrics.workers;
+    result["worker_busy_seconds"] = metrics.worker_busy_seconds;
+    result["worker_idle_seconds"] = metrics.worker_idle_seconds;
+    result["reader_blocked_seconds"] = metrics.reader_blocked_seconds;
+    result["parse_latency"] = latency_to_dict(metrics.parse_latency);
+    result["deliver_latency"] = latency_to_dict(metrics.deliver_latency);
+    result["errors_by_parser"] = metrics.errors_by_parser;
+    return result;
+}
+
+// Lines the current or last process_large_file_with_callback failed to parse, the most recent ones per worker
+py::dict get_parse_errors() {
+    py::dict result;
+    auto report = g_parse_errors ? g_parse_errors->report() : logai::ParseErrorReport();
+    py::list errors;
+    for (const auto& error : report.errors) {
+        py::dict entry;
+        entry["line"] = error.line;
+        entry["offset"] = error.offset;
+        entry["parser"] = error.parser;
+        entry["code"] = logai::to_string(error.code);
+        errors.append(entry);
+    }
+    result["errors"] = errors;
+    result["total"] = report.total;
+    result["dropped"] = report.dropped;
+    return result;
+}
+
+// Value dictionaries of the last load: field name -> values, indexed by the codes in each record's field_codes
+py::dict get_field_dictionaries() {
+    py::dict result;
+    if (!g_field_schema) {
+        return result;
+    }
+    for (logai::FieldSchema::Id id = 0; id < logai::FieldSchema::kEncodedEnd; ++id) {
+        const auto& dictionary = g_field_schema->dictionary(id);
+        py::list values;
+        const size_t size = dictionary.size();
+        for (logai::ValueDictionary::Code code = 0; code < size; ++code) {
+            const auto& value = dictionary.decode(code);
+            values.append(py::str(value.data(), value.size()));
+        }
+        result[py::str(std::string(g_field_schema->name(id)))] = values;
+    }
+    return result;
+}
+
 // Extract attributes from log lines
 py::dict extract_attributes(const std::vector<std::string>& log_lines, const std::map<std::string, std::string>& patterns) {
     try {
@@ -190,17 +524,252 @@ py::dict extract_attributes(const std::vector<std::string>& log_lines, const std
     }
 }
 
+// Template statistics of the last DRAIN load as a columnar table
+py::dict get_template_stats() {
+    py::dict table;
+    py::list ids, templates, counts, first_seen, last_seen;
+    std::vector<py::list> level_columns(logai::kLogLevelCount);
+
+    if (g_template_parser) {
+        for (const auto& row : g_template_parser->get_template_stats()) {
+            ids.append(row.cluster_id);
+            templates.append(row.template_str);
+            counts.append(row.count);
+            first_seen.append(row.first_seen_ms);
+            last_seen.append(row.last_seen_ms);
+            for (size_t i = 0; i < logai::kLogLevelCount; ++i) {
+                level_columns[i].append(row.level_counts[i]);
+            }
+        }
+    }
+
+    table["template_id"] = ids;
+    table["template"] = templates;
+    table["count"] = counts;
+    table["first_seen_ms"] = first_seen;
+    table["last_seen_ms"] = last_seen;
+    for (size_t i = 0; i < logai::kLogLevelCount; ++i) {
+        std::string column = "count_" + std::string(logai::log_level_name(static_cast<logai::LogLevel>(i)));
+        std::transform(column.begin(), column.end(), column.begin(), ::tolower);
+        table[py::str(column)] = level_columns[i];
+    }
+    return table;
+}
+
+// All templates of the last DRAIN load, keyed by template ID
+py::dict get_all_templates() {
+    py::dict result;
+    if (g_template_parser) {
+        for (const auto& [id, tmpl] : g_template_parser->get_all_templates()) {
+            result[py::int_(id)] = py::str(tmpl);
+        }
+    }
+    return result;
+}
+
+// Templates whose rate changed the most between the last two windows, as columns
+py::dict get_trending_templates(double window_seconds = 300.0, size_t k = 5) {
+    py::dict table;
+    py::list ids, templates, current, previous, current_rate, previous_rate, change;
+
+    if (g_time_series && g_template_parser) {
+        auto window_ms = static_cast<int64_t>(window_seconds * 1000.0);
+        for (const auto& trend : g_time_series->top_k_rate_change(window_ms, k)) {
+            ids.append(trend.cluster_id);
+            templates.append(g_template_parser->get_template_for_cluster_id(trend.cluster_id).value_or(""));
+            current.append(trend.current_count);
+            previous.append(trend.previous_count);
+            current_rate.append(trend.current_rate);
+            previous_rate.append(trend.previous_rate);
+            change.append(trend.relative_change);
+        }
+    }
+
+    table["template_id"] = ids;
+    table["template"] = templates;
+    table["current_count"] = current;
+    table["previous_count"] = previous;
+    table["current_rate"] = current_rate;
+    table["previous_rate"] = previous_rate;
+    table["relative_change"] = change;
+    return table;
+}
+
+// Template anomalies of the last DRAIN load as a columnar table
+py::dict get_template_anomalies() {
+    py::dict table;
+    py::list types, ids, templates, interval_start, observed, expected, score;
+
+    if (g_anomaly_detector && g_template_parser) {
+        for (const auto& anomaly : g_anomaly_detector->anomalies()) {
+            types.append(logai::anomaly_type_name(anomaly.type));
+            ids.append(anomaly.cluster_id);
+            templates.append(g_template_parser->get_template_for_cluster_id(anomaly.cluster_id).value_or(""));
+            interval_start.append(anomaly.interval_start_ms);
+            observed.append(anomaly.observed);
+            expected.append(anomaly.expected);
+            score.append(anomaly.score);
+        }
+    }
+
+    table["type"] = types;
+    table["template_id"] = ids;
+    table["template"] = templates;
+    table["interval_start_ms"] = interval_start;
+    table["observed"] = observed;
+    table["expected"] = expected;
+    table["score"] = score;
+    return table;
+}
+
+// Row IDs of the last load matching an index query, most recent first
+std::vector<uint32_t> search_log_index(const std::string& query, size_t limit = 0) {
+    if (!g_log_index) {
+        return {};
+    }
+    auto rows = g_log_index->search(query);
+    std::reverse(rows.begin(), rows.end());
+    if (limit > 0 && rows.size() > limit) {
+        rows.resize(limit);
+    }
+    return rows;
+}
+
+// Number of rows of the last load matching an index query
+size_t count_log_index(const std::string& query) {
+    return g_log_index ? g_log_index->count(query) : 0;
+}
+
+// Size of the index of the last load
+py::dict get_log_index_stats() {
+    py::dict stats;
+    auto index_stats = g_log_index ? g_log_index->stats() : logai::InvertedIndexStats();
+    stats["rows"] = index_stats.rows;
+    stats["tokens"] = index_stats.tokens;
+    stats["templates"] = index_stats.templates;
+    stats["memory_bytes"] = index_stats.memory_bytes;
+    return stats;
+}
+
+// Keep segment stores of loaded files below a directory so later loads can reuse them
+void set_segment_store_root(const std::string& directory) {
+    g_segment_store_root = directory;
+}
+
+// Rows of the last load filtered by time range, level and template, most recent first
+py::list query_segments(const std::string& since = "", const std::string& until = "",
+                        const std::vector<std::string>& levels = {},
+                        const std::vector<std::string>& exclude_levels = {},
+                        int template_id = -1, size_t limit = 100) {
+    py::list result;
+    if (!g_segment_store) {
+        return result;
+    }
+
+    logai::SegmentQuery query;
+    if (!since.empty() && !(query.since_ms = parse_local_time_ms(since))) {
+        throw py::value_error("Unrecognized time: " + since);
+    }
+    if (!until.empty() && !(query.until_ms = parse_local_time_ms(until))) {
+        throw py::value_error("Unrecognized time: " + until);
+    }
+    for (const auto& level : levels) query.levels.push_back(logai::parse_log_level(level));
+    for (const auto& level : exclude_levels) query.exclude_levels.push_back(logai::parse_log_level(level));
+    if (template_id >= 0) query.template_id = template_id;
+    query.limit = limit;
+
+    for (const auto& record : g_segment_store->query(query)) {
+        py::dict row;
+        row["id"] = record.row_id;
+        if (record.timestamp_ms) {
+            auto time_t = static_cast<std::time_t>(*record.timestamp_ms / 1000);
+            std::stringstream ss;
+            ss << std::put_time(std::localtime(&time_t), "%Y-%m-%d %H:%M:%S");
+            row["timestamp"] = ss.str();
+        } else {
+            row["timestamp"] = py::none();
+        }
+        row["level"] = record.level;
+        row["message"] = record.message;
+        row["template_id"] = record.template_id;
+        result.append(row);
+    }
+    return result;
+}
+
+// Size of the segment store of the last load
+py::dict get_segment_store_stats() {
+    py::dict stats;
+    stats["segments"] = g_segment_store ? g_segment_store->segment_count() : 0;
+    stats["rows"] = g_segment_store ? g_segment_store->row_count() : 0;
+    stats["reused"] = g_segment_store_reused;
+    return stats;
+}
+
 PYBIND11_MODULE(logai_cpp, m) {
     m.doc() = "LogAI C++ Module for Log Parsing and Analysis";
     
     // Parser functions
-    m.def("parse_log_file", &parse_log_file, "Parse a log file and return parsed records",
-          py::arg("file_path"), py::arg("format") = "");
+    m.def("parse_log_file", &parse_log_file,
+          "Parse a log file and return parsed records; a file parsed before only returns records appended since",
+          py::arg("file_path"), py::arg("format") = "", py::arg("resume") = true);
+    
+    m.def("get_ingest_state", &get_ingest_state,
+          "Whether the last parse_log_file continued an earlier load, its first row ID and the checkpoint reached");
     
     m.def("process_large_file_with_callback", &process_large_file_with_callback,
-          "Process a large log file with a callback function for each batch of records",
+          "Process a large log file with a callback function for each batch of records; an exception raised by the callback stops the load and propagates",
           py::arg("file_path"), py::arg("format"), py::arg("callback"), py::arg("chunk_size") = 10000);
     
+    m.def("get_pipeline_metrics", &get_pipeline_metrics,
+          "Throughput, batch latency percentiles, queue depths, worker idle time and parse errors of the current or last large-file load");
+    
+    m.def("get_parse_errors", &get_parse_errors,
+          "Line number, byte offset, parser and error code of the lines the current or last large-file load failed to parse");
+    
+    m.def("get_field_dictionaries", &get_field_dictionaries,
+          "Values of the dictionary-encoded fields (level, host, program, facility, cluster_id, source) of the last load, indexed by the codes in each record's field_codes");
+    
+    // Template statistics
+    m.def("get_template_stats", &get_template_stats,
+          "Per-template counts, first/last seen timestamps and per-level counts of the last DRAIN load, as columns");
+    
+    m.def("get_all_templates", &get_all_templates,
+          "All templates of the last DRAIN load keyed by template ID");
+    
+    m.def("get_trending_templates", &get_trending_templates,
+          "Templates with the largest rate change between the last two windows of the last DRAIN load",
+          py::arg("window_seconds") = 300.0, py::arg("k") = 5);
+    
+    m.def("get_template_anomalies", &get_template_anomalies,
+          "New, vanished, spiking and dropping templates of the last DRAIN load, as columns");
+    
+    // Inverted index (malformed queries raise ValueError)
+    m.def("search_log_index", &search_log_index,
+          "Row IDs of the last load matching a query (terms, template:<id>, prefix*, AND/OR/NOT, parentheses), most recent first",
+          py::arg("query"), py::arg("limit") = 0);
+    
+    m.def("count_log_index", &count_log_index,
+          "Number of rows of the last load matching an index query",
+          py::arg("query"));
+    
+    m.def("get_log_index_stats", &get_log_index_stats,
+          "Row, token and template counts and memory use of the index of the last load");
+    
+    // Segment store
+    m.def("set_segment_store_root", &set_segment_store_root,
+          "Persist each loaded file as time-partitioned segments below this directory (empty disables)",
+          py::arg("directory"));
+    
+    m.def("query_segments", &query_segments,
+          "Rows of the last load filtered by time range, level and template, most recent first",
+          py::arg("since") = "", py::arg("until") = "", py::arg("levels") = std::vector<std::string>(),
+          py::arg("exclude_levels") = std::vector<std::string>(), py::arg("template_id") = -1,
+          py::arg("limit") = 100);
+    
+    m.def("get_segment_store_stats", &get_segment_store_stats,
+          "Segment and row counts of the segment store of the last load, and whether it was reused");
+    
     // Attribute extraction
     m.def("extract_attributes", &extract_attributes, "Extract attributes from log lines using regex patterns",
           py::arg("log_lines"), py::arg("patterns"));
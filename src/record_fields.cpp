@@ -0,0 +1,259 @@
+#include "record_fields.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace logai {
+
+namespace {
+
+// Names of FieldSchema::WellKnown, in enum order
+constexpr std::array<std::string_view, FieldSchema::kWellKnownCount> kWellKnownNames = {
+    "level", "host", "program", "facility", "cluster_id", "source", "pid", "detected_timestamp",
+};
+
+template <typename String>
+size_t string_heap_bytes(const String& s) {
+    static const size_t inline_capacity = String().capacity();
+    return s.capacity() > inline_capacity ? s.capacity() + 1 : 0;
+}
+
+} // namespace
+
+FieldSchema::FieldSchema() {
+    for (auto name : kWellKnownNames) {
+        intern(name);
+    }
+}
+
+FieldSchema::Id FieldSchema::intern(std::string_view key) {
+    auto id = names_.intern(key, std::numeric_limits<Id>::max());
+    if (!id) {
+        throw std::length_error("Too many distinct field keys");
+    }
+    return *id;
+}
+
+const std::shared_ptr<FieldSchema>& FieldSchema::shared_default() {
+    static const std::shared_ptr<FieldSchema> schema = std::make_shared<FieldSchema>();
+    return schema;
+}
+
+RecordFields::RecordFields(const RecordFields& other)
+    : schema_(other.schema_),
+      size_(other.size_),
+      coded_(other.coded_),
+      codes_(other.codes_),
+      ids_(other.ids_),
+      values_(other.values_),
+      overflow_(other.overflow_ ? std::make_unique<Overflow>(*other.overflow_) : nullptr) {}
+
+RecordFields::RecordFields(RecordFields&& other) noexcept
+    : schema_(other.schema_),
+      size_(std::exchange(other.size_, 0)),
+      coded_(std::exchange(other.coded_, 0)),
+      codes_(other.codes_),
+      ids_(other.ids_),
+      values_(std::move(other.values_)),
+      overflow_(std::move(other.overflow_)) {}
+
+RecordFields& RecordFields::operator=(RecordFields&& other) noexcept {
+    if (this != &other) {
+        schema_ = other.schema_;
+        size_ = std::exchange(other.size_, 0);
+        coded_ = std::exchange(other.coded_, 0);
+        codes_ = other.codes_;
+        ids_ = other.ids_;
+        values_ = std::move(other.values_);
+        overflow_ = std::move(other.overflow_);
+    }
+    return *this;
+}
+
+RecordFields& RecordFields::operator=(const RecordFields& other) {
+    if (this != &other) {
+        schema_ = other.schema_;
+        size_ = other.size_;
+        coded_ = other.coded_;
+        codes_ = other.codes_;
+        ids_ = other.ids_;
+        values_ = other.values_;
+        overflow_ = other.overflow_ ? std::make_unique<Overflow>(*other.overflow_) : nullptr;
+    }
+    return *this;
+}
+
+void RecordFields::reset(FieldSchema* schema) {
+    clear();
+    schema_ = schema;
+}
+
+void RecordFields::clear() {
+    for (size_t i = 0; i < size_; ++i) {
+        values_[i].clear();
+    }
+    size_ = 0;
+    coded_ = 0;
+    overflow_.reset();
+}
+
+const folly::fbstring* RecordFields::find(Id id) const {
+    if (FieldSchema::is_encoded(id) && (coded_ & bit(id))) {
+        return &schema()->dictionary(id).decode(codes_[id]);
+    }
+    return find_plain(id);
+}
+
+const folly::fbstring* RecordFields::find_plain(Id id) const {
+    if (overflow_) {
+        auto it = overflow_->find(id);
+        return it != overflow_->end() ? &it->second : nullptr;
+    }
+    for (size_t i = 0; i < size_; ++i) {
+        if (ids_[i] == id) {
+            return &values_[i];
+        }
+    }
+    return nullptr;
+}
+
+const folly::fbstring* RecordFields::find(std::string_view key) const {
+    const FieldSchema& schema = *this->schema();
+    for (uint8_t coded = coded_; coded; coded &= coded - 1) {
+        const Id id = static_cast<Id>(__builtin_ctz(coded));
+        if (schema.name(id) == key) {
+            return &schema.dictionary(id).decode(codes_[id]);
+        }
+    }
+    if (overflow_) {
+        auto id = schema.find(key);
+        return id ? find_plain(*id) : nullptr;
+    }
+    for (size_t i = 0; i < size_; ++i) {
+        if (schema.name(ids_[i]) == key) {
+            return &values_[i];
+        }
+    }
+    return nullptr;
+}
+
+void RecordFields::set(Id id, std::string_view value) {
+    if (FieldSchema::is_encoded(id)) {
+        if (auto code = schema()->dictionary(id).encode(value)) {
+            set_code(id, *code);
+            return;
+        }
+        // Dictionary full: keep the value in the record
+        coded_ &= static_cast<uint8_t>(~bit(id));
+    }
+    get_or_insert(id).assign(value.data(), value.size());
+}
+
+void RecordFields::set_code(Id id, Code code) {
+    if (!(coded_ & bit(id))) {
+        erase_plain(id);
+        coded_ |= bit(id);
+    }
+    codes_[id] = code;
+}
+
+folly::fbstring& RecordFields::get_or_insert(Id id) {
+    if (auto* value = find_plain(id)) {
+        return *const_cast<folly::fbstring*>(value);
+    }
+    if (!overflow_ && size_ == kInlineCapacity) {
+        spill();
+    }
+    if (overflow_) {
+        return (*overflow_)[id];
+    }
+    ids_[size_] = id;
+    return values_[size_++];
+}
+
+void RecordFields::erase_plain(Id id) {
+    if (overflow_) {
+        overflow_->erase(id);
+        return;
+    }
+    for (size_t i = 0; i < size_; ++i) {
+        if (ids_[i] == id) {
+            for (size_t j = i + 1; j < size_; ++j) {
+                ids_[j - 1] = ids_[j];
+                values_[j - 1] = std::move(values_[j]);
+            }
+            values_[--size_].clear();
+            return;
+        }
+    }
+}
+
+void RecordFields::spill() {
+    overflow_ = std::make_unique<Overflow>();
+    overflow_->reserve(kInlineCapacity * 2);
+    for (size_t i = 0; i < size_; ++i) {
+        overflow_->emplace(ids_[i], std::move(values_[i]));
+        values_[i].clear();
+    }
+    size_ = 0;
+}
+
+size_t RecordFields::heap_bytes() const {
+    size_t bytes = 0;
+    for (size_t i = 0; i < size_; ++i) {
+        bytes += string_heap_bytes(values_[i]);
+    }
+    if (overflow_) {
+        bytes += sizeof(Overflow) + overflow_->bucket_count() * sizeof(Overflow::value_type);
+        for (const auto& [id, value] : *overflow_) {
+            bytes += string_heap_bytes(value);
+        }
+    }
+    return bytes;
+}
+
+RecordFields::const_iterator::value_type RecordFields::const_iterator::operator*() const {
+    const auto& schema = *fields_->schema();
+    if (coded_) {
+        const Id id = static_cast<Id>(__builtin_ctz(coded_));
+        return {schema.name(id), schema.dictionary(id).decode(fields_->codes_[id])};
+    }
+    if (fields_->overflow_) {
+        return {schema.name(overflow_it_->first), overflow_it_->second};
+    }
+    return {schema.name(fields_->ids_[index_]), fields_->values_[index_]};
+}
+
+RecordFields::const_iterator& RecordFields::const_iterator::operator++() {
+    if (coded_) {
+        coded_ &= coded_ - 1;
+    } else if (fields_->overflow_) {
+        ++overflow_it_;
+    } else {
+        ++index_;
+    }
+    return *this;
+}
+
+RecordFields::const_iterator RecordFields::begin() const {
+    const_iterator it;
+    it.fields_ = this;
+    it.coded_ = coded_;
+    if (overflow_) {
+        it.overflow_it_ = overflow_->cbegin();
+    }
+    return it;
+}
+
+RecordFields::const_iterator RecordFields::end() const {
+    const_iterator it;
+    it.fields_ = this;
+    if (overflow_) {
+        it.overflow_it_ = overflow_->cend();
+    } else {
+        it.index_ = size_;
+    }
+    return it;
+}
+
+} // namespace logai
@@ -0,0 +1,366 @@
+/**
+ * @file record_fields.h
+ * @brief Interned field keys and the small flat field container records use
+ */
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <folly/FBString.h>
+#include <folly/container/F14Map.h>
+
+namespace logai {
+
+namespace detail {
+
+/**
+ * @brief Thread-safe, append-only set of strings numbered densely from 0
+ *
+ * Strings live in chunks of 64, 128, 256, ... entries that are never moved
+ * or freed before the table, so at() takes no lock and the reference it
+ * returns stays valid for the life of the table.
+ */
+template <typename String>
+class InternTable {
+public:
+    using Id = uint32_t;
+
+    InternTable() = default;
+    ~InternTable() {
+        for (auto& chunk : chunks_) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+    InternTable(const InternTable&) = delete;
+    InternTable& operator=(const InternTable&) = delete;
+
+    /**
+     * @brief ID of value, adding it if it is new and the table holds fewer than limit strings
+     */
+    std::optional<Id> intern(std::string_view value, size_t limit) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = ids_.find(value);
+            if (it != ids_.end()) {
+                return it->second;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(value);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+        size_t offset;
+        const size_t chunk = chunk_of(size_, offset);
+        if (size_ >= limit || chunk >= kMaxChunks) {
+            return std::nullopt;
+        }
+        String* strings = chunks_[chunk].load(std::memory_order_relaxed);
+        if (!strings) {
+            strings = new String[kFirstChunkSize << chunk];
+            chunks_[chunk].store(strings, std::memory_order_release);
+        }
+        strings[offset].assign(value.data(), value.size());
+        ids_.emplace(std::string_view(strings[offset].data(), value.size()), size_);
+        return size_++;
+    }
+
+    std::optional<Id> find(std::string_view value) const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = ids_.find(value);
+        if (it == ids_.end()) {
+            return std::nullopt;
+        }
+        return it->second;
+    }
+
+    /**
+     * @brief String of an ID returned by intern() or find()
+     */
+    const String& at(Id id) const {
+        size_t offset;
+        const size_t chunk = chunk_of(id, offset);
+        return chunks_[chunk].load(std::memory_order_acquire)[offset];
+    }
+
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        return size_;
+    }
+
+private:
+    static constexpr size_t kFirstChunkSize = 64;
+    static constexpr size_t kMaxChunks = 26;  // Enough chunks for every 32-bit ID
+
+    static size_t chunk_of(Id id, size_t& offset) {
+        const uint64_t index = static_cast<uint64_t>(id) / kFirstChunkSize + 1;
+        const size_t chunk = 63 - static_cast<size_t>(__builtin_clzll(index));
+        offset = static_cast<size_t>(id - kFirstChunkSize * ((uint64_t{1} << chunk) - 1));
+        return chunk;
+    }
+
+    mutable std::shared_mutex mutex_;  // Guards ids_ and size_
+    folly::F14FastMap<std::string_view, Id> ids_;
+    Id size_ = 0;
+    std::array<std::atomic<String*>, kMaxChunks> chunks_{};
+};
+
+} // namespace detail
+
+/**
+ * @brief Dictionary of the values one low-cardinality field takes during a load
+ *
+ * Records store a 32-bit code instead of their own copy of the value.
+ * Codes are assigned in first-seen order and never change, so codes read
+ * from earlier batches stay valid as the dictionary grows. A dictionary
+ * stops growing at kMaxCodes values; records keep any further new values
+ * as plain strings, so a field that turns out not to be low-cardinality
+ * costs no more than it did without a dictionary. Thread-safe; decode()
+ * takes no lock.
+ */
+class ValueDictionary {
+public:
+    using Code = uint32_t;
+    static constexpr size_t kMaxCodes = 1 << 16;
+
+    /**
+     * @brief Code of value, adding it if it is new; std::nullopt once the dictionary is full
+     */
+    std::optional<Code> encode(std::string_view value) { return values_.intern(value, kMaxCodes); }
+
+    /**
+     * @brief Code of value, or std::nullopt if no record has it
+     */
+    std::optional<Code> find(std::string_view value) const { return values_.find(value); }
+
+    /**
+     * @brief Value of a code returned by encode() or find()
+     */
+    const folly::fbstring& decode(Code code) const { return values_.at(code); }
+
+    size_t size() const { return values_.size(); }
+
+private:
+    detail::InternTable<folly::fbstring> values_;
+};
+
+/**
+ * @brief Dictionary from field keys to dense IDs, shared by the records of one load
+ *
+ * Keys are only ever added, so an ID stays valid, and names stay at the same
+ * address, for the life of the schema. The keys parsers themselves produce
+ * are interned up front at fixed IDs, identical in every schema, so code that
+ * reads them needs no lookup at all. The schema also holds the value
+ * dictionaries of the well-known keys that repeat across records. Thread-safe;
+ * name() takes no lock.
+ */
+class FieldSchema {
+public:
+    using Id = uint32_t;
+
+    /// Keys pre-interned in every schema, in this order. Values of the keys
+    /// before kEncodedEnd are dictionary-encoded.
+    enum WellKnown : Id {
+        kLevel,
+        kHost,
+        kProgram,
+        kFacility,
+        kClusterId,
+        kSource,
+        kEncodedEnd,
+        kPid = kEncodedEnd,
+        kDetectedTimestamp,
+        kWellKnownCount
+    };
+
+    FieldSchema();
+    FieldSchema(const FieldSchema&) = delete;
+    FieldSchema& operator=(const FieldSchema&) = delete;
+
+    /**
+     * @brief ID of key, adding it if it is new
+     *
+     * @throws std::length_error if the schema already holds 2^32 keys
+     */
+    Id intern(std::string_view key);
+
+    /**
+     * @brief ID of key, or std::nullopt if no record of this schema has it
+     */
+    std::optional<Id> find(std::string_view key) const { return names_.find(key); }
+
+    /**
+     * @brief Name of an ID returned by intern() or find()
+     */
+    std::string_view name(Id id) const { return names_.at(id); }
+
+    size_t size() const { return names_.size(); }
+
+    static constexpr bool is_encoded(Id id) { return id < kEncodedEnd; }
+
+    /**
+     * @brief Value dictionary of a key; id must satisfy is_encoded()
+     */
+    ValueDictionary& dictionary(Id id) { return dictionaries_[id]; }
+    const ValueDictionary& dictionary(Id id) const { return dictionaries_[id]; }
+
+    /**
+     * @brief Schema of records filled without one, e.g. by parsers made outside a loader
+     */
+    static const std::shared_ptr<FieldSchema>& shared_default();
+
+private:
+    detail::InternTable<std::string> names_;
+    std::array<ValueDictionary, kEncodedEnd> dictionaries_;
+};
+
+/**
+ * @brief Fields of one record, keyed by FieldSchema ID
+ *
+ * Values of dictionary-encoded keys (FieldSchema::is_encoded()) are stored
+ * as 32-bit codes into the schema's dictionaries. Up to kInlineCapacity
+ * other fields live in arrays inside the record, found by a linear scan of
+ * their IDs, so the common narrow record allocates nothing for its keys and
+ * nothing for values that fit fbstring's inline buffer. Wider records spill
+ * those fields to a hash map on their first extra field. Lookups by name
+ * compare against the record's own key names and never build a string;
+ * lookups by ID compare integers only.
+ *
+ * A record points at its schema without owning it, so that filling one
+ * costs no reference-count traffic on a schema every worker shares. The
+ * loader or parser that fills records keeps their schema alive, and the
+ * records must not outlive it (see FileDataLoader::field_schema()).
+ */
+class RecordFields {
+public:
+    using Id = FieldSchema::Id;
+    using Code = ValueDictionary::Code;
+    static constexpr size_t kInlineCapacity = 6;
+
+    RecordFields() = default;
+    explicit RecordFields(FieldSchema* schema) : schema_(schema) {}
+    RecordFields(const RecordFields& other);
+    RecordFields(RecordFields&& other) noexcept;
+    RecordFields& operator=(const RecordFields& other);
+    RecordFields& operator=(RecordFields&& other) noexcept;
+
+    /**
+     * @brief Drop all fields and key new ones in schema, which must outlive the record
+     */
+    void reset(FieldSchema* schema);
+
+    /**
+     * @brief The schema keys are interned in; FieldSchema::shared_default() until one is set
+     */
+    FieldSchema* schema() const {
+        return schema_ ? schema_ : FieldSchema::shared_default().get();
+    }
+
+    size_t size() const {
+        return (overflow_ ? overflow_->size() : size_) + static_cast<size_t>(__builtin_popcount(coded_));
+    }
+    bool empty() const { return size() == 0; }
+    void clear();
+
+    /**
+     * @brief Value of id, or nullptr; a dictionary-encoded value is returned from the dictionary
+     */
+    const folly::fbstring* find(Id id) const;
+    const folly::fbstring* find(std::string_view key) const;
+
+    bool contains(Id id) const { return find(id) != nullptr; }
+    bool contains(std::string_view key) const { return find(key) != nullptr; }
+
+    /**
+     * @brief Dictionary code of id, or std::nullopt if it has none (absent, or kept as a plain string)
+     */
+    std::optional<Code> code(Id id) const {
+        if (!FieldSchema::is_encoded(id) || !(coded_ & bit(id))) {
+            return std::nullopt;
+        }
+        return codes_[id];
+    }
+
+    /**
+     * @brief Set id, encoding the value if the key is dictionary-encoded
+     */
+    void set(Id id, std::string_view value);
+    void set(std::string_view key, std::string_view value) { set(schema()->intern(key), value); }
+
+    /**
+     * @brief Set id to a code its dictionary already assigned, for values encoded once up front
+     */
+    void set_code(Id id, Code code);
+
+    /**
+     * @brief Bytes the fields hold on the heap, beyond sizeof(RecordFields)
+     */
+    size_t heap_bytes() const;
+
+    /**
+     * @brief Iterates (name, value) pairs: dictionary-encoded fields first, in
+     * FieldSchema::WellKnown order, then the others, inline ones in insertion order
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, const folly::fbstring&>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        value_type operator*() const;
+        const_iterator& operator++();
+        const_iterator operator++(int) {
+            auto previous = *this;
+            ++*this;
+            return previous;
+        }
+        bool operator==(const const_iterator& other) const {
+            return coded_ == other.coded_ && index_ == other.index_ && overflow_it_ == other.overflow_it_;
+        }
+        bool operator!=(const const_iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class RecordFields;
+        using OverflowIterator = folly::F14FastMap<Id, folly::fbstring>::const_iterator;
+
+        const RecordFields* fields_ = nullptr;
+        uint8_t coded_ = 0;               // Encoded fields not yet visited
+        size_t index_ = 0;                // Position among the inline fields
+        OverflowIterator overflow_it_{};  // Position among spilled fields
+    };
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    using Overflow = folly::F14FastMap<Id, folly::fbstring>;
+
+    static_assert(FieldSchema::kEncodedEnd <= 8, "coded_ has one bit per encoded key");
+    static uint8_t bit(Id id) { return static_cast<uint8_t>(1u << id); }
+
+    const folly::fbstring* find_plain(Id id) const;
+    folly::fbstring& get_or_insert(Id id);
+    void erase_plain(Id id);
+    void spill();
+
+    FieldSchema* schema_ = nullptr;  // Not owned
+    uint8_t size_ = 0;   // Inline fields; unused once spilled
+    uint8_t coded_ = 0;  // Bit id set if codes_[id] holds the value of encoded key id
+    std::array<Code, FieldSchema::kEncodedEnd> codes_{};
+    std::array<Id, kInlineCapacity> ids_{};
+    std::array<folly::fbstring, kInlineCapacity> values_;
+    std::unique_ptr<Overflow> overflow_;  // Set once the record has more than kInlineCapacity plain fields
+};
+
+} // namespace logai
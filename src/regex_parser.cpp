@@ -3,34 +3,31 @@
 
 namespace logai {
 
-// Add declaration for parse_timestamp function
-std::optional<std::chrono::system_clock::time_point> parse_timestamp(std::string_view timestamp, const std::string& format);
-
-RegexParser::RegexParser(const DataLoaderConfig& config, const std::string& pattern)
-    : config_(config), pattern_(pattern) {}
+RegexParser::RegexParser(const DataLoaderConfig& config, const std::string& pattern, std::shared_ptr<FieldSchema> schema)
+    : LogParser(std::move(schema)), config_(config), pattern_(pattern) {
+    for (size_t i = 1; i <= pattern_.mark_count(); ++i) {
+        group_ids_.push_back(field_schema_->intern(std::to_string(i)));
+    }
+}
 
 LogParser::LogEntry RegexParser::parse(const std::string& line) {
     LogParser::LogEntry entry;
-    try {
-        // Use the existing parse_line implementation to get the LogRecordObject
-        LogRecordObject record = parse_line(line);
-        
-        // Convert LogRecordObject to LogEntry
-        entry.timestamp = record.timestamp ? std::to_string(record.timestamp->time_since_epoch().count()) : "";
-        entry.level = record.level;
-        entry.message = record.message;
-        
-        // Copy fields to fields
-        for (const auto& [key, value] : record.fields) {
-            entry.fields[key.toStdString()] = value.toStdString();
-        }
-    } catch (const std::exception& e) {
-        throw std::runtime_error("Failed to parse log line: " + std::string(e.what()));
-    }
-    
+    throw_if_failed(try_parse(line, entry), "regex");
     return entry;
 }
 
+ParseStatus RegexParser::try_parse(const std::string& line, LogEntry& entry) noexcept {
+    LogRecordObject record;
+    const ParseStatus status = try_parse_line(line, record);
+    if (status != ParseStatus::Ok) {
+        return status;
+    }
+    return guarded([&] {
+        entry = LogEntry::from_record(std::move(record));
+        return ParseStatus::Ok;
+    });
+}
+
 bool RegexParser::validate(const std::string& line) {
     try {
         std::smatch matches;
@@ -42,34 +39,30 @@ bool RegexParser::validate(const std::string& line) {
 
 LogRecordObject RegexParser::parse_line(const std::string& line) {
     LogRecordObject record;
-    std::string line_str(line);  // Convert to string for regex
-    std::smatch matches;
-    
-    try {
-        if (!std::regex_match(line_str, matches, pattern_)) {
-            throw std::runtime_error("Line does not match pattern");
+    throw_if_failed(try_parse_line(line, record), "regex");
+    return record;
+}
+
+ParseStatus RegexParser::try_parse_line(const std::string& line, LogRecordObject& record) noexcept {
+    // A regex_error (e.g. backtracking limits) surfaces as ParseStatus::Error
+    return guarded([&] {
+        std::smatch matches;
+        if (!std::regex_match(line, matches, pattern_)) {
+            return ParseStatus::Malformed;
         }
 
-        // Map capture groups to record fields
-        for (size_t i = 1; i < matches.size(); ++i) {
+        // Map capture groups to record fields, named by index since std::regex
+        // has no named groups
+        record.fields.reset(field_schema_.get());
+        const std::string_view text(line);
+        for (size_t i = 1; i < matches.size() && i <= group_ids_.size(); ++i) {
             const auto& match = matches[i];
-            // Use index as name since std::regex doesn't support named groups
-            const auto name = std::to_string(i);
-
-            if (name == "body") {
-                record.message = match.str();
-            } else if (name == "timestamp") {
-                record.timestamp = parse_timestamp(match.str(), config_.datetime_format);
-            } else if (name == "severity") {
-                record.level = match.str();
-            } else {
-                record.set_field(name, match.str());
-            }
+            const std::string_view value = match.matched
+                ? text.substr(static_cast<size_t>(match.first - line.begin()), static_cast<size_t>(match.length()))
+                : std::string_view();
+            record.set_field(group_ids_[i - 1], value);
         }
-    } catch (const std::regex_error& e) {
-        throw std::runtime_error("Regex error: " + std::string(e.what()));
-    }
-
-    return record;
+        return ParseStatus::Ok;
+    });
 }
 } 
\ No newline at end of file
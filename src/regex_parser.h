@@ -3,19 +3,23 @@
 #include "log_parser.h"
 #include "data_loader_config.h"
 #include <regex>
+#include <vector>
 
 namespace logai {
 
 class RegexParser : public LogParser {
 public:
-    RegexParser(const DataLoaderConfig& config, const std::string& pattern);
+    RegexParser(const DataLoaderConfig& config, const std::string& pattern, std::shared_ptr<FieldSchema> schema = nullptr);
     
     LogEntry parse(const std::string& line) override;
     bool validate(const std::string& line) override;
+    ParseStatus try_parse(const std::string& line, LogEntry& entry) noexcept override;
     LogRecordObject parse_line(const std::string& line) override;
+    ParseStatus try_parse_line(const std::string& line, LogRecordObject& record) noexcept override;
 
 private:
     const DataLoaderConfig& config_;
     std::regex pattern_;
+    std::vector<FieldSchema::Id> group_ids_;  // Field of each capture group, named by its index
 };
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+/**
+ * @file reorder_buffer.h
+ * @brief Bounded buffer that hands out items in ID order
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace logai {
+
+/**
+ * @brief Restores the order of items numbered 0, 1, 2, ... that finish out of order
+ *
+ * Items live in a ring of `window` slots indexed by `id % window`. A push
+ * more than a window ahead of the next ID to pop waits for the consumer,
+ * so memory is bounded by the window. When IDs are handed to workers in
+ * order, a window of at least the worker count never blocks the worker
+ * holding the next ID. The consumer is only woken when the ID it waits
+ * for arrives, or when the stream ends.
+ *
+ * End of stream: finish(count) announces how many IDs exist, and pop()
+ * returns false once all of them were popped. close() ends the stream early:
+ * pop() still returns the items up to the first missing ID, and push()
+ * fails from then on.
+ */
+template<typename T>
+class ReorderBuffer {
+public:
+    explicit ReorderBuffer(size_t window) : slots_(window > 0 ? window : 1) {}
+
+    ReorderBuffer(const ReorderBuffer&) = delete;
+    ReorderBuffer& operator=(const ReorderBuffer&) = delete;
+
+    /**
+     * @brief Store the item with this ID, waiting while it is a full window ahead
+     * @return false if the buffer was closed
+     */
+    bool push(size_t id, T value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [&] { return closed_ || id < next_ + slots_.size(); });
+        if (closed_) {
+            return false;
+        }
+        slots_[id % slots_.size()] = std::move(value);
+        ++held_;
+        if (id == next_) {
+            ready_.notify_one();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Wait for the next item in ID order
+     * @return false at the end of the stream
+     */
+    bool pop(T& value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto& slot = slots_[next_ % slots_.size()];
+        ready_.wait(lock, [&] { return slot.has_value() || closed_ || next_ >= count_; });
+        if (!slot.has_value()) {
+            return false;
+        }
+        value = std::move(*slot);
+        slot.reset();
+        --held_;
+        ++next_;
+        lock.unlock();
+        not_full_.notify_all();
+        return true;
+    }
+
+    /**
+     * @brief Announce that IDs 0 .. count-1 are all there will be
+     */
+    void finish(size_t count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        count_ = count;
+        ready_.notify_all();
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+        not_full_.notify_all();
+    }
+
+    /**
+     * @brief ID the consumer waits for, which is also the number of items popped
+     */
+    size_t next_id() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return next_;
+    }
+
+    /**
+     * @brief Items pushed and not popped yet
+     */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return held_;
+    }
+
+    size_t window() const { return slots_.size(); }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable ready_;     // The next ID arrived or the stream ended
+    std::condition_variable not_full_;  // The window moved on
+    std::vector<std::optional<T>> slots_;
+    size_t next_ = 0;
+    size_t held_ = 0;
+    size_t count_ = std::numeric_limits<size_t>::max();
+    bool closed_ = false;
+};
+
+} // namespace logai
@@ -0,0 +1,513 @@
+#include "segment_store.h"
+#include "timestamp_utils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <folly/container/F14Map.h>
+#include <spdlog/spdlog.h>
+
+namespace logai {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kSegmentMagic[4] = {'L', 'S', 'E', 'G'};
+constexpr uint32_t kSegmentVersion = 2;
+constexpr const char* kSegmentExtension = ".lseg";
+constexpr const char* kCompleteMarker = "COMPLETE";
+constexpr int64_t kNoTimestamp = std::numeric_limits<int64_t>::min();
+
+// Column order inside a segment file
+enum Column : size_t {
+    kRowIdColumn = 0,       // uint64_t per row
+    kTimestampColumn,       // int64_t per row, kNoTimestamp if absent
+    kLevelCodeColumn,       // uint32_t per row, index into the segment's level dictionary
+    kTemplateIdColumn,      // int32_t per row, -1 if absent
+    kLevelOffsetsColumn,    // uint64_t per level dictionary entry + 1 into kLevelTextColumn
+    kLevelTextColumn,       // Level dictionary: each distinct level text once, in first-seen order
+    kMessageOffsetsColumn,  // uint64_t per row + 1 into kMessageTextColumn
+    kMessageTextColumn,
+    kColumnCount
+};
+
+struct SegmentHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t row_count;
+    uint64_t min_row_id;
+    uint64_t max_row_id;
+    int64_t min_timestamp_ms;
+    int64_t max_timestamp_ms;
+    uint32_t level_mask;
+    int32_t min_template_id;
+    int32_t max_template_id;
+    uint32_t flags;
+    uint64_t column_offset[kColumnCount];
+    uint64_t column_bytes[kColumnCount];
+};
+
+constexpr uint32_t kHasTimestamps = 1u << 0;
+constexpr uint32_t kHasUntimestamped = 1u << 1;
+
+size_t align8(size_t value) {
+    return (value + 7) & ~size_t{7};
+}
+
+int64_t floor_div(int64_t value, int64_t divisor) {
+    int64_t quotient = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+}
+
+uint32_t level_bits(const std::vector<LogLevel>& levels) {
+    uint32_t mask = 0;
+    for (LogLevel level : levels) {
+        mask |= 1u << static_cast<uint32_t>(level);
+    }
+    return mask;
+}
+
+} // namespace
+
+struct SegmentStore::PartitionBuffer {
+    std::vector<uint64_t> row_ids;
+    std::vector<int64_t> timestamps;
+    std::vector<uint32_t> level_codes;
+    std::vector<int32_t> template_ids;
+    folly::F14FastMap<std::string, uint32_t> level_dictionary;  // Level text -> code
+    std::vector<uint8_t> dictionary_levels;                     // LogLevel per code
+    std::vector<uint64_t> level_offsets{0};
+    std::string level_text;
+    std::vector<uint64_t> message_offsets{0};
+    std::string message_text;
+
+    size_t rows() const { return row_ids.size(); }
+
+    uint32_t level_code(const std::string& level) {
+        auto it = level_dictionary.find(level);
+        if (it != level_dictionary.end()) {
+            return it->second;
+        }
+        const auto code = static_cast<uint32_t>(dictionary_levels.size());
+        level_dictionary.emplace(level, code);
+        dictionary_levels.push_back(static_cast<uint8_t>(parse_log_level(level)));
+        level_text += level;
+        level_offsets.push_back(level_text.size());
+        return code;
+    }
+};
+
+struct SegmentStore::Segment {
+    std::string path;
+    MemoryMappedFile file;
+    SegmentZoneMap zone;
+    const uint64_t* row_ids = nullptr;
+    const int64_t* timestamps = nullptr;
+    const uint32_t* level_codes = nullptr;
+    const int32_t* template_ids = nullptr;
+    const uint64_t* level_offsets = nullptr;
+    const char* level_text = nullptr;
+    const uint64_t* message_offsets = nullptr;
+    const char* message_text = nullptr;
+    std::vector<uint8_t> dictionary_levels;  // LogLevel of each level dictionary entry
+
+    // Map and validate a segment file, false if it is not a readable segment
+    bool open(const std::string& segment_path) {
+        path = segment_path;
+        if (!file.open(path) || file.size() < sizeof(SegmentHeader)) {
+            return false;
+        }
+        SegmentHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.magic, kSegmentMagic, sizeof(kSegmentMagic)) != 0 ||
+            header.version != kSegmentVersion) {
+            return false;
+        }
+        const uint64_t n = header.row_count;
+        const uint64_t levels = header.column_bytes[kLevelOffsetsColumn] / sizeof(uint64_t);
+        if (levels == 0) {
+            return false;
+        }
+        const uint64_t expected_bytes[kColumnCount] = {
+            n * sizeof(uint64_t), n * sizeof(int64_t), n * sizeof(uint32_t), n * sizeof(int32_t),
+            levels * sizeof(uint64_t), header.column_bytes[kLevelTextColumn],
+            (n + 1) * sizeof(uint64_t), header.column_bytes[kMessageTextColumn]};
+        for (size_t c = 0; c < kColumnCount; ++c) {
+            if (header.column_bytes[c] != expected_bytes[c] || header.column_offset[c] % 8 != 0 ||
+                header.column_offset[c] > file.size() ||
+                header.column_bytes[c] > file.size() - header.column_offset[c]) {
+                return false;
+            }
+        }
+
+        const char* base = file.data();
+        row_ids = reinterpret_cast<const uint64_t*>(base + header.column_offset[kRowIdColumn]);
+        timestamps = reinterpret_cast<const int64_t*>(base + header.column_offset[kTimestampColumn]);
+        level_codes = reinterpret_cast<const uint32_t*>(base + header.column_offset[kLevelCodeColumn]);
+        template_ids = reinterpret_cast<const int32_t*>(base + header.column_offset[kTemplateIdColumn]);
+        level_offsets = reinterpret_cast<const uint64_t*>(base + header.column_offset[kLevelOffsetsColumn]);
+        level_text = base + header.column_offset[kLevelTextColumn];
+        message_offsets = reinterpret_cast<const uint64_t*>(base + header.column_offset[kMessageOffsetsColumn]);
+        message_text = base + header.column_offset[kMessageTextColumn];
+        if (level_offsets[levels - 1] != header.column_bytes[kLevelTextColumn] ||
+            message_offsets[n] != header.column_bytes[kMessageTextColumn]) {
+            return false;
+        }
+        dictionary_levels.resize(levels - 1);
+        for (uint64_t code = 0; code + 1 < levels; ++code) {
+            if (level_offsets[code] > level_offsets[code + 1]) {
+                return false;
+            }
+            dictionary_levels[code] = static_cast<uint8_t>(parse_log_level(
+                std::string_view(level_text + level_offsets[code], level_offsets[code + 1] - level_offsets[code])));
+        }
+        for (uint64_t row = 0; row < n; ++row) {
+            if (level_codes[row] >= dictionary_levels.size()) {
+                return false;
+            }
+        }
+
+        zone.row_count = n;
+        zone.min_row_id = header.min_row_id;
+        zone.max_row_id = header.max_row_id;
+        zone.min_timestamp_ms = header.min_timestamp_ms;
+        zone.max_timestamp_ms = header.max_timestamp_ms;
+        zone.has_timestamps = (header.flags & kHasTimestamps) != 0;
+        zone.has_untimestamped = (header.flags & kHasUntimestamped) != 0;
+        zone.level_mask = header.level_mask;
+        zone.min_template_id = header.min_template_id;
+        zone.max_template_id = header.max_template_id;
+        return true;
+    }
+
+    StoredRecord read(size_t row) const {
+        StoredRecord record;
+        record.row_id = row_ids[row];
+        if (timestamps[row] != kNoTimestamp) {
+            record.timestamp_ms = timestamps[row];
+        }
+        const uint32_t code = level_codes[row];
+        record.level.assign(level_text + level_offsets[code], level_offsets[code + 1] - level_offsets[code]);
+        record.template_id = template_ids[row];
+        record.message.assign(message_text + message_offsets[row], message_offsets[row + 1] - message_offsets[row]);
+        return record;
+    }
+};
+
+SegmentStore::SegmentStore(const SegmentStoreConfig& config)
+    : config_(config) {
+    config_.partition_ms = std::max<int64_t>(config_.partition_ms, 1);
+    config_.max_rows_per_segment = std::max<size_t>(config_.max_rows_per_segment, 1);
+
+    std::error_code ec;
+    fs::create_directories(config_.directory, ec);
+    if (ec) {
+        throw std::runtime_error("Failed to create segment directory: " + config_.directory + ", error: " + ec.message());
+    }
+    load_existing();
+}
+
+SegmentStore::~SegmentStore() {
+    try {
+        flush();
+    } catch (const std::exception& e) {
+        spdlog::error("Failed to flush segment store {}: {}", config_.directory, e.what());
+    }
+}
+
+void SegmentStore::load_existing() {
+    std::vector<std::string> paths;
+    for (const auto& entry : fs::directory_iterator(config_.directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == kSegmentExtension) {
+            paths.push_back(entry.path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    for (const auto& path : paths) {
+        auto segment = std::make_unique<Segment>();
+        if (!segment->open(path)) {
+            // E.g. written by an older version; the store no longer holds the whole source
+            spdlog::warn("Skipping unreadable segment: {}", path);
+            missing_segments_ = true;
+            continue;
+        }
+        // seg-<seq>.lseg
+        const std::string stem = fs::path(path).stem().string();
+        uint64_t seq = 0;
+        if (stem.size() > 4) {
+            std::from_chars(stem.data() + 4, stem.data() + stem.size(), seq);
+        }
+        next_segment_seq_ = std::max(next_segment_seq_, seq + 1);
+        segments_.push_back(std::move(segment));
+    }
+}
+
+void SegmentStore::append(uint64_t first_row_id, const std::vector<LogRecordObject>& records) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t row_id = first_row_id;
+    for (const auto& record : records) {
+        const int64_t timestamp = record.timestamp ? millis_from_time_point(*record.timestamp) : kNoTimestamp;
+        const int64_t partition = timestamp == kNoTimestamp ? kNoTimestamp : floor_div(timestamp, config_.partition_ms);
+
+        auto& slot = buffers_[partition];
+        if (!slot) {
+            slot = std::make_unique<PartitionBuffer>();
+        }
+        PartitionBuffer& buffer = *slot;
+
+        int32_t template_id = -1;
+        if (const auto* cluster_id = record.fields.find(FieldSchema::kClusterId)) {
+            const char* first = cluster_id->data();
+            std::from_chars(first, first + cluster_id->size(), template_id);
+        }
+        const std::string& message = record.message.empty() ? record.body : record.message;
+
+        buffer.row_ids.push_back(row_id++);
+        buffer.timestamps.push_back(timestamp);
+        buffer.level_codes.push_back(buffer.level_code(record.level));
+        buffer.template_ids.push_back(template_id);
+        buffer.message_text += message;
+        buffer.message_offsets.push_back(buffer.message_text.size());
+
+        if (buffer.rows() >= config_.max_rows_per_segment ||
+            buffer.message_text.size() + buffer.level_text.size() >= config_.max_segment_bytes) {
+            write_segment(partition, buffer);
+            buffers_.erase(partition);
+        }
+    }
+}
+
+void SegmentStore::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& [partition, buffer] : buffers_) {
+        write_segment(partition, *buffer);
+    }
+    buffers_.clear();
+}
+
+void SegmentStore::write_segment(int64_t partition, PartitionBuffer& buffer) {
+    if (buffer.rows() == 0) {
+        return;
+    }
+    const size_t n = buffer.rows();
+
+    SegmentHeader header{};
+    std::memcpy(header.magic, kSegmentMagic, sizeof(kSegmentMagic));
+    header.version = kSegmentVersion;
+    header.row_count = n;
+    header.min_row_id = *std::min_element(buffer.row_ids.begin(), buffer.row_ids.end());
+    header.max_row_id = *std::max_element(buffer.row_ids.begin(), buffer.row_ids.end());
+    header.min_timestamp_ms = std::numeric_limits<int64_t>::max();
+    header.max_timestamp_ms = std::numeric_limits<int64_t>::min();
+    header.min_template_id = std::numeric_limits<int32_t>::max();
+    header.max_template_id = -1;
+    for (size_t i = 0; i < n; ++i) {
+        if (buffer.timestamps[i] == kNoTimestamp) {
+            header.flags |= kHasUntimestamped;
+        } else {
+            header.flags |= kHasTimestamps;
+            header.min_timestamp_ms = std::min(header.min_timestamp_ms, buffer.timestamps[i]);
+            header.max_timestamp_ms = std::max(header.max_timestamp_ms, buffer.timestamps[i]);
+        }
+        header.level_mask |= 1u << buffer.dictionary_levels[buffer.level_codes[i]];
+        if (buffer.template_ids[i] >= 0) {
+            header.min_template_id = std::min(header.min_template_id, buffer.template_ids[i]);
+            header.max_template_id = std::max(header.max_template_id, buffer.template_ids[i]);
+        }
+    }
+
+    const std::pair<const void*, size_t> columns[kColumnCount] = {
+        {buffer.row_ids.data(), n * sizeof(uint64_t)},
+        {buffer.timestamps.data(), n * sizeof(int64_t)},
+        {buffer.level_codes.data(), n * sizeof(uint32_t)},
+        {buffer.template_ids.data(), n * sizeof(int32_t)},
+        {buffer.level_offsets.data(), buffer.level_offsets.size() * sizeof(uint64_t)},
+        {buffer.level_text.data(), buffer.level_text.size()},
+        {buffer.message_offsets.data(), (n + 1) * sizeof(uint64_t)},
+        {buffer.message_text.data(), buffer.message_text.size()}};
+    size_t offset = align8(sizeof(SegmentHeader));
+    for (size_t c = 0; c < kColumnCount; ++c) {
+        header.column_offset[c] = offset;
+        header.column_bytes[c] = columns[c].second;
+        offset = align8(offset + columns[c].second);
+    }
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "seg-%010llu", static_cast<unsigned long long>(next_segment_seq_++));
+    const fs::path path = fs::path(config_.directory) / (std::string(name) + kSegmentExtension);
+    const fs::path tmp_path = fs::path(path).concat(".tmp");
+
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Failed to create segment: " + tmp_path.string());
+        }
+        static const char padding[8] = {};
+        size_t written = sizeof(SegmentHeader);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (size_t c = 0; c < kColumnCount; ++c) {
+            out.write(padding, static_cast<std::streamsize>(header.column_offset[c] - written));
+            out.write(static_cast<const char*>(columns[c].first), static_cast<std::streamsize>(columns[c].second));
+            written = header.column_offset[c] + columns[c].second;
+        }
+        out.write(padding, static_cast<std::streamsize>(offset - written));
+        if (!out) {
+            throw std::runtime_error("Failed to write segment: " + tmp_path.string());
+        }
+    }
+    // Segments appear atomically and are never modified afterwards
+    fs::rename(tmp_path, path);
+
+    auto segment = std::make_unique<Segment>();
+    if (!segment->open(path.string())) {
+        throw std::runtime_error("Failed to map segment: " + path.string());
+    }
+    segments_.push_back(std::move(segment));
+    spdlog::debug("Wrote segment {} ({} rows, partition {})", path.string(), n, partition);
+}
+
+bool SegmentStore::may_match(const SegmentZoneMap& zone, const SegmentQuery& query, uint32_t level_mask) const {
+    if ((zone.level_mask & level_mask) == 0) {
+        return false;
+    }
+    if (query.template_id &&
+        (*query.template_id < zone.min_template_id || *query.template_id > zone.max_template_id)) {
+        return false;
+    }
+    if (query.since_ms || query.until_ms) {
+        // Untimestamped rows never satisfy a time bound
+        if (!zone.has_timestamps) {
+            return false;
+        }
+        if (query.since_ms && zone.max_timestamp_ms < *query.since_ms) {
+            return false;
+        }
+        if (query.until_ms && zone.min_timestamp_ms > *query.until_ms) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<StoredRecord> SegmentStore::query(const SegmentQuery& query) const {
+    uint32_t level_mask = query.levels.empty() ? ~0u : level_bits(query.levels);
+    level_mask &= ~level_bits(query.exclude_levels);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Newest segments first so a limited query can stop early
+    std::vector<const Segment*> candidates;
+    for (const auto& segment : segments_) {
+        if (may_match(segment->zone, query, level_mask)) {
+            candidates.push_back(segment.get());
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Segment* a, const Segment* b) { return a->zone.max_row_id > b->zone.max_row_id; });
+
+    struct Match {
+        uint64_t row_id;
+        const Segment* segment;
+        size_t row;
+    };
+    auto newer = [](const Match& a, const Match& b) { return a.row_id > b.row_id; };
+    std::vector<Match> matches;
+
+    for (const Segment* segment : candidates) {
+        if (query.limit > 0 && matches.size() >= query.limit) {
+            // Keep the newest `limit` matches, skip segments that are all older
+            std::nth_element(matches.begin(), matches.begin() + (query.limit - 1), matches.end(), newer);
+            matches.resize(query.limit);
+            const uint64_t oldest_kept = std::min_element(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+                return a.row_id < b.row_id;
+            })->row_id;
+            if (segment->zone.max_row_id < oldest_kept) {
+                break;
+            }
+        }
+        for (size_t row = 0; row < segment->zone.row_count; ++row) {
+            if ((level_mask & (1u << segment->dictionary_levels[segment->level_codes[row]])) == 0) continue;
+            if (query.template_id && segment->template_ids[row] != *query.template_id) continue;
+            if (query.since_ms || query.until_ms) {
+                const int64_t timestamp = segment->timestamps[row];
+                if (timestamp == kNoTimestamp) continue;
+                if (query.since_ms && timestamp < *query.since_ms) continue;
+                if (query.until_ms && timestamp > *query.until_ms) continue;
+            }
+            matches.push_back({segment->row_ids[row], segment, row});
+        }
+    }
+
+    std::sort(matches.begin(), matches.end(), newer);
+    if (query.limit > 0 && matches.size() > query.limit) {
+        matches.resize(query.limit);
+    }
+
+    std::vector<StoredRecord> records;
+    records.reserve(matches.size());
+    for (const auto& match : matches) {
+        records.push_back(match.segment->read(match.row));
+    }
+    return records;
+}
+
+void SegmentStore::mark_complete(const std::string& source_tag) {
+    flush();
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ofstream out(fs::path(config_.directory) / kCompleteMarker, std::ios::trunc);
+    out << source_tag;
+    if (!out) {
+        throw std::runtime_error("Failed to write completion marker in " + config_.directory);
+    }
+}
+
+std::string SegmentStore::completed_source() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (missing_segments_) {
+        return "";
+    }
+    std::ifstream in(fs::path(config_.directory) / kCompleteMarker);
+    std::string tag;
+    std::getline(in, tag);
+    return tag;
+}
+
+void SegmentStore::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.clear();
+    segments_.clear();
+    // Unreadable segments go too
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(config_.directory, ec)) {
+        if (entry.path().extension() == kSegmentExtension) {
+            std::error_code remove_ec;
+            fs::remove(entry.path(), remove_ec);
+        }
+    }
+    fs::remove(fs::path(config_.directory) / kCompleteMarker, ec);
+    missing_segments_ = false;
+    next_segment_seq_ = 0;
+}
+
+size_t SegmentStore::segment_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return segments_.size();
+}
+
+uint64_t SegmentStore::row_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t rows = 0;
+    for (const auto& segment : segments_) {
+        rows += segment->zone.row_count;
+    }
+    return rows;
+}
+
+} // namespace logai
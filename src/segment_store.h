@@ -0,0 +1,157 @@
+/**
+ * @file segment_store.h
+ * @brief Append-only, time-partitioned columnar store for parsed log records
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "log_level.h"
+#include "log_record.h"
+#include "memory_mapped_file.h"
+
+namespace logai {
+
+/**
+ * @brief Configuration for the SegmentStore
+ */
+struct SegmentStoreConfig {
+    std::string directory;                          ///< Directory holding the segment files
+    int64_t partition_ms = 60 * 60 * 1000;          ///< Time span of one partition
+    size_t max_rows_per_segment = 65536;            ///< Rows buffered per partition before a segment is written
+    size_t max_segment_bytes = 64 * 1024 * 1024;    ///< Text bytes buffered per partition before a segment is written
+};
+
+/**
+ * @brief Per-segment summary used to skip segments without reading them
+ */
+struct SegmentZoneMap {
+    uint64_t row_count = 0;
+    uint64_t min_row_id = 0;
+    uint64_t max_row_id = 0;
+    int64_t min_timestamp_ms = 0;   ///< Over rows with a timestamp
+    int64_t max_timestamp_ms = 0;   ///< Over rows with a timestamp
+    bool has_timestamps = false;    ///< At least one row has a timestamp
+    bool has_untimestamped = false; ///< At least one row has no timestamp
+    uint32_t level_mask = 0;        ///< Bit i set if a row has LogLevel i
+    int32_t min_template_id = 0;    ///< Over rows with a template ID
+    int32_t max_template_id = -1;   ///< Below min_template_id if no row has one
+};
+
+/**
+ * @brief Row filter; unset members match everything
+ */
+struct SegmentQuery {
+    std::optional<int64_t> since_ms;       ///< Inclusive lower timestamp bound
+    std::optional<int64_t> until_ms;       ///< Inclusive upper timestamp bound
+    std::vector<LogLevel> levels;          ///< Keep only these levels
+    std::vector<LogLevel> exclude_levels;  ///< Drop these levels
+    std::optional<int> template_id;        ///< Keep only this template
+    size_t limit = 0;                      ///< Most recent rows to return, 0 = all
+};
+
+/**
+ * @brief One row read back from the store
+ */
+struct StoredRecord {
+    uint64_t row_id = 0;
+    std::optional<int64_t> timestamp_ms;
+    std::string level;
+    int template_id = -1;
+    std::string message;
+};
+
+/**
+ * @brief Writes parsed batches as immutable columnar segment files and queries them
+ *
+ * Rows are grouped by the time partition of their timestamp (rows without
+ * one share a partition) and written once a partition has buffered enough.
+ * Each segment file starts with a zone map (row ID, timestamp, level and
+ * template ID ranges) followed by one column per field. Levels are
+ * dictionary-encoded per segment: a 32-bit code per row and each distinct
+ * level text once. Segments are
+ * memory-mapped for reading and skipped when their zone map cannot match a
+ * query. Existing segments in the directory are picked up on construction,
+ * so an earlier ingest can be reused. Thread-safe.
+ */
+class SegmentStore {
+public:
+    /**
+     * @brief Open (or create) a store directory
+     *
+     * @param config Directory and partitioning settings
+     * @throws std::runtime_error if the directory cannot be created
+     */
+    explicit SegmentStore(const SegmentStoreConfig& config);
+    ~SegmentStore();
+
+    SegmentStore(const SegmentStore&) = delete;
+    SegmentStore& operator=(const SegmentStore&) = delete;
+
+    /**
+     * @brief Buffer a parsed batch as rows first_row_id, first_row_id + 1, ...
+     *
+     * The template ID is read from the cluster_id field; the message is
+     * stored, or the body when the message is empty.
+     *
+     * @throws std::runtime_error if a segment cannot be written
+     */
+    void append(uint64_t first_row_id, const std::vector<LogRecordObject>& records);
+
+    /**
+     * @brief Write all buffered rows as segments
+     *
+     * @throws std::runtime_error if a segment cannot be written
+     */
+    void flush();
+
+    /**
+     * @brief Rows matching a query, most recent (highest row ID) first
+     *
+     * Only written segments are searched; call flush() first.
+     */
+    std::vector<StoredRecord> query(const SegmentQuery& query) const;
+
+    /**
+     * @brief Flush and record the identity of the fully ingested source
+     */
+    void mark_complete(const std::string& source_tag);
+
+    /**
+     * @brief Source tag recorded by mark_complete(), empty if ingest never completed
+     *
+     * Also empty if a segment of the directory could not be read, e.g. one
+     * written in an older format, so that the source is ingested again.
+     */
+    std::string completed_source() const;
+
+    /**
+     * @brief Delete all segments, readable or not, and the completion marker
+     */
+    void reset();
+
+    size_t segment_count() const;
+    uint64_t row_count() const;
+
+private:
+    struct Segment;
+    struct PartitionBuffer;
+
+    void load_existing();
+    void write_segment(int64_t partition, PartitionBuffer& buffer);
+    bool may_match(const SegmentZoneMap& zone, const SegmentQuery& query, uint32_t level_mask) const;
+
+    SegmentStoreConfig config_;
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<Segment>> segments_;
+    std::map<int64_t, std::unique_ptr<PartitionBuffer>> buffers_;
+    uint64_t next_segment_seq_ = 0;
+    bool missing_segments_ = false;  // load_existing() skipped a segment file
+};
+
+} // namespace logai
@@ -47,6 +47,18 @@ namespace {
 
 LogParser::LogEntry SyslogParser::parse(const std::string& line) {
     LogEntry entry;
+    parse_into(line, entry, false);
+    return entry;
+}
+
+ParseStatus SyslogParser::try_parse(const std::string& line, LogEntry& entry) noexcept {
+    // One priority search and one match, where validate() then parse() did both twice
+    return guarded([&] {
+        return parse_into(line, entry, true) ? ParseStatus::Ok : ParseStatus::Malformed;
+    });
+}
+
+bool SyslogParser::parse_into(const std::string& line, LogEntry& entry, bool strict) {
     std::smatch match;
     
     // First try to extract priority if present
@@ -56,15 +68,19 @@ LogParser::LogEntry SyslogParser::parse(const std::string& line) {
         int facility = priority >> 3;
         int severity = priority & 0x7;
         
-        entry.fields["facility"] = facility_map.count(facility) ? 
-            facility_map.at(facility) : std::to_string(facility);
+        entry.fields.set(FieldSchema::kFacility, facility_map.count(facility) ?
+            facility_map.at(facility) : std::to_string(facility));
         entry.level = severity_map.count(severity) ? 
             severity_map.at(severity) : std::to_string(severity);
             
         message = message.substr(match[0].length());
     }
     
-    if (std::regex_match(message, match, syslog_regex)) {
+    const bool matched = std::regex_match(message, match, syslog_regex);
+    if (!matched && strict) {
+        return false;
+    }
+    if (matched) {
         // Parse timestamp
         std::string timestamp = match[1].matched ? match[1].str() : match[2].str();
         if (!timestamp.empty()) {
@@ -94,7 +110,7 @@ LogParser::LogEntry SyslogParser::parse(const std::string& line) {
         
         // Parse hostname/IP
         if (match[3].matched) {
-            entry.fields["host"] = match[3].str();
+            entry.fields.set(FieldSchema::kHost, match[3].str());
         }
         
         // Parse program[pid]
@@ -102,13 +118,13 @@ LogParser::LogEntry SyslogParser::parse(const std::string& line) {
             std::string prog = match[4].str();
             size_t pid_start = prog.find('[');
             if (pid_start != std::string::npos) {
-                entry.fields["program"] = prog.substr(0, pid_start);
+                entry.fields.set(FieldSchema::kProgram, prog.substr(0, pid_start));
                 size_t pid_end = prog.find(']');
                 if (pid_end != std::string::npos) {
-                    entry.fields["pid"] = prog.substr(pid_start + 1, pid_end - pid_start - 1);
+                    entry.fields.set(FieldSchema::kPid, prog.substr(pid_start + 1, pid_end - pid_start - 1));
                 }
             } else {
-                entry.fields["program"] = prog;
+                entry.fields.set(FieldSchema::kProgram, prog);
             }
         }
         
@@ -139,7 +155,7 @@ LogParser::LogEntry SyslogParser::parse(const std::string& line) {
         entry.timestamp = ss.str();
     }
     
-    return entry;
+    return matched;
 }
 
 bool SyslogParser::validate(const std::string& line) {
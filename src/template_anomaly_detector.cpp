@@ -0,0 +1,267 @@
+#include "template_anomaly_detector.h"
+#include "timestamp_utils.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+namespace logai {
+
+namespace {
+
+constexpr int64_t kMillisPerHour = 60 * 60 * 1000;
+constexpr int64_t kMillisPerDay = 24 * kMillisPerHour;
+
+int64_t floor_div(int64_t value, int64_t divisor) {
+    int64_t quotient = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+}
+
+} // namespace
+
+const char* anomaly_type_name(AnomalyType type) {
+    switch (type) {
+        case AnomalyType::NewTemplate: return "new_template";
+        case AnomalyType::VanishedTemplate: return "vanished_template";
+        case AnomalyType::Spike: return "spike";
+        case AnomalyType::Drop: return "drop";
+    }
+    return "unknown";
+}
+
+TemplateAnomalyDetector::TemplateAnomalyDetector(const AnomalyDetectorConfig& config)
+    : config_(config) {
+    config_.interval_ms = std::max<int64_t>(config_.interval_ms, 1);
+    config_.ewma_alpha = std::clamp(config_.ewma_alpha, 0.001, 1.0);
+    config_.warmup_intervals = std::max<size_t>(config_.warmup_intervals, 1);
+    config_.vanish_intervals = std::max<size_t>(config_.vanish_intervals, 1);
+    config_.max_anomalies = std::max<size_t>(config_.max_anomalies, 1);
+}
+
+void TemplateAnomalyDetector::observe(int cluster_id, int64_t timestamp_ms, uint64_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    observe_locked(cluster_id, timestamp_ms, count);
+}
+
+void TemplateAnomalyDetector::observe_batch(const std::vector<LogRecordObject>& records) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& record : records) {
+        const auto* cluster_field = record.fields.find(FieldSchema::kClusterId);
+        if (!cluster_field) {
+            continue;
+        }
+        int cluster_id = -1;
+        const char* first = cluster_field->data();
+        const char* last = first + cluster_field->size();
+        if (std::from_chars(first, last, cluster_id).ec != std::errc() || cluster_id < 0) {
+            continue;
+        }
+
+        // An undated line (a banner, a stack trace) has no interval of its own; the wall
+        // clock would pin a historical file's interval to today
+        int64_t timestamp_ms;
+        if (record.timestamp) {
+            timestamp_ms = millis_from_time_point(*record.timestamp);
+        } else if (open_interval_) {
+            timestamp_ms = latest_timestamp_ms_;
+        } else {
+            continue;
+        }
+        observe_locked(cluster_id, timestamp_ms, 1);
+    }
+}
+
+void TemplateAnomalyDetector::observe_locked(int cluster_id, int64_t timestamp_ms, uint64_t count) {
+    const int64_t interval = floor_div(timestamp_ms, config_.interval_ms);
+    if (!open_interval_) {
+        open_interval_ = interval;
+    } else if (interval > *open_interval_) {
+        advance_to(interval);
+    }
+    // else: late event, counted into the open interval
+    latest_timestamp_ms_ = std::max(latest_timestamp_ms_, timestamp_ms);
+
+    auto [it, inserted] = templates_.try_emplace(cluster_id);
+    if (inserted) {
+        opened_templates_.push_back(cluster_id);
+    }
+    it->second.open_count += count;
+}
+
+void TemplateAnomalyDetector::advance_to(int64_t interval) {
+    close_interval(*open_interval_, true);
+
+    // Evaluate a bounded number of empty intervals in between, skip the rest
+    const int64_t gap_end = std::min(interval, *open_interval_ + 1 + static_cast<int64_t>(config_.max_gap_intervals));
+    for (int64_t empty = *open_interval_ + 1; empty < gap_end; ++empty) {
+        close_interval(empty, true);
+    }
+    open_interval_ = interval;
+}
+
+void TemplateAnomalyDetector::close_interval(int64_t interval, bool complete) {
+    if (closed_intervals_ >= config_.warmup_intervals) {
+        for (int cluster_id : opened_templates_) {
+            const uint64_t observed = templates_[cluster_id].open_count;
+            raise(AnomalyType::NewTemplate, cluster_id, interval, observed, 0.0, 0.0);
+        }
+    }
+    opened_templates_.clear();
+
+    for (auto& [cluster_id, state] : templates_) {
+        evaluate(cluster_id, state, interval, complete);
+        state.open_count = 0;
+    }
+    if (complete) {
+        ++closed_intervals_;
+    }
+}
+
+void TemplateAnomalyDetector::evaluate(int cluster_id, TemplateState& state, int64_t interval, bool complete) {
+    const int64_t start_ms = interval * config_.interval_ms;
+    const int64_t day = floor_div(start_ms, kMillisPerDay);
+    const size_t slot = static_cast<size_t>(floor_div(start_ms, kMillisPerHour) - day * 24);
+    const double observed = static_cast<double>(state.open_count);
+    Baseline& hourly = state.hourly[slot];
+
+    if (auto anomaly = outlier(cluster_id, state, interval, complete)) {
+        raise(anomaly->type, cluster_id, interval, anomaly->observed, anomaly->expected, anomaly->score);
+    }
+
+    if (!complete) {
+        return;
+    }
+
+    if (state.open_count == 0) {
+        if (state.empty_streak == 0) {
+            state.active_mean = state.overall.mean;
+        }
+        ++state.empty_streak;
+        if (!state.vanished && state.empty_streak >= config_.vanish_intervals &&
+            state.overall.samples >= config_.warmup_intervals && state.active_mean >= config_.min_vanish_rate) {
+            raise(AnomalyType::VanishedTemplate, cluster_id, interval, 0, state.active_mean, 0.0);
+            state.vanished = true;
+        }
+    } else {
+        state.empty_streak = 0;
+        state.vanished = false;
+    }
+
+    update_baseline(state.overall, observed);
+    update_baseline(hourly, observed);
+    if (hourly.last_day != day) {
+        hourly.last_day = day;
+        ++hourly.days;
+    }
+}
+
+void TemplateAnomalyDetector::update_baseline(Baseline& baseline, double value) const {
+    if (baseline.samples == 0) {
+        baseline.mean = value;
+        baseline.variance = 0.0;
+    } else {
+        // Incremental EWMA mean and variance
+        const double diff = value - baseline.mean;
+        const double increment = config_.ewma_alpha * diff;
+        baseline.mean += increment;
+        baseline.variance = (1.0 - config_.ewma_alpha) * (baseline.variance + diff * increment);
+    }
+    if (baseline.samples < UINT32_MAX) {
+        ++baseline.samples;
+    }
+}
+
+std::optional<TemplateAnomaly> TemplateAnomalyDetector::outlier(int cluster_id, const TemplateState& state,
+                                                                int64_t interval, bool complete) const {
+    const int64_t start_ms = interval * config_.interval_ms;
+    const int64_t day = floor_div(start_ms, kMillisPerDay);
+    const size_t slot = static_cast<size_t>(floor_div(start_ms, kMillisPerHour) - day * 24);
+    const double observed = static_cast<double>(state.open_count);
+
+    // Hour-of-day baseline once it has seen that hour on an earlier day
+    const Baseline& hourly = state.hourly[slot];
+    const bool use_hourly = config_.seasonal && hourly.days >= 2 && hourly.samples >= config_.warmup_intervals;
+    const Baseline& baseline = use_hourly ? hourly : state.overall;
+    if (baseline.samples < config_.warmup_intervals) {
+        return std::nullopt;
+    }
+
+    // Counts are at least Poisson-noisy, never trust a variance below the mean
+    const double sd = std::sqrt(std::max({baseline.variance, baseline.mean, 1.0}));
+    const double delta = observed - baseline.mean;
+    const double z = delta / sd;
+    if (z >= config_.z_threshold && delta >= config_.min_count_delta) {
+        return make_anomaly(AnomalyType::Spike, cluster_id, interval, state.open_count, baseline.mean, z);
+    }
+    if (complete && z <= -config_.z_threshold && -delta >= config_.min_count_delta) {
+        return make_anomaly(AnomalyType::Drop, cluster_id, interval, state.open_count, baseline.mean, z);
+    }
+    return std::nullopt;
+}
+
+TemplateAnomaly TemplateAnomalyDetector::make_anomaly(AnomalyType type, int cluster_id, int64_t interval,
+                                                      uint64_t observed, double expected, double score) const {
+    TemplateAnomaly anomaly;
+    anomaly.type = type;
+    anomaly.cluster_id = cluster_id;
+    anomaly.interval_start_ms = interval * config_.interval_ms;
+    anomaly.observed = observed;
+    anomaly.expected = expected;
+    anomaly.score = score;
+    return anomaly;
+}
+
+void TemplateAnomalyDetector::raise(AnomalyType type, int cluster_id, int64_t interval, uint64_t observed,
+                                    double expected, double score) {
+    anomalies_.push_back(make_anomaly(type, cluster_id, interval, observed, expected, score));
+    if (anomalies_.size() > config_.max_anomalies) {
+        anomalies_.pop_front();
+    }
+}
+
+void TemplateAnomalyDetector::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (open_interval_) {
+        close_interval(*open_interval_, false);
+        open_interval_.reset();
+    }
+}
+
+std::vector<TemplateAnomaly> TemplateAnomalyDetector::anomalies() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<TemplateAnomaly> result(anomalies_.begin(), anomalies_.end());
+    if (!open_interval_) {
+        return result;
+    }
+
+    // What flush() would raise for the open interval, which keeps counting
+    if (closed_intervals_ >= config_.warmup_intervals) {
+        for (int cluster_id : opened_templates_) {
+            result.push_back(make_anomaly(AnomalyType::NewTemplate, cluster_id, *open_interval_,
+                                          templates_.at(cluster_id).open_count, 0.0, 0.0));
+        }
+    }
+    for (const auto& [cluster_id, state] : templates_) {
+        if (auto anomaly = outlier(cluster_id, state, *open_interval_, false)) {
+            result.push_back(*anomaly);
+        }
+    }
+    return result;
+}
+
+size_t TemplateAnomalyDetector::template_count() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return templates_.size();
+}
+
+void TemplateAnomalyDetector::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    templates_.clear();
+    opened_templates_.clear();
+    open_interval_.reset();
+    closed_intervals_ = 0;
+    latest_timestamp_ms_ = 0;
+    anomalies_.clear();
+}
+
+} // namespace logai
@@ -0,0 +1,164 @@
+/**
+ * @file template_anomaly_detector.h
+ * @brief Incremental anomaly detection over per-template occurrence counts
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include <folly/container/F14Map.h>
+#include "log_record.h"
+
+namespace logai {
+
+/**
+ * @brief Kind of anomaly raised for a template
+ */
+enum class AnomalyType : uint8_t {
+    NewTemplate = 0,   ///< Template first seen after the warm-up period
+    VanishedTemplate,  ///< Previously steady template absent for several intervals
+    Spike,             ///< Interval count far above the baseline
+    Drop               ///< Interval count far below the baseline
+};
+
+const char* anomaly_type_name(AnomalyType type);
+
+/**
+ * @brief Configuration for the TemplateAnomalyDetector
+ */
+struct AnomalyDetectorConfig {
+    int64_t interval_ms = 60 * 1000;  ///< Width of the intervals counts are evaluated on
+    double ewma_alpha = 0.2;          ///< Smoothing factor of the baselines
+    double z_threshold = 3.5;         ///< |z-score| above which an interval is an outlier
+    double min_count_delta = 5.0;     ///< Minimum |observed - expected| for an outlier
+    size_t warmup_intervals = 5;      ///< Intervals of history before anything is flagged
+    size_t vanish_intervals = 5;      ///< Empty intervals before a steady template is flagged vanished
+    double min_vanish_rate = 1.0;     ///< Baseline count per interval a template needs to be able to vanish
+    bool seasonal = true;             ///< Use hour-of-day baselines once they have enough samples
+    size_t max_gap_intervals = 60;    ///< Empty intervals evaluated when the stream jumps ahead in time
+    size_t max_anomalies = 10000;     ///< Most recent anomalies retained
+};
+
+/**
+ * @brief One anomaly raised for a template in one interval
+ */
+struct TemplateAnomaly {
+    AnomalyType type = AnomalyType::Spike;
+    int cluster_id = -1;
+    int64_t interval_start_ms = 0;
+    uint64_t observed = 0;  ///< Count in the interval
+    double expected = 0.0;  ///< Baseline count for the interval
+    double score = 0.0;     ///< z-score for spikes and drops, 0 otherwise
+};
+
+/**
+ * @brief Flags new, vanished and outlier templates from streamed per-template counts
+ *
+ * Counts are accumulated per interval. When the stream moves past an
+ * interval, every known template is scored against an EWMA mean/variance
+ * baseline, or against its hour-of-day baseline once that has enough
+ * samples. State is a fixed-size record per template, so memory is bounded
+ * by the number of templates. Thread-safe.
+ */
+class TemplateAnomalyDetector {
+public:
+    /**
+     * @brief Construct a new TemplateAnomalyDetector object
+     *
+     * @param config Interval width, baseline and threshold settings
+     */
+    explicit TemplateAnomalyDetector(const AnomalyDetectorConfig& config = AnomalyDetectorConfig());
+
+    /**
+     * @brief Count occurrences of a template
+     *
+     * Events older than the open interval are counted into the open interval.
+     *
+     * @param cluster_id Template (DRAIN cluster) ID
+     * @param timestamp_ms Event time in epoch milliseconds
+     * @param count Number of occurrences
+     */
+    void observe(int cluster_id, int64_t timestamp_ms, uint64_t count = 1);
+
+    /**
+     * @brief Count every record of a parsed batch that carries a cluster_id field
+     *
+     * Records without a timestamp are counted at the latest timestamp seen,
+     * and skipped until a timestamped record has opened an interval.
+     */
+    void observe_batch(const std::vector<LogRecordObject>& records);
+
+    /**
+     * @brief Evaluate and close the open interval at end of stream
+     *
+     * The interval is usually incomplete, so it is only checked for new
+     * templates and spikes. A stream that may continue later (an
+     * incremental load) leaves the interval open instead.
+     */
+    void flush();
+
+    /**
+     * @brief Anomalies raised so far, oldest first
+     *
+     * Followed by the new templates and spikes the open interval shows so
+     * far, without closing it.
+     */
+    std::vector<TemplateAnomaly> anomalies() const;
+
+    /**
+     * @brief Number of templates the detector keeps state for
+     */
+    size_t template_count() const;
+
+    /**
+     * @brief Drop all state and anomalies
+     */
+    void clear();
+
+private:
+    static constexpr size_t kSeasonSlots = 24;
+
+    struct Baseline {
+        double mean = 0.0;
+        double variance = 0.0;
+        uint32_t samples = 0;
+        uint32_t days = 0;        // Distinct days sampled (hour-of-day baselines only)
+        int64_t last_day = INT64_MIN;
+    };
+
+    struct TemplateState {
+        uint64_t open_count = 0;          // Count in the open interval
+        Baseline overall;
+        std::array<Baseline, kSeasonSlots> hourly;
+        uint32_t empty_streak = 0;        // Consecutive empty intervals
+        double active_mean = 0.0;         // Baseline mean when the empty streak began
+        bool vanished = false;
+    };
+
+    void observe_locked(int cluster_id, int64_t timestamp_ms, uint64_t count);
+    void advance_to(int64_t interval);
+    void close_interval(int64_t interval, bool complete);
+    void evaluate(int cluster_id, TemplateState& state, int64_t interval, bool complete);
+    std::optional<TemplateAnomaly> outlier(int cluster_id, const TemplateState& state, int64_t interval,
+                                           bool complete) const;
+    TemplateAnomaly make_anomaly(AnomalyType type, int cluster_id, int64_t interval, uint64_t observed,
+                                 double expected, double score) const;
+    void raise(AnomalyType type, int cluster_id, int64_t interval, uint64_t observed,
+               double expected, double score);
+    void update_baseline(Baseline& baseline, double value) const;
+
+    AnomalyDetectorConfig config_;
+    mutable std::mutex mutex_;
+    folly::F14FastMap<int, TemplateState> templates_;
+    std::vector<int> opened_templates_;   // Templates first seen in the open interval
+    std::optional<int64_t> open_interval_;
+    size_t closed_intervals_ = 0;
+    int64_t latest_timestamp_ms_ = 0;
+    std::deque<TemplateAnomaly> anomalies_;
+};
+
+} // namespace logai
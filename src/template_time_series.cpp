@@ -0,0 +1,202 @@
+#include "template_time_series.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace logai {
+
+namespace {
+
+// Round-robin shard assignment, fixed for the lifetime of a thread
+size_t thread_shard_slot() {
+    static std::atomic<size_t> next_slot{0};
+    thread_local size_t slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+int64_t floor_div(int64_t value, int64_t divisor) {
+    int64_t quotient = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? quotient - 1 : quotient;
+}
+
+} // namespace
+
+TemplateTimeSeries::TemplateTimeSeries(const TemplateTimeSeriesConfig& config)
+    : ring_sizes_{std::max<size_t>(config.second_buckets, 1),
+                  std::max<size_t>(config.minute_buckets, 1),
+                  std::max<size_t>(config.hour_buckets, 1)} {
+    size_t num_shards = config.num_shards > 0 ? config.num_shards : std::thread::hardware_concurrency();
+    num_shards = std::max<size_t>(num_shards, 1);
+    shards_.reserve(num_shards);
+    for (size_t i = 0; i < num_shards; ++i) {
+        shards_.push_back(std::make_unique<Shard>());
+    }
+}
+
+int64_t TemplateTimeSeries::bucket_width_ms(TimeResolution resolution) {
+    switch (resolution) {
+        case TimeResolution::Second: return 1000;
+        case TimeResolution::Minute: return 60 * 1000;
+        case TimeResolution::Hour: return 60 * 60 * 1000;
+    }
+    return 1000;
+}
+
+TemplateTimeSeries::Shard& TemplateTimeSeries::local_shard() {
+    return *shards_[thread_shard_slot() % shards_.size()];
+}
+
+void TemplateTimeSeries::record(int cluster_id, int64_t timestamp_ms, uint64_t count) {
+    Shard& shard = local_shard();
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        ClusterSeries& series = shard.series[cluster_id];
+        for (size_t r = 0; r < kTimeResolutionCount; ++r) {
+            auto& ring = series.rings[r];
+            if (ring.empty()) {
+                ring.resize(ring_sizes_[r]);
+            }
+            const int64_t epoch = floor_div(timestamp_ms, bucket_width_ms(static_cast<TimeResolution>(r)));
+            Bucket& bucket = ring[static_cast<size_t>(epoch) % ring.size()];
+            if (bucket.epoch == epoch) {
+                bucket.count += count;
+            } else if (bucket.epoch < epoch) {
+                // Slot last held an older bucket, recycle it
+                bucket.epoch = epoch;
+                bucket.count = count;
+            }
+            // else: event older than the ring covers, nothing to update
+        }
+    }
+
+    int64_t latest = latest_timestamp_ms_.load(std::memory_order_relaxed);
+    while (timestamp_ms > latest &&
+           !latest_timestamp_ms_.compare_exchange_weak(latest, timestamp_ms, std::memory_order_relaxed)) {
+    }
+}
+
+uint64_t TemplateTimeSeries::sum_ring(const std::vector<Bucket>& ring, int64_t first_epoch, int64_t last_epoch) {
+    if (ring.empty() || last_epoch < first_epoch) {
+        return 0;
+    }
+    // Never visit a slot twice when the range is longer than the ring
+    first_epoch = std::max(first_epoch, last_epoch - static_cast<int64_t>(ring.size()) + 1);
+
+    uint64_t total = 0;
+    for (int64_t epoch = first_epoch; epoch <= last_epoch; ++epoch) {
+        const Bucket& bucket = ring[static_cast<size_t>(epoch) % ring.size()];
+        if (bucket.epoch == epoch) {
+            total += bucket.count;
+        }
+    }
+    return total;
+}
+
+TimeResolution TemplateTimeSeries::resolution_for(int64_t start_ms, int64_t end_ms) const {
+    const int64_t span = end_ms - start_ms;
+    for (size_t r = 0; r < kTimeResolutionCount; ++r) {
+        const auto resolution = static_cast<TimeResolution>(r);
+        if (span <= bucket_width_ms(resolution) * static_cast<int64_t>(ring_sizes_[r])) {
+            return resolution;
+        }
+    }
+    return TimeResolution::Hour;
+}
+
+uint64_t TemplateTimeSeries::count_in_range(int cluster_id, int64_t start_ms, int64_t end_ms) const {
+    if (end_ms <= start_ms) {
+        return 0;
+    }
+    // The ring has to reach back from the newest data to start_ms
+    const int64_t newest = std::max(latest_timestamp_ms(), end_ms);
+    const TimeResolution resolution = resolution_for(start_ms, newest);
+    const size_t r = static_cast<size_t>(resolution);
+    const int64_t width = bucket_width_ms(resolution);
+    const int64_t first_epoch = floor_div(start_ms, width);
+    const int64_t last_epoch = floor_div(end_ms - 1, width);
+
+    uint64_t total = 0;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        auto it = shard->series.find(cluster_id);
+        if (it != shard->series.end()) {
+            total += sum_ring(it->second.rings[r], first_epoch, last_epoch);
+        }
+    }
+    return total;
+}
+
+std::vector<TemplateTrend> TemplateTimeSeries::top_k_rate_change(int64_t window_ms, size_t k,
+                                                                 std::optional<int64_t> now_ms) const {
+    std::vector<TemplateTrend> trends;
+    if (window_ms <= 0 || k == 0) {
+        return trends;
+    }
+
+    const int64_t end_ms = now_ms ? *now_ms : latest_timestamp_ms() + 1;
+    const int64_t mid_ms = end_ms - window_ms;
+    const int64_t start_ms = mid_ms - window_ms;
+    const int64_t newest = std::max(latest_timestamp_ms(), end_ms);
+    const TimeResolution resolution = resolution_for(start_ms, newest);
+    const size_t r = static_cast<size_t>(resolution);
+    const int64_t width = bucket_width_ms(resolution);
+    const int64_t first_epoch = floor_div(start_ms, width);
+    const int64_t mid_epoch = floor_div(mid_ms, width);
+    const int64_t last_epoch = floor_div(end_ms - 1, width);
+
+    // Merge shards: cluster_id -> (current, previous)
+    folly::F14FastMap<int, std::pair<uint64_t, uint64_t>> merged;
+    for (const auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        for (const auto& [cluster_id, series] : shard->series) {
+            const auto& ring = series.rings[r];
+            auto& counts = merged[cluster_id];
+            counts.first += sum_ring(ring, mid_epoch, last_epoch);
+            counts.second += sum_ring(ring, first_epoch, mid_epoch - 1);
+        }
+    }
+
+    const double window_seconds = static_cast<double>(window_ms) / 1000.0;
+    trends.reserve(merged.size());
+    for (const auto& [cluster_id, counts] : merged) {
+        if (counts.first == 0 && counts.second == 0) {
+            continue;
+        }
+        TemplateTrend trend;
+        trend.cluster_id = cluster_id;
+        trend.current_count = counts.first;
+        trend.previous_count = counts.second;
+        trend.current_rate = static_cast<double>(counts.first) / window_seconds;
+        trend.previous_rate = static_cast<double>(counts.second) / window_seconds;
+        trend.relative_change = (static_cast<double>(counts.first) - static_cast<double>(counts.second)) /
+                                (static_cast<double>(counts.second) + 1.0);
+        trends.push_back(trend);
+    }
+
+    auto by_change = [](const TemplateTrend& a, const TemplateTrend& b) {
+        if (a.relative_change != b.relative_change) return a.relative_change > b.relative_change;
+        if (a.current_count != b.current_count) return a.current_count > b.current_count;
+        return a.cluster_id < b.cluster_id;
+    };
+    if (trends.size() > k) {
+        std::partial_sort(trends.begin(), trends.begin() + k, trends.end(), by_change);
+        trends.resize(k);
+    } else {
+        std::sort(trends.begin(), trends.end(), by_change);
+    }
+    return trends;
+}
+
+int64_t TemplateTimeSeries::latest_timestamp_ms() const {
+    return latest_timestamp_ms_.load(std::memory_order_relaxed);
+}
+
+void TemplateTimeSeries::clear() {
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->series.clear();
+    }
+    latest_timestamp_ms_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace logai
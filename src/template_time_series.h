@@ -0,0 +1,133 @@
+/**
+ * @file template_time_series.h
+ * @brief Streaming per-template counts in fixed-width time buckets
+ */
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include <folly/container/F14Map.h>
+
+namespace logai {
+
+/**
+ * @brief Bucket width of a time series ring
+ */
+enum class TimeResolution : uint8_t {
+    Second = 0,
+    Minute,
+    Hour
+};
+
+constexpr size_t kTimeResolutionCount = 3;
+
+/**
+ * @brief Configuration for the TemplateTimeSeries
+ */
+struct TemplateTimeSeriesConfig {
+    size_t second_buckets = 120;  ///< Ring length at 1 s resolution
+    size_t minute_buckets = 120;  ///< Ring length at 1 min resolution
+    size_t hour_buckets = 48;     ///< Ring length at 1 h resolution
+    size_t num_shards = 0;        ///< Writer shards, 0 = hardware concurrency
+};
+
+/**
+ * @brief Rate change of one template between two adjacent windows
+ */
+struct TemplateTrend {
+    int cluster_id = -1;
+    uint64_t current_count = 0;   ///< Occurrences in [now - window, now)
+    uint64_t previous_count = 0;  ///< Occurrences in [now - 2 * window, now - window)
+    double current_rate = 0.0;    ///< Occurrences per second in the current window
+    double previous_rate = 0.0;   ///< Occurrences per second in the previous window
+    double relative_change = 0.0; ///< (current - previous) / (previous + 1)
+};
+
+/**
+ * @brief Per-template occurrence counts bucketed at 1 s, 1 min and 1 h
+ *
+ * Each template keeps one ring buffer of buckets per resolution, so an update
+ * is O(1) and memory is bounded by the number of templates. Writers are
+ * spread over shards (one per thread in practice) and shards are merged when
+ * queried.
+ */
+class TemplateTimeSeries {
+public:
+    /**
+     * @brief Construct a new TemplateTimeSeries object
+     *
+     * @param config Ring lengths and shard count
+     */
+    explicit TemplateTimeSeries(const TemplateTimeSeriesConfig& config = TemplateTimeSeriesConfig());
+
+    /**
+     * @brief Record occurrences of a template (thread-safe)
+     *
+     * @param cluster_id Template (DRAIN cluster) ID
+     * @param timestamp_ms Event time in epoch milliseconds
+     * @param count Number of occurrences
+     */
+    void record(int cluster_id, int64_t timestamp_ms, uint64_t count = 1);
+
+    /**
+     * @brief Count occurrences of a template in [start_ms, end_ms)
+     *
+     * Uses the finest resolution whose ring still covers start_ms. Buckets
+     * partially overlapping the range are counted in full.
+     */
+    uint64_t count_in_range(int cluster_id, int64_t start_ms, int64_t end_ms) const;
+
+    /**
+     * @brief Templates whose rate changed the most between the last two windows
+     *
+     * @param window_ms Window length in milliseconds
+     * @param k Maximum number of templates to return
+     * @param now_ms End of the current window, defaults to the latest recorded timestamp
+     * @return std::vector<TemplateTrend> Templates sorted by relative change, largest first
+     */
+    std::vector<TemplateTrend> top_k_rate_change(int64_t window_ms, size_t k,
+                                                 std::optional<int64_t> now_ms = std::nullopt) const;
+
+    /**
+     * @brief Latest event timestamp recorded so far, 0 if empty
+     */
+    int64_t latest_timestamp_ms() const;
+
+    /**
+     * @brief Drop all recorded counts
+     */
+    void clear();
+
+private:
+    struct Bucket {
+        int64_t epoch = -1;  // Absolute bucket index (timestamp / width)
+        uint64_t count = 0;
+    };
+
+    struct ClusterSeries {
+        std::array<std::vector<Bucket>, kTimeResolutionCount> rings;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        folly::F14FastMap<int, ClusterSeries> series;
+    };
+
+    static int64_t bucket_width_ms(TimeResolution resolution);
+    TimeResolution resolution_for(int64_t start_ms, int64_t end_ms) const;
+    Shard& local_shard();
+
+    // Sum of buckets [first_epoch, last_epoch] of one ring
+    static uint64_t sum_ring(const std::vector<Bucket>& ring, int64_t first_epoch, int64_t last_epoch);
+
+    std::array<size_t, kTimeResolutionCount> ring_sizes_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<int64_t> latest_timestamp_ms_{0};
+};
+
+} // namespace logai
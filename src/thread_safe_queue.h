@@ -4,6 +4,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <chrono>
 
 namespace logai {
 
@@ -39,6 +40,17 @@ public:
         return true;
     }
     
+    template<typename Rep, typename Period>
+    bool wait_and_pop_for(T& value, const std::chrono::duration<Rep, Period>& timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!condition_.wait_for(lock, timeout, [this] { return !queue_.empty() || done_; }) || queue_.empty()) {
+            return false;
+        }
+        value = std::move(queue_.front());
+        queue_.pop();
+        return true;
+    }
+    
     void done() {
         std::lock_guard<std::mutex> lock(mutex_);
         done_ = true;
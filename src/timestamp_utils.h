@@ -0,0 +1,147 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace logai {
+
+/**
+ * @brief Days since 1970-01-01 for a proleptic Gregorian date
+ */
+inline int64_t days_from_civil(int64_t year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+/**
+ * @brief Parse a leading "YYYY-MM-DD[T ]HH:MM:SS[.fff][Z|+hh[:]mm]" timestamp
+ *
+ * '/' is accepted as date separator. Timestamps without an offset are taken
+ * as UTC. Allocation-free, intended for per-line use on the parse hot path.
+ *
+ * @param text Text starting with the timestamp (a leading '[' is skipped)
+ * @return Milliseconds since the Unix epoch, or std::nullopt if text does not start with a timestamp
+ */
+inline std::optional<int64_t> parse_epoch_millis(std::string_view text) {
+    size_t pos = 0;
+    if (pos < text.size() && text[pos] == '[') ++pos;
+
+    auto number = [&](size_t width, int64_t& out) {
+        if (pos + width > text.size()) return false;
+        out = 0;
+        for (size_t i = 0; i < width; ++i) {
+            char c = text[pos + i];
+            if (c < '0' || c > '9') return false;
+            out = out * 10 + (c - '0');
+        }
+        pos += width;
+        return true;
+    };
+    auto separator = [&](char a, char b) {
+        if (pos < text.size() && (text[pos] == a || text[pos] == b)) {
+            ++pos;
+            return true;
+        }
+        return false;
+    };
+
+    int64_t year, month, day, hour, minute, second;
+    if (!number(4, year) || !separator('-', '/') || !number(2, month) || !separator('-', '/') ||
+        !number(2, day) || !separator('T', ' ') || !number(2, hour) || !separator(':', ':') ||
+        !number(2, minute) || !separator(':', ':') || !number(2, second)) {
+        return std::nullopt;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        return std::nullopt;
+    }
+
+    int64_t millis = 0;
+    if (pos < text.size() && (text[pos] == '.' || text[pos] == ',')) {
+        ++pos;
+        int64_t scale = 100;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9') {
+            millis += (text[pos] - '0') * scale;
+            scale /= 10;
+            ++pos;
+        }
+    }
+
+    int64_t offset_minutes = 0;
+    if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+        const int64_t sign = text[pos] == '-' ? -1 : 1;
+        ++pos;
+        int64_t offset_hours, offset_mins;
+        if (number(2, offset_hours)) {
+            separator(':', ':');
+            if (number(2, offset_mins)) {
+                offset_minutes = sign * (offset_hours * 60 + offset_mins);
+            }
+        }
+    }
+
+    const int64_t days = days_from_civil(year, static_cast<unsigned>(month), static_cast<unsigned>(day));
+    const int64_t seconds = days * 86400 + hour * 3600 + minute * 60 + second - offset_minutes * 60;
+    return seconds * 1000 + millis;
+}
+
+inline std::chrono::system_clock::time_point time_point_from_millis(int64_t millis) {
+    return std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::milliseconds(millis)));
+}
+
+inline int64_t millis_from_time_point(std::chrono::system_clock::time_point tp) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(tp.time_since_epoch()).count();
+}
+
+inline int64_t now_epoch_millis() {
+    return millis_from_time_point(std::chrono::system_clock::now());
+}
+
+/**
+ * @brief Format milliseconds since the Unix epoch as "YYYY-MM-DDTHH:MM:SS.fffZ"
+ *
+ * The inverse of parse_epoch_millis() for years 0000-9999.
+ */
+inline std::string format_epoch_millis(int64_t millis) {
+    int64_t days = millis / 86400000;
+    int64_t ms_of_day = millis % 86400000;
+    if (ms_of_day < 0) {
+        ms_of_day += 86400000;
+        --days;
+    }
+
+    // Civil date from days since 1970-01-01, inverting days_from_civil()
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned day = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned month = mp < 10 ? mp + 3 : mp - 9;
+    const int64_t year = static_cast<int64_t>(yoe) + era * 400 + (month <= 2);
+
+    std::string text = "0000-00-00T00:00:00.000Z";
+    auto put = [&](size_t pos, size_t width, int64_t value) {
+        for (size_t i = width; i-- > 0; value /= 10) {
+            text[pos + i] = static_cast<char>('0' + value % 10);
+        }
+    };
+    put(0, 4, year);
+    put(5, 2, month);
+    put(8, 2, day);
+    put(11, 2, ms_of_day / 3600000);
+    put(14, 2, ms_of_day / 60000 % 60);
+    put(17, 2, ms_of_day / 1000 % 60);
+    put(20, 3, ms_of_day % 1000);
+    return text;
+}
+
+} // namespace logai
@@ -0,0 +1,318 @@
+#include "uring_file_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+namespace logai {
+
+namespace {
+
+constexpr size_t kAlignment = 4096;  // O_DIRECT offset, length and buffer alignment
+
+int uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+std::string errno_message(int error) {
+    return std::strerror(error);
+}
+
+} // namespace
+
+// The mapped submission and completion queues of one io_uring
+struct UringFileReader::Ring {
+    int fd = -1;
+    void* sq_ring = MAP_FAILED;
+    size_t sq_ring_size = 0;
+    void* cq_ring = MAP_FAILED;
+    size_t cq_ring_size = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqes_size = 0;
+
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+    unsigned to_submit = 0;
+
+    explicit Ring(unsigned entries) {
+        io_uring_params params{};
+        fd = uring_setup(entries, &params);
+        if (fd < 0) {
+            throw std::runtime_error("io_uring_setup failed: " + errno_message(errno));
+        }
+
+        sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+            sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+        }
+        sq_ring = mmap(nullptr, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                       IORING_OFF_SQ_RING);
+        cq_ring = single_mmap ? sq_ring
+                              : mmap(nullptr, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                     IORING_OFF_CQ_RING);
+        sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqe_map = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                             IORING_OFF_SQES);
+        if (sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqe_map == MAP_FAILED) {
+            int error = errno;
+            if (sqe_map != MAP_FAILED) munmap(sqe_map, sqes_size);
+            release();
+            throw std::runtime_error("Failed to map io_uring queues: " + errno_message(error));
+        }
+        sqes = static_cast<io_uring_sqe*>(sqe_map);
+
+        auto* sq = static_cast<char*>(sq_ring);
+        auto* cq = static_cast<char*>(cq_ring);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    }
+
+    ~Ring() { release(); }
+
+    void release() {
+        if (sqes) munmap(sqes, sqes_size);
+        if (cq_ring != MAP_FAILED && cq_ring != sq_ring) munmap(cq_ring, cq_ring_size);
+        if (sq_ring != MAP_FAILED) munmap(sq_ring, sq_ring_size);
+        if (fd >= 0) ::close(fd);
+        sqes = nullptr;
+        sq_ring = cq_ring = MAP_FAILED;
+        fd = -1;
+    }
+
+    // Queue a read; it is submitted by the next wait()
+    void queue_read(int file_fd, char* buffer, unsigned length, uint64_t offset, int buffer_index, uint64_t tag) {
+        const unsigned tail = *sq_tail;
+        const unsigned index = tail & *sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = buffer_index >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe.fd = file_fd;
+        sqe.addr = reinterpret_cast<uint64_t>(buffer);
+        sqe.len = length;
+        sqe.off = offset;
+        sqe.buf_index = static_cast<uint16_t>(std::max(buffer_index, 0));
+        sqe.user_data = tag;
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++to_submit;
+    }
+
+    // Submit queued reads and wait for at least one completion
+    void wait() {
+        while (true) {
+            int ret = uring_enter(fd, to_submit, 1, IORING_ENTER_GETEVENTS);
+            if (ret >= 0) {
+                to_submit -= std::min<unsigned>(to_submit, static_cast<unsigned>(ret));
+                return;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                throw std::runtime_error("io_uring_enter failed: " + errno_message(errno));
+            }
+        }
+    }
+
+    template <typename Handler>
+    void reap(Handler&& handle) {
+        unsigned head = *cq_head;
+        const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe cqe = cqes[head & *cq_mask];
+            // Consume the entry before handling it, so a throwing handler does not see it twice
+            __atomic_store_n(cq_head, ++head, __ATOMIC_RELEASE);
+            handle(cqe.user_data, cqe.res);
+        }
+    }
+};
+
+UringFileReader::UringFileReader(const UringReaderConfig& config) : config_(config) {
+    config_.queue_depth = std::clamp<size_t>(config_.queue_depth, 1, 1024);
+    config_.buffer_bytes = (std::max<size_t>(config_.buffer_bytes, kAlignment) + kAlignment - 1) / kAlignment * kAlignment;
+    ring_ = std::make_unique<Ring>(static_cast<unsigned>(config_.queue_depth));
+
+    std::vector<iovec> iovecs;
+    for (size_t i = 0; i < config_.queue_depth; ++i) {
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, kAlignment, config_.buffer_bytes) != 0) {
+            for (char* b : buffers_) std::free(b);
+            throw std::runtime_error("Failed to allocate io_uring read buffers");
+        }
+        buffers_.push_back(static_cast<char*>(buffer));
+        iovecs.push_back(iovec{buffer, config_.buffer_bytes});
+    }
+
+    registered_ = uring_register(ring_->fd, IORING_REGISTER_BUFFERS, iovecs.data(),
+                                 static_cast<unsigned>(iovecs.size())) == 0;
+    if (!registered_) {
+        spdlog::warn("Could not register io_uring buffers ({}), using unregistered reads", errno_message(errno));
+    }
+}
+
+UringFileReader::~UringFileReader() {
+    ring_.reset();  // Closing the ring waits for reads still in flight
+    for (char* buffer : buffers_) {
+        std::free(buffer);
+    }
+}
+
+bool UringFileReader::isSupported() {
+    io_uring_params params{};
+    int fd = uring_setup(1, &params);
+    if (fd < 0) {
+        return false;
+    }
+    ::close(fd);
+    return true;
+}
+
+void UringFileReader::read(const std::string& path, const ChunkCallback& callback) {
+    stats_ = UringReaderStats();
+    stats_.registered = registered_;
+
+    int fd = -1;
+    if (config_.direct_io) {
+        fd = ::open(path.c_str(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+        if (fd < 0 && errno == EINVAL) {
+            spdlog::warn("O_DIRECT is not supported for {}, using buffered reads", path);
+        }
+        stats_.direct = fd >= 0;
+    }
+    if (fd < 0) {
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    }
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path + ", error: " + errno_message(errno));
+    }
+    struct stat sb;
+    if (fstat(fd, &sb) == -1) {
+        int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to get file size: " + path + ", error: " + errno_message(error));
+    }
+    const uint64_t file_size = static_cast<uint64_t>(sb.st_size);
+    if (!stats_.direct) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    // Read k of the file goes to slot k % queue_depth; slots are delivered in file order
+    struct Slot {
+        uint64_t offset = 0;
+        size_t expected = 0;  // Bytes of the file in this read
+        size_t filled = 0;
+        bool in_flight = false;
+    };
+    std::vector<Slot> slots(config_.queue_depth, Slot{file_size, 0, 0, false});  // Offset file_size: idle
+    size_t in_flight = 0;
+    uint64_t next_offset = 0;
+
+    auto issue = [&](size_t index) {
+        Slot& slot = slots[index];
+        // Always request whole buffers: O_DIRECT needs aligned lengths, the read stops at EOF anyway
+        ring_->queue_read(fd, buffers_[index] + slot.filled, static_cast<unsigned>(config_.buffer_bytes - slot.filled),
+                          slot.offset + slot.filled, registered_ ? static_cast<int>(index) : -1, index);
+        slot.in_flight = true;
+        ++in_flight;
+        ++stats_.reads;
+    };
+    auto start = [&](size_t index) {
+        if (next_offset >= file_size) {
+            return;
+        }
+        slots[index] = Slot{next_offset, static_cast<size_t>(std::min<uint64_t>(config_.buffer_bytes, file_size - next_offset)), 0, false};
+        next_offset += config_.buffer_bytes;
+        issue(index);
+    };
+    auto complete = [&](uint64_t tag, int result) {
+        Slot& slot = slots[tag];
+        slot.in_flight = false;
+        --in_flight;
+        if (result == -EAGAIN || result == -EINTR) {
+            issue(tag);
+            return;
+        }
+        if (result < 0) {
+            throw std::runtime_error("Read failed: " + path + ", error: " + errno_message(-result));
+        }
+        slot.filled += static_cast<size_t>(result);
+        if (result > 0 && slot.filled < slot.expected) {
+            issue(tag);  // Short read, fetch the rest
+        } else if (slot.filled > slot.expected) {
+            slot.filled = slot.expected;  // The file grew; stop at the size seen when opening
+        }
+    };
+
+    try {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            start(i);
+        }
+        for (size_t index = 0;; index = (index + 1) % slots.size()) {
+            Slot& slot = slots[index];
+            if (slot.offset >= file_size && !slot.in_flight) {
+                break;  // Reads are started in file order, so every later slot is idle too
+            }
+            while (slot.in_flight) {
+                ring_->wait();
+                ring_->reap(complete);
+            }
+            if (slot.filled > 0) {
+                stats_.bytes += slot.filled;
+                callback(buffers_[index], slot.filled);
+            }
+            if (slot.filled < slot.expected) {
+                break;  // The file shrank
+            }
+            slot.offset = file_size;  // Consumed
+            start(index);
+        }
+    } catch (...) {
+        // The kernel may still be writing into the buffers; wait for outstanding reads before leaving
+        while (in_flight > 0) {
+            try {
+                ring_->wait();
+            } catch (const std::exception&) {
+                break;
+            }
+            ring_->reap([&](uint64_t, int) { --in_flight; });
+        }
+        ::close(fd);
+        throw;
+    }
+
+    // Stop early on a shrunk file, draining reads that are still in flight
+    while (in_flight > 0) {
+        ring_->wait();
+        ring_->reap([&](uint64_t, int) { --in_flight; });
+    }
+    ::close(fd);
+}
+
+} // namespace logai
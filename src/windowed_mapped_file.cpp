@@ -0,0 +1,165 @@
+#include "windowed_mapped_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace logai {
+
+namespace {
+
+constexpr size_t kReleaseStep = 8 * 1024 * 1024;  // Consumed bytes released per madvise() call
+
+size_t page_size() {
+    static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return size;
+}
+
+} // namespace
+
+WindowedMappedFile::WindowedMappedFile(size_t window_bytes, const MappingOptions& options)
+    : window_bytes_(window_bytes), options_(options) {}
+
+WindowedMappedFile::~WindowedMappedFile() {
+    close();
+}
+
+bool WindowedMappedFile::open(const std::string& path) {
+    close();
+    fd_ = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ == -1) {
+        return false;
+    }
+    struct stat sb;
+    if (fstat(fd_, &sb) == -1) {
+        close();
+        return false;
+    }
+    file_size_ = static_cast<uint64_t>(sb.st_size);
+    if (options_.sequential) {
+        posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    return true;
+}
+
+void WindowedMappedFile::close() {
+    unmapWindow();
+    if (fd_ != -1) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    file_size_ = 0;
+}
+
+uint64_t WindowedMappedFile::mapWindow(uint64_t offset, size_t window_bytes) {
+    unmapWindow();
+    const uint64_t begin = offset - offset % page_size();
+    const size_t length = static_cast<size_t>(std::min<uint64_t>(window_bytes, file_size_ - begin));
+
+    int flags = MAP_PRIVATE;
+    if (file_size_ <= options_.populate_max_bytes) {
+        flags |= MAP_POPULATE;
+    }
+    void* mapped = mmap(nullptr, length, PROT_READ, flags, fd_, static_cast<off_t>(begin));
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error(std::string("Failed to map file window: ") + std::strerror(errno));
+    }
+    window_ = static_cast<char*>(mapped);
+    window_length_ = length;
+    ++stats_.windows;
+
+    if (options_.sequential) {
+        madvise(window_, window_length_, MADV_SEQUENTIAL);
+    }
+#ifdef MADV_HUGEPAGE
+    if (options_.huge_pages) {
+        madvise(window_, window_length_, MADV_HUGEPAGE);
+    }
+#endif
+    if (options_.prefetch_window > 0 && begin + length < file_size_) {
+        // Not mapped yet, so ask the page cache directly
+        posix_fadvise(fd_, static_cast<off_t>(begin + length), static_cast<off_t>(options_.prefetch_window),
+                      POSIX_FADV_WILLNEED);
+    }
+    return begin;
+}
+
+void WindowedMappedFile::unmapWindow() {
+    if (window_) {
+        munmap(window_, window_length_);
+        window_ = nullptr;
+        window_length_ = 0;
+    }
+}
+
+const WindowStats& WindowedMappedFile::forEachLine(const LineCallback& callback, size_t max_line_length) {
+    stats_ = WindowStats();
+    if (fd_ == -1) {
+        throw std::runtime_error("File is not open");
+    }
+
+    // A window must hold a whole line of max_line_length wherever in its first page the line starts
+    size_t window_bytes = std::max(window_bytes_, 2 * max_line_length + page_size());
+    window_bytes = (window_bytes + page_size() - 1) / page_size() * page_size();
+
+    uint64_t line_start = 0;  // File offset of the first byte not yet delivered
+    bool skipping = false;    // Inside a line that is too long, looking for its end
+    while (line_start < file_size_) {
+        const uint64_t window_begin = mapWindow(line_start, window_bytes);
+        const uint64_t window_end = window_begin + window_length_;
+        const char* p = window_ + (line_start - window_begin);
+        const char* end = window_ + window_length_;
+        const char* released = window_;
+
+        while (true) {
+            const char* newline = static_cast<const char*>(std::memchr(p, '\n', static_cast<size_t>(end - p)));
+            if (!newline) {
+                if (window_end == file_size_) {
+                    // Last line without a trailing newline
+                    if (skipping || static_cast<size_t>(end - p) > max_line_length) {
+                        ++stats_.long_lines;
+                    } else if (p < end) {
+                        callback(std::string_view(p, static_cast<size_t>(end - p)));
+                        ++stats_.lines;
+                    }
+                    line_start = file_size_;
+                } else if (skipping || static_cast<size_t>(end - p) > max_line_length) {
+                    skipping = true;  // Too long already; look for its end in the next window
+                    line_start = window_end;
+                } else {
+                    line_start = window_begin + static_cast<uint64_t>(p - window_);  // Straddles: remap from here
+                }
+                break;
+            }
+
+            const size_t length = static_cast<size_t>(newline - p);
+            if (skipping || length > max_line_length) {
+                ++stats_.long_lines;
+                skipping = false;
+            } else if (length > 0) {
+                callback(std::string_view(p, length));
+                ++stats_.lines;
+            }
+            p = newline + 1;
+
+            if (options_.release_consumed && static_cast<size_t>(p - released) >= kReleaseStep) {
+                const char* release_end = window_ + (static_cast<size_t>(p - window_) / page_size()) * page_size();
+                madvise(const_cast<char*>(released), static_cast<size_t>(release_end - released), MADV_DONTNEED);
+                released = release_end;
+            }
+            if (p == end) {
+                line_start = window_end;
+                break;
+            }
+        }
+    }
+    unmapWindow();
+    return stats_;
+}
+
+} // namespace logai
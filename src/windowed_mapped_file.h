@@ -0,0 +1,77 @@
+/**
+ * @file windowed_mapped_file.h
+ * @brief Line scanning through a bounded, sliding memory mapping
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include "memory_mapped_file.h"
+
+namespace logai {
+
+/**
+ * @brief What the last forEachLine() call did
+ */
+struct WindowStats {
+    uint64_t windows = 0;     ///< Windows mapped
+    uint64_t lines = 0;       ///< Lines delivered
+    uint64_t long_lines = 0;  ///< Lines dropped for exceeding max_line_length
+};
+
+/**
+ * @brief Maps a file one fixed-size window at a time instead of all at once
+ *
+ * Only one window is mapped at any time, so the address space and
+ * resident memory a scan needs are bounded by the window size however
+ * large the file is. When a line runs past the end of a window, the next
+ * window starts at the page holding that line's first byte: consecutive
+ * windows overlap by the partial line, which is then seen whole.
+ * MappingOptions apply per window; prefetch_window requests the bytes
+ * after the current window from the page cache before they are mapped.
+ */
+class WindowedMappedFile {
+public:
+    using LineCallback = std::function<void(std::string_view line)>;
+
+    explicit WindowedMappedFile(size_t window_bytes = 256 * 1024 * 1024,
+                                const MappingOptions& options = MappingOptions());
+    ~WindowedMappedFile();
+
+    WindowedMappedFile(const WindowedMappedFile&) = delete;
+    WindowedMappedFile& operator=(const WindowedMappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+    uint64_t size() const { return file_size_; }
+
+    /**
+     * @brief Deliver every non-empty line of the file, without its newline
+     *
+     * The view is only valid during the callback. The window is widened to
+     * at least twice max_line_length so a window always holds a whole line.
+     *
+     * @throws std::runtime_error if a window cannot be mapped
+     */
+    const WindowStats& forEachLine(const LineCallback& callback, size_t max_line_length);
+
+    const WindowStats& stats() const { return stats_; }
+
+private:
+    // Map [offset rounded down to a page, + window) and return the offset the mapping starts at
+    uint64_t mapWindow(uint64_t offset, size_t window_bytes);
+    void unmapWindow();
+
+    size_t window_bytes_;
+    MappingOptions options_;
+    int fd_ = -1;
+    uint64_t file_size_ = 0;
+    char* window_ = nullptr;
+    size_t window_length_ = 0;
+    WindowStats stats_;
+};
+
+} // namespace logai
@@ -0,0 +1,37 @@
+/**
+ * @file check.h
+ * @brief Minimal assertions for the unit tests
+ *
+ * Each test is a plain executable run by CTest: CHECK() reports a failed
+ * condition and carries on, and main() returns test_result() so that any
+ * failure fails the test.
+ */
+#pragma once
+#include <cstdio>
+
+namespace logai::test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline int test_result() {
+    if (failures() > 0) {
+        std::fprintf(stderr, "%d check(s) failed\n", failures());
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace logai::test
+
+#define CHECK(cond)                                                                       \
+    do {                                                                                  \
+        if (!(cond)) {                                                                    \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            ++logai::test::failures();                                                    \
+        }                                                                                 \
+    } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
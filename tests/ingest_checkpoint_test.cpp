@@ -0,0 +1,167 @@
+/**
+ * @file ingest_checkpoint_test.cpp
+ * @brief Resuming incremental parses of appended, rotated and truncated files
+ */
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include "check.h"
+#include "drain_parser.h"
+#include "file_data_loader.h"
+#include "ingest_checkpoint.h"
+
+using namespace logai;
+namespace fs = std::filesystem;
+
+namespace {
+
+void append(const fs::path& path, const std::string& text) {
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file << text;
+}
+
+std::string lines(int first, int count) {
+    std::string text;
+    for (int i = first; i < first + count; ++i) {
+        text += "2024-03-01 10:00:00 INFO request " + std::to_string(i) + " served\n";
+    }
+    return text;
+}
+
+// One incremental run that continues the DRAIN model of the previous one, as the bindings do
+struct Ingest {
+    IngestCheckpoint checkpoint;
+    std::shared_ptr<DrainParser> model;
+
+    IncrementalParseResult run(const fs::path& path) {
+        FileDataLoaderConfig config;
+        config.format = "drain";
+        config.log_type = "drain";
+        FileDataLoader loader(path.string(), config);
+        if (model) {
+            loader.set_template_parser(model);
+        }
+        auto result = loader.parse_log_file_incremental(path.string(), "drain", checkpoint);
+        model = loader.template_parser();
+        result.records.clear();  // They refer to the schema of the loader
+        return result;
+    }
+};
+
+void test_resume_appended_lines(const fs::path& dir) {
+    const auto path = dir / "append.log";
+    append(path, lines(0, 100));
+    Ingest ingest;
+
+    auto result = ingest.run(path);
+    CHECK(!result.resumed);
+    CHECK_EQ(ingest.checkpoint.records, 100u);
+    CHECK_EQ(ingest.checkpoint.offset, fs::file_size(path));
+
+    result = ingest.run(path);  // Nothing new
+    CHECK(result.resumed);
+    CHECK_EQ(result.first_record, 100u);
+    CHECK_EQ(ingest.checkpoint.records, 100u);
+
+    append(path, lines(100, 5));
+    result = ingest.run(path);
+    CHECK(result.resumed);
+    CHECK_EQ(result.first_record, 100u);
+    CHECK_EQ(ingest.checkpoint.records, 105u);
+}
+
+void test_unterminated_last_line(const fs::path& dir) {
+    const auto path = dir / "tail.log";
+    append(path, lines(0, 10) + "2024-03-01 10:01:00 INFO tail line");
+    Ingest ingest;
+
+    ingest.run(path);
+    CHECK_EQ(ingest.checkpoint.records, 11u);  // The last line is parsed as it stands
+    CHECK(ingest.checkpoint.unterminated);
+
+    // Its newline arrives with the next line: only the new line is parsed
+    append(path, "\n" + lines(10, 1));
+    auto result = ingest.run(path);
+    CHECK(result.resumed);
+    CHECK_EQ(result.first_record, 11u);
+    CHECK_EQ(ingest.checkpoint.records, 12u);
+    CHECK(!ingest.checkpoint.unterminated);
+
+    // A line that grows after it was parsed invalidates the checkpoint
+    append(path, "2024-03-01 10:02:00 INFO partial");
+    ingest.run(path);
+    CHECK_EQ(ingest.checkpoint.records, 13u);
+    append(path, " and more\n");
+    result = ingest.run(path);
+    CHECK(!result.resumed);
+    CHECK_EQ(ingest.checkpoint.records, 13u);
+}
+
+void test_rotation_and_truncation(const fs::path& dir) {
+    const auto path = dir / "rotate.log";
+    append(path, lines(0, 20));
+    Ingest ingest;
+    ingest.run(path);
+
+    fs::rename(path, dir / "rotate.log.1");
+    append(path, lines(20, 30));  // Longer than the old file, but a different inode
+    auto result = ingest.run(path);
+    CHECK(!result.resumed);
+    CHECK_EQ(ingest.checkpoint.records, 30u);
+
+    std::ofstream(path, std::ios::trunc) << lines(50, 3);
+    result = ingest.run(path);
+    CHECK(!result.resumed);
+    CHECK_EQ(ingest.checkpoint.records, 3u);
+}
+
+void test_new_model_does_not_resume(const fs::path& dir) {
+    const auto path = dir / "model.log";
+    append(path, lines(0, 20));
+    Ingest ingest;
+    ingest.run(path);
+    append(path, lines(20, 1));
+
+    ingest.model.reset();  // Cluster IDs of the checkpoint belong to the dropped model
+    auto result = ingest.run(path);
+    CHECK(!result.resumed);
+    CHECK_EQ(ingest.checkpoint.records, 21u);
+}
+
+void test_save_and_load(const fs::path& dir) {
+    const auto path = dir / "saved.log";
+    append(path, lines(0, 5) + "2024-03-01 10:01:00 INFO tail");
+    Ingest ingest;
+    ingest.run(path);
+
+    const auto saved = (dir / "checkpoint.json").string();
+    save_ingest_checkpoint(saved, ingest.checkpoint);
+    const auto loaded = load_ingest_checkpoint(saved);
+    CHECK(loaded.has_value());
+    if (loaded) {
+        CHECK_EQ(loaded->offset, ingest.checkpoint.offset);
+        CHECK_EQ(loaded->records, ingest.checkpoint.records);
+        CHECK_EQ(loaded->inode, ingest.checkpoint.inode);
+        CHECK_EQ(loaded->tail_hash, ingest.checkpoint.tail_hash);
+        CHECK_EQ(loaded->model_id, ingest.checkpoint.model_id);
+        CHECK(loaded->unterminated);
+        CHECK(checkpoint_matches_file(*loaded, path.string()));
+    }
+    CHECK(!load_ingest_checkpoint((dir / "missing.json").string()).has_value());
+}
+
+} // namespace
+
+int main() {
+    const auto dir = fs::temp_directory_path() / ("logai_ingest_checkpoint_test_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    test_resume_appended_lines(dir);
+    test_unterminated_last_line(dir);
+    test_rotation_and_truncation(dir);
+    test_new_model_does_not_resume(dir);
+    test_save_and_load(dir);
+    fs::remove_all(dir);
+    return test::test_result();
+}
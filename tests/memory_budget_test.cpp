@@ -0,0 +1,140 @@
+/**
+ * @file memory_budget_test.cpp
+ * @brief Blocking and shutdown of MemoryBudget, and loads that run or fail under a limit
+ */
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "check.h"
+#include "file_data_loader.h"
+#include "memory_budget.h"
+
+using namespace logai;
+namespace fs = std::filesystem;
+
+namespace {
+
+void test_acquire_waits_for_release() {
+    MemoryBudget budget(100);
+    CHECK(budget.acquire(80));
+    std::atomic<bool> admitted{false};
+    std::thread producer([&] { admitted = budget.acquire(40); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!admitted);
+    budget.release(80);
+    producer.join();
+    CHECK(admitted);
+    CHECK_EQ(budget.in_use(), 40u);
+    CHECK_EQ(budget.peak(), 80u);
+    CHECK_EQ(budget.waits(), 1u);
+}
+
+void test_oversized_request_is_admitted_alone() {
+    MemoryBudget budget(100);
+    CHECK(budget.acquire(500));  // Nothing else in flight
+    budget.charge(10);           // Never blocks, even over the limit
+    CHECK_EQ(budget.in_use(), 510u);
+    CHECK_EQ(budget.utilization(), 5.1);
+}
+
+void test_close_wakes_waiting_producer() {
+    MemoryBudget budget(100);
+    CHECK(budget.acquire(100));
+    std::atomic<int> result{-1};
+    std::thread producer([&] { result = budget.acquire(1) ? 1 : 0; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    budget.close();
+    producer.join();
+    CHECK_EQ(result.load(), 0);
+    CHECK_EQ(budget.in_use(), 100u);  // The refused bytes were not taken
+    CHECK(!budget.acquire(1));
+
+    budget.reset();
+    CHECK_EQ(budget.in_use(), 0u);
+    CHECK(budget.acquire(1));
+}
+
+const size_t kLines = 200000;
+
+// kLines lines "line <n>", large enough for many batches against a 1 MB limit
+fs::path write_lines(const fs::path& dir) {
+    const auto path = dir / "lines.csv";
+    if (!fs::exists(path)) {
+        std::ofstream file(path);
+        for (size_t i = 0; i < kLines; ++i) {
+            file << "line " << i << '\n';
+        }
+    }
+    return path;
+}
+
+FileDataLoaderConfig limited_config(const fs::path& path) {
+    FileDataLoaderConfig config;
+    config.file_path = path.string();
+    config.log_type = "csv";
+    config.format = "csv";
+    config.dimensions = {"body"};
+    config.num_threads = 4;
+    config.memory_limit_mb = 1;
+    config.target_batch_bytes = 64 * 1024;
+    return config;
+}
+
+void test_load_data_under_limit(const fs::path& dir) {
+    // The consumer has to return every batch's bytes
+    const auto path = write_lines(dir);
+    FileDataLoader loader(path.string(), limited_config(path));
+    const auto records = loader.load_data();
+
+    CHECK_EQ(records.size(), kLines);
+    bool ordered = true;
+    for (size_t i = 0; i < records.size(); ++i) {
+        ordered &= records[i].body == "line " + std::to_string(i);
+    }
+    CHECK(ordered);
+}
+
+void test_failing_callback_ends_run(const fs::path& dir, bool ordered) {
+    // Once the callback throws, the batches it held never return their bytes to the budget
+    const auto path = write_lines(dir);
+    auto config = limited_config(path);
+    config.ordered_delivery = ordered;
+    FileDataLoader loader(path.string(), config);
+    size_t calls = 0;
+    const bool ok = loader.process_large_file_with_callback(
+        path.string(), "csv", 1000,
+        [&](const std::vector<LogRecordObject>&) {
+            if (++calls >= 3) {
+                throw std::runtime_error("callback failed");
+            }
+        },
+        1);
+    CHECK(!ok);
+    CHECK(calls < kLines / 1000);
+
+    // The next run starts over with an open budget
+    size_t records = 0;
+    CHECK(loader.process_large_file_with_callback(
+        path.string(), "csv", 1000, [&](const std::vector<LogRecordObject>& batch) { records += batch.size(); }, 1));
+    CHECK_EQ(records, kLines);
+}
+
+} // namespace
+
+int main() {
+    const auto dir = fs::temp_directory_path() / ("logai_memory_budget_test_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    test_acquire_waits_for_release();
+    test_oversized_request_is_admitted_alone();
+    test_close_wakes_waiting_producer();
+    test_load_data_under_limit(dir);
+    test_failing_callback_ends_run(dir, true);
+    test_failing_callback_ends_run(dir, false);
+    fs::remove_all(dir);
+    return test::test_result();
+}
@@ -0,0 +1,112 @@
+/**
+ * @file multi_file_reader_test.cpp
+ * @brief Loser-tree merge of static and followed files
+ */
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "check.h"
+#include "multi_file_reader.h"
+#include "timestamp_utils.h"
+
+using namespace logai;
+namespace fs = std::filesystem;
+
+namespace {
+
+// "2024-03-24 10:00:00,000" plus the given number of seconds
+std::string log4j_line(int seconds, const std::string& message) {
+    char timestamp[32];
+    std::snprintf(timestamp, sizeof(timestamp), "2024-03-24 %02d:%02d:%02d,000", 10 + seconds / 3600,
+                  seconds / 60 % 60, seconds % 60);
+    return std::string(timestamp) + " INFO [main] App: " + message + "\n";
+}
+
+// Static files are read with the loader's default of a header line
+const char* const kHeader = "timestamp level thread logger message\n";
+
+void write_file(const fs::path& path, const std::string& content) {
+    std::ofstream file(path, std::ios::binary | std::ios::app);
+    file << content;
+}
+
+void test_static_files_merge_in_order(const fs::path& dir) {
+    // Three files with interleaved timestamps, one of them without entries
+    std::vector<MultiFileReader::FileEntry> files;
+    for (int f = 0; f < 3; ++f) {
+        const auto path = dir / ("static" + std::to_string(f) + ".log");
+        std::string content = kHeader;
+        for (int i = 0; f < 2 && i < 500; ++i) {
+            content += log4j_line(i * 2 + f, "file " + std::to_string(f));
+        }
+        write_file(path, content);
+        files.push_back({path.string(), "log4j", false, false});
+    }
+
+    MultiFileReader reader(files, 64);
+    size_t count = 0;
+    int64_t previous = 0;
+    bool ordered = true;
+    for (auto batch = reader.nextBatch(100); !batch.empty(); batch = reader.nextBatch(100)) {
+        for (const auto& entry : batch) {
+            const int64_t ms = parse_epoch_millis(entry.timestamp).value_or(0);
+            ordered &= ms >= previous;
+            previous = ms;
+            ++count;
+        }
+    }
+    CHECK_EQ(count, 1000u);
+    CHECK(ordered);
+    CHECK(!reader.hasMore());
+}
+
+void test_followed_file_rejoins_merge(const fs::path& dir) {
+    // A followed file drains first, then gets a line while a static file still has entries
+    const auto followed = dir / "followed.log";
+    const auto stat = dir / "static.log";
+    write_file(followed, "");
+    std::string content = kHeader;
+    for (int i = 0; i < 2000; ++i) {
+        content += log4j_line(60 + i, "static");
+    }
+    write_file(stat, content);
+
+    MultiFileReader reader({{followed.string(), "log4j", true, false}, {stat.string(), "log4j", false, false}}, 64);
+    size_t static_count = reader.nextBatch(1).size();
+    write_file(followed, log4j_line(0, "followed"));
+
+    // The line arrives on the follower thread; it is older than every static entry left
+    size_t followed_count = 0;
+    while (true) {
+        auto batch = reader.nextBatch(1);
+        if (batch.empty()) {
+            break;
+        }
+        if (batch.front().message.find("followed") != std::string::npos) {
+            ++followed_count;
+            CHECK_EQ(parse_epoch_millis(batch.front().timestamp), parse_epoch_millis("2024-03-24 10:00:00"));
+        } else {
+            ++static_count;
+        }
+        if (followed_count == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    CHECK_EQ(followed_count, 1u);
+    CHECK_EQ(static_count, 2000u);  // The static file stays in the merge after the followed one rejoins
+    CHECK(reader.hasMore());        // Followed files never end
+}
+
+} // namespace
+
+int main() {
+    const auto dir = fs::temp_directory_path() / ("logai_multi_file_reader_test_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    test_static_files_merge_in_order(dir);
+    test_followed_file_rejoins_merge(dir);
+    fs::remove_all(dir);
+    return test::test_result();
+}
@@ -0,0 +1,181 @@
+/**
+ * @file parallel_decompressor_test.cpp
+ * @brief Splitting bzip2 and gzip/BGZF files into pieces that decode independently, and reading them as a stream
+ */
+#include <bzlib.h>
+#include <zlib.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include "check.h"
+#include "parallel_decompressor.h"
+
+using namespace logai;
+namespace fs = std::filesystem;
+
+namespace {
+
+// Log lines that compress well but not to nothing
+std::string make_log(size_t bytes) {
+    std::string text;
+    uint32_t state = 12345;
+    for (size_t i = 0; text.size() < bytes; ++i) {
+        state = state * 1103515245 + 12345;
+        text += "2024-03-01T10:00:00Z INFO request " + std::to_string(i) + " took " +
+                std::to_string(state % 1000) + "ms user=" + std::to_string((state >> 10) % 97) + "\n";
+    }
+    return text;
+}
+
+std::string bzip2(const std::string& data, int block_size_100k) {
+    std::string out(data.size() + data.size() / 100 + 600, '\0');
+    unsigned int size = static_cast<unsigned int>(out.size());
+    const int rc = BZ2_bzBuffToBuffCompress(out.data(), &size, const_cast<char*>(data.data()),
+                                            static_cast<unsigned int>(data.size()), block_size_100k, 0, 0);
+    CHECK_EQ(rc, BZ_OK);
+    out.resize(size);
+    return out;
+}
+
+// One gzip member; with bgzf, the "BC" extra field that records the member size
+std::string gzip_member(const std::string& data, bool bgzf) {
+    z_stream stream{};
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    std::string deflated(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(deflated.data());
+    stream.avail_out = static_cast<uInt>(deflated.size());
+    deflate(&stream, Z_FINISH);
+    deflated.resize(stream.total_out);
+    deflateEnd(&stream);
+
+    auto le16 = [](std::string& s, uint32_t v) { s += char(v & 0xff); s += char((v >> 8) & 0xff); };
+    auto le32 = [&](std::string& s, uint32_t v) { le16(s, v & 0xffff); le16(s, v >> 16); };
+    std::string member = {char(0x1f), char(0x8b), 8, char(bgzf ? 4 : 0), 0, 0, 0, 0, 0, char(0xff)};
+    if (bgzf) {
+        le16(member, 6);
+        member += "BC";
+        le16(member, 2);
+        le16(member, static_cast<uint32_t>(member.size() + 2 + deflated.size() + 8 - 1));
+    }
+    member += deflated;
+    le32(member, static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(data.data()), data.size())));
+    le32(member, static_cast<uint32_t>(data.size()));
+    return member;
+}
+
+// Members of at most member_bytes uncompressed each
+std::string gzip_members(const std::string& data, size_t member_bytes, bool bgzf) {
+    std::string out;
+    for (size_t offset = 0; offset < data.size(); offset += member_bytes) {
+        out += gzip_member(data.substr(offset, member_bytes), bgzf);
+    }
+    return out;
+}
+
+struct Decoded {
+    std::string output;
+    DecompressorStats stats;
+};
+
+Decoded decode(const fs::path& path, const std::string& compressed, CompressionFormat format,
+               size_t min_piece_bytes, uint64_t start_offset = 0) {
+    std::ofstream(path, std::ios::binary) << compressed;
+    DecompressorConfig config;
+    config.num_threads = 4;
+    config.min_piece_bytes = min_piece_bytes;
+    config.chunk_bytes = 64 * 1024;
+    ParallelDecompressor decompressor(config);
+    Decoded decoded;
+    decompressor.decompress(path.string(), format,
+                            [&](const char* data, size_t size) { decoded.output.append(data, size); },
+                            start_offset);
+    decoded.stats = decompressor.stats();
+    return decoded;
+}
+
+void test_bzip2_blocks(const fs::path& dir, const std::string& log) {
+    // 100 kB blocks: one piece per block
+    const auto compressed = bzip2(log, 1);
+    auto decoded = decode(dir / "blocks.bz2", compressed, CompressionFormat::Bzip2, 1);
+    CHECK(decoded.output == log);
+    CHECK(decoded.stats.pieces >= log.size() / 100000);
+    CHECK(decoded.stats.parallel);
+    CHECK(!decoded.stats.fell_back);
+    CHECK_EQ(decoded.stats.bytes_out, log.size());
+    CHECK_EQ(detect_compression((dir / "blocks.bz2").string()), CompressionFormat::Bzip2);
+
+    // Concatenated streams, as pbzip2 writes them
+    const auto half = log.size() / 2;
+    decoded = decode(dir / "streams.bz2", bzip2(log.substr(0, half), 1) + bzip2(log.substr(half), 1),
+                     CompressionFormat::Bzip2, 1);
+    CHECK(decoded.output == log);
+
+    // A single block cannot be split
+    const auto small = log.substr(0, 50000);
+    decoded = decode(dir / "small.bz2", bzip2(small, 9), CompressionFormat::Bzip2, 1);
+    CHECK(decoded.output == small);
+    CHECK_EQ(decoded.stats.pieces, 0u);
+}
+
+void test_bgzf_members(const fs::path& dir, const std::string& log) {
+    const auto compressed = gzip_members(log, 64 * 1024, true);
+    auto decoded = decode(dir / "log.bgzf.gz", compressed, CompressionFormat::Gzip, 128 * 1024);
+    CHECK(decoded.output == log);
+    CHECK(decoded.stats.pieces > 1);
+    CHECK(!decoded.stats.fell_back);
+
+    // Whole members before the start offset are skipped, the rest of the output is exact
+    const uint64_t start = log.size() / 2 + 7;
+    decoded = decode(dir / "log.bgzf.gz", compressed, CompressionFormat::Gzip, 128 * 1024, start);
+    CHECK(decoded.output == log.substr(start));
+    CHECK(decoded.stats.pieces > 0);
+
+    decoded = decode(dir / "log.bgzf.gz", compressed, CompressionFormat::Gzip, 128 * 1024, log.size());
+    CHECK(decoded.output.empty());
+}
+
+void test_gzip_members(const fs::path& dir, const std::string& log) {
+    // Members without the BGZF field are found by their validated headers
+    auto decoded = decode(dir / "members.gz", gzip_members(log, 64 * 1024, false), CompressionFormat::Gzip,
+                          16 * 1024);
+    CHECK(decoded.output == log);
+    CHECK(decoded.stats.pieces > 1);
+    CHECK(!decoded.stats.fell_back);
+
+    // One member is decoded sequentially
+    decoded = decode(dir / "single.gz", gzip_member(log, false), CompressionFormat::Gzip, 16 * 1024);
+    CHECK(decoded.output == log);
+    CHECK_EQ(decoded.stats.pieces, 0u);
+}
+
+void test_stream_decodes_on_first_read(const fs::path& dir, const std::string& log) {
+    const auto path = dir / "stream.bz2";
+    std::ofstream(path, std::ios::binary) << bzip2("stale\n", 9);
+    DecompressedStream stream(path.string(), CompressionFormat::Bzip2);
+    CHECK(stream.good());
+
+    // Nothing was decoded yet, so the stream reads the file as it is at the first read
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << bzip2(log, 1);
+    const std::string text((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    CHECK(text == log);
+
+    DecompressedStream unread(path.string(), CompressionFormat::Bzip2);  // Destroyed without a read
+}
+
+} // namespace
+
+int main() {
+    const auto dir = fs::temp_directory_path() / ("logai_parallel_decompressor_test_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    const auto log = make_log(1500 * 1000);
+    test_bzip2_blocks(dir, log);
+    test_bgzf_members(dir, log);
+    test_gzip_members(dir, log);
+    test_stream_decodes_on_first_read(dir, log);
+    fs::remove_all(dir);
+    return test::test_result();
+}
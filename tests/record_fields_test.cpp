@@ -0,0 +1,167 @@
+/**
+ * @file record_fields_test.cpp
+ * @brief Inline storage, spilling, copying and dictionary encoding of RecordFields
+ */
+#include <memory>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "record_fields.h"
+
+using namespace logai;
+
+namespace {
+
+std::string key(size_t i) { return "key" + std::to_string(i); }
+
+void test_inline_fields() {
+    auto schema = std::make_shared<FieldSchema>();
+    RecordFields fields(schema.get());
+    for (size_t i = 0; i < RecordFields::kInlineCapacity; ++i) {
+        fields.set(key(i), "value" + std::to_string(i));
+    }
+    CHECK_EQ(fields.size(), RecordFields::kInlineCapacity);
+    CHECK_EQ(fields.heap_bytes(), 0u);  // Short values fit fbstring's inline buffer
+    CHECK(fields.find(key(2)) && *fields.find(key(2)) == "value2");
+    CHECK(fields.find(*schema->find(key(3))) && *fields.find(*schema->find(key(3))) == "value3");
+    CHECK(!fields.find("missing"));
+
+    fields.set(key(2), "changed");  // Overwrites in place
+    CHECK_EQ(fields.size(), RecordFields::kInlineCapacity);
+    CHECK(*fields.find(key(2)) == "changed");
+
+    // Inline fields iterate in insertion order
+    size_t i = 0;
+    bool in_order = true;
+    for (const auto& [name, value] : fields) {
+        in_order &= name == key(i++);
+    }
+    CHECK(in_order);
+}
+
+void test_spill_keeps_fields() {
+    auto schema = std::make_shared<FieldSchema>();
+    RecordFields fields(schema.get());
+    const size_t count = RecordFields::kInlineCapacity * 3;
+    for (size_t i = 0; i < count; ++i) {
+        fields.set(key(i), "value" + std::to_string(i));
+    }
+    CHECK_EQ(fields.size(), count);
+    CHECK(fields.heap_bytes() > 0);
+
+    bool all_found = true;
+    for (size_t i = 0; i < count; ++i) {
+        const auto* value = fields.find(key(i));
+        all_found &= value && *value == "value" + std::to_string(i);
+    }
+    CHECK(all_found);
+    size_t iterated = 0;
+    for (auto it = fields.begin(); it != fields.end(); ++it) {
+        ++iterated;
+    }
+    CHECK_EQ(iterated, count);
+
+    fields.clear();
+    CHECK(fields.empty());
+    CHECK(!fields.find(key(0)));
+    fields.set(key(0), "again");  // Back to inline storage
+    CHECK_EQ(fields.heap_bytes(), 0u);
+    CHECK(*fields.find(key(0)) == "again");
+}
+
+void test_copy_and_move() {
+    auto schema = std::make_shared<FieldSchema>();
+    RecordFields spilled(schema.get());
+    for (size_t i = 0; i < RecordFields::kInlineCapacity + 1; ++i) {
+        spilled.set(key(i), std::string(40, 'x'));  // Heap-allocated values
+    }
+
+    RecordFields copy(spilled);
+    CHECK_EQ(copy.size(), spilled.size());
+    CHECK_EQ(copy.schema(), schema.get());
+    copy.set(key(0), "copy");
+    CHECK(*spilled.find(key(0)) == std::string(40, 'x'));  // Deep copy
+
+    RecordFields moved(std::move(spilled));
+    CHECK_EQ(moved.size(), RecordFields::kInlineCapacity + 1);
+    CHECK(spilled.empty());
+    CHECK_EQ(moved.schema(), schema.get());
+
+    RecordFields assigned;
+    assigned = moved;
+    CHECK_EQ(assigned.size(), moved.size());
+    assigned = std::move(copy);
+    CHECK(*assigned.find(key(0)) == "copy");
+}
+
+void test_default_schema() {
+    RecordFields fields;
+    CHECK_EQ(fields.schema(), FieldSchema::shared_default().get());
+    fields.set(FieldSchema::kPid, "42");
+    CHECK(fields.find("pid") && *fields.find("pid") == "42");
+
+    auto schema = std::make_shared<FieldSchema>();
+    fields.reset(schema.get());
+    CHECK(fields.empty());
+    CHECK_EQ(fields.schema(), schema.get());
+}
+
+void test_encoded_fields() {
+    auto schema = std::make_shared<FieldSchema>();
+    RecordFields a(schema.get());
+    RecordFields b(schema.get());
+    a.set("host", "web-01");
+    b.set(FieldSchema::kHost, "web-02");
+    a.set("user", "alice");  // Not a well-known key, stored as a plain string
+
+    CHECK(a.code(FieldSchema::kHost) && *a.code(FieldSchema::kHost) == 0);
+    CHECK(b.code(FieldSchema::kHost) && *b.code(FieldSchema::kHost) == 1);
+    CHECK(!a.code(*schema->find("user")));
+    CHECK(*a.find("host") == "web-01");
+    CHECK(*b.find(FieldSchema::kHost) == "web-02");
+    CHECK_EQ(a.size(), 2u);
+
+    // Encoded fields iterate first; codes survive copies
+    CHECK((*a.begin()).first == "host");
+    RecordFields copy(a);
+    CHECK_EQ(copy.code(FieldSchema::kHost), a.code(FieldSchema::kHost));
+
+    RecordFields c(schema.get());
+    c.set_code(FieldSchema::kHost, *b.code(FieldSchema::kHost));
+    CHECK(*c.find("host") == "web-02");
+    CHECK_EQ(schema->dictionary(FieldSchema::kHost).size(), 2u);
+}
+
+void test_full_dictionary_falls_back_to_strings() {
+    auto schema = std::make_shared<FieldSchema>();
+    auto& programs = schema->dictionary(FieldSchema::kProgram);
+    for (size_t i = 0; i < ValueDictionary::kMaxCodes; ++i) {
+        programs.encode("program" + std::to_string(i));
+    }
+    CHECK_EQ(programs.size(), ValueDictionary::kMaxCodes);
+
+    RecordFields fields(schema.get());
+    fields.set(FieldSchema::kProgram, "program7");  // Known values are still encoded
+    CHECK(fields.code(FieldSchema::kProgram) && *fields.code(FieldSchema::kProgram) == 7);
+    fields.set(FieldSchema::kProgram, "one-too-many");
+    CHECK(!fields.code(FieldSchema::kProgram));
+    CHECK(*fields.find("program") == "one-too-many");
+    CHECK_EQ(fields.size(), 1u);
+    CHECK_EQ(programs.size(), ValueDictionary::kMaxCodes);
+
+    fields.set(FieldSchema::kProgram, "program8");  // Back to a code, the plain copy is dropped
+    CHECK(fields.code(FieldSchema::kProgram) && *fields.code(FieldSchema::kProgram) == 8);
+    CHECK_EQ(fields.size(), 1u);
+}
+
+} // namespace
+
+int main() {
+    test_inline_fields();
+    test_spill_keeps_fields();
+    test_copy_and_move();
+    test_default_schema();
+    test_encoded_fields();
+    test_full_dictionary_falls_back_to_strings();
+    return test::test_result();
+}
@@ -0,0 +1,108 @@
+/**
+ * @file reorder_buffer_test.cpp
+ * @brief Ordering, back-pressure and end of stream of ReorderBuffer
+ */
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "check.h"
+#include "reorder_buffer.h"
+
+using namespace logai;
+
+namespace {
+
+void test_restores_order() {
+    ReorderBuffer<int> buffer(4);
+    CHECK(buffer.push(2, 20));
+    CHECK(buffer.push(0, 0));
+    CHECK(buffer.push(1, 10));
+    buffer.finish(3);
+
+    std::vector<int> popped;
+    int value;
+    while (buffer.pop(value)) {
+        popped.push_back(value);
+    }
+    CHECK((popped == std::vector<int>{0, 10, 20}));
+    CHECK_EQ(buffer.next_id(), 3u);
+    CHECK_EQ(buffer.size(), 0u);
+}
+
+void test_push_waits_a_window_ahead() {
+    ReorderBuffer<int> buffer(2);
+    CHECK(buffer.push(1, 1));
+    std::atomic<bool> pushed{false};
+    std::thread worker([&] { pushed = buffer.push(2, 2); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!pushed);  // ID 2 shares a slot with ID 0, which has not been popped
+
+    CHECK(buffer.push(0, 0));
+    int value;
+    CHECK(buffer.pop(value) && value == 0);
+    worker.join();
+    CHECK(pushed);
+    CHECK(buffer.pop(value) && value == 1);
+    CHECK(buffer.pop(value) && value == 2);
+}
+
+void test_finish_wakes_waiting_consumer() {
+    ReorderBuffer<int> buffer(4);
+    std::atomic<int> popped{0};
+    std::thread consumer([&] {
+        int value;
+        while (buffer.pop(value)) {
+            ++popped;
+        }
+    });
+    CHECK(buffer.push(0, 0));
+    CHECK(buffer.push(1, 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    buffer.finish(2);  // The consumer already waits for ID 2
+    consumer.join();
+    CHECK_EQ(popped.load(), 2);
+}
+
+void test_finish_without_items() {
+    ReorderBuffer<int> buffer(4);
+    buffer.finish(0);
+    int value;
+    CHECK(!buffer.pop(value));
+}
+
+void test_close_stops_at_first_missing_id() {
+    ReorderBuffer<int> buffer(4);
+    CHECK(buffer.push(0, 0));
+    CHECK(buffer.push(2, 2));  // ID 1 was lost
+    buffer.close();
+    CHECK(!buffer.push(3, 3));
+
+    int value;
+    CHECK(buffer.pop(value) && value == 0);
+    CHECK(!buffer.pop(value));
+    CHECK_EQ(buffer.next_id(), 1u);
+}
+
+void test_close_wakes_waiting_producer() {
+    ReorderBuffer<int> buffer(1);
+    CHECK(buffer.push(0, 0));
+    std::atomic<int> result{-1};
+    std::thread worker([&] { result = buffer.push(1, 1) ? 1 : 0; });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    buffer.close();
+    worker.join();
+    CHECK_EQ(result.load(), 0);
+}
+
+} // namespace
+
+int main() {
+    test_restores_order();
+    test_push_waits_a_window_ahead();
+    test_finish_wakes_waiting_consumer();
+    test_finish_without_items();
+    test_close_stops_at_first_missing_id();
+    test_close_wakes_waiting_producer();
+    return test::test_result();
+}
@@ -0,0 +1,78 @@
+/**
+ * @file template_anomaly_detector_test.cpp
+ * @brief Intervals of undated records and of batches that arrive in several loads
+ */
+#include <algorithm>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+#include "check.h"
+#include "template_anomaly_detector.h"
+
+using namespace logai;
+
+namespace {
+
+const int64_t kStartMs = 1709287200000;  // 2024-03-01 10:00:00 UTC
+const int64_t kIntervalMs = 60 * 1000;
+
+// count records of template 0, dated in the given interval after kStartMs, or undated
+std::vector<LogRecordObject> records(size_t count, std::optional<int64_t> interval) {
+    std::vector<LogRecordObject> batch(count);
+    for (auto& record : batch) {
+        record.set_field(FieldSchema::kClusterId, "0");
+        if (interval) {
+            record.timestamp = std::chrono::system_clock::time_point(
+                std::chrono::milliseconds(kStartMs + *interval * kIntervalMs));
+        }
+    }
+    return batch;
+}
+
+size_t spikes(const TemplateAnomalyDetector& detector) {
+    const auto anomalies = detector.anomalies();
+    return std::count_if(anomalies.begin(), anomalies.end(),
+                         [](const TemplateAnomaly& a) { return a.type == AnomalyType::Spike; });
+}
+
+void test_undated_records_wait_for_a_timestamp() {
+    TemplateAnomalyDetector detector;
+    detector.observe_batch(records(3, std::nullopt));  // A banner before the first dated line
+    for (int64_t interval = 0; interval < 6; ++interval) {
+        detector.observe_batch(records(10, interval));
+    }
+    detector.observe_batch(records(60, 6));
+    detector.flush();
+
+    const auto anomalies = detector.anomalies();
+    CHECK_EQ(spikes(detector), 1u);
+    CHECK(!anomalies.empty() && anomalies.back().interval_start_ms == kStartMs + 6 * kIntervalMs);
+    CHECK(!anomalies.empty() && anomalies.back().observed == 60u);
+}
+
+void test_open_interval_spans_loads() {
+    TemplateAnomalyDetector detector;
+    for (int64_t interval = 0; interval < 6; ++interval) {
+        detector.observe_batch(records(10, interval));
+    }
+
+    // The last interval arrives in two incremental loads; neither half alone is a spike
+    detector.observe_batch(records(20, 6));
+    CHECK_EQ(spikes(detector), 0u);
+    detector.observe_batch(records(20, 6));
+    CHECK_EQ(spikes(detector), 1u);  // Reported while the interval is still open
+    CHECK_EQ(spikes(detector), 1u);  // Reading does not raise it again
+
+    detector.observe_batch(records(10, 7));  // Closes interval 6 for good
+    CHECK_EQ(spikes(detector), 1u);
+    CHECK_EQ(detector.template_count(), 1u);
+}
+
+} // namespace
+
+int main() {
+    test_undated_records_wait_for_a_timestamp();
+    test_open_interval_spans_loads();
+    return test::test_result();
+}